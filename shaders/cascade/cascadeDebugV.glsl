@@ -1,8 +1,7 @@
 #version 460 core
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/camera_constants.glsl"
 
 void main()
 {
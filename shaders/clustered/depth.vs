@@ -0,0 +1,12 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+#include "include/camera_constants.glsl"
+
+// Depth pre-pass, only feeds markClusters.comp so nothing but the position is needed
+void main()
+{
+    gl_Position = viewProjection * model * vec4(aPos, 1.0);
+}
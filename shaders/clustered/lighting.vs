@@ -10,12 +10,22 @@ out vec3 Normal;
 out vec3 FragPos;
 out mat3 TBN;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+struct InstanceData {
+    mat4 modelMatrix;
+    vec4 color;
+};
+
+layout (std430, binding = 11) readonly buffer InstanceBlock {
+    InstanceData instances[];
+};
+uniform uint instanceOffset;
+
+#include "include/camera_constants.glsl"
 
 void main()
 {
+    mat4 model = instances[instanceOffset + gl_InstanceID].modelMatrix;
+
     TexCoords = aTexCoords;
     mat3 normalMatrix = mat3(transpose(inverse(model)));
     Normal = mat3(transpose(inverse(model))) * aNormal;
@@ -20,6 +20,10 @@ struct DirLight {
     vec3 color;
 };
 
+#include "include/material.glsl"
+#include "include/camera_constants.glsl"
+#include "include/brdf.glsl"
+
 struct LightGrid {
     uint offset;
     uint count;
@@ -44,18 +48,12 @@ layout (std430, binding = 5) buffer lightGridSSBO {
     LightGrid lightGrid[];
 };
 
-#define M_PI 3.1415926535897932384626433832795
-
 uniform float zNear;
 uniform float zFar;
 uniform float scale;
 uniform float bias;
 uniform float multiplier;
 
-uniform vec3 viewPos;
-uniform mat4 view;
-uniform mat4 projection;
-
 uniform DirLight dirLight;
 
 uniform sampler2D texture_diffuse;
@@ -63,9 +61,7 @@ uniform sampler2D texture_specular;
 uniform sampler2D texture_normal;
 uniform sampler2D texture_metallic;
 
-uniform bool noNormalMap;
-uniform bool useFragNormalFunction;
-uniform bool noMetallicMap;
+uniform uint materialIndex;
 
 vec3 getNormalFromMap();
 vec3 calcPointLight(uint index, vec3 position, vec3 normal, 
@@ -75,36 +71,29 @@ vec3 calcDirLight(vec3 normal, vec3 viewDir, vec3 albedo,
     float roughness, float metallic, vec3 F0);
 float linearDepth(float depthSample);
 
-vec3 fresnelSchlick(float cosTheta, vec3 F0);
-vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness);
-float DistributionGGX(vec3 N, vec3 H, float roughness);
-float GeometrySchlickGGX(float NdotV, float roughness);
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness);
-
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 albedo = texture(texture_diffuse, TexCoords).rgb;
-    float metallic;
-    float roughness;
-    if (noMetallicMap) {
-        metallic = 0.2;
-        roughness = 0.8;
-    } else {
-        metallic = texture(texture_metallic, TexCoords).b;
-        roughness = texture(texture_metallic, TexCoords).g;
-    }
-
-    vec3 normal;
-    if (noNormalMap) normal = normalize(Normal);
-    else  {
-        if (useFragNormalFunction) {
-            normal = getNormalFromMap();
-        } else {
-            vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
-            normal = normalize(TBN * tangentNormal);
-        }
-    }
+    MaterialParams material = materials[materialIndex].params;
+
+    vec3 albedo = texture(texture_diffuse, TexCoords).rgb * material.baseColor;
+#ifdef HAS_METALLIC_MAP
+    vec2 metalRough = texture(texture_metallic, TexCoords).bg;
+    float metallic = metalRough.x;
+    float roughness = metalRough.y;
+#else
+    float metallic = material.metallic;
+    float roughness = material.roughness;
+#endif
+
+#if !defined(HAS_NORMAL_MAP)
+    vec3 normal = normalize(Normal);
+#elif defined(FRAG_NORMAL_FUNCTION)
+    vec3 normal = getNormalFromMap();
+#else
+    vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
+    vec3 normal = normalize(TBN * tangentNormal);
+#endif
 
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 reflectDir = reflect(-viewDir, normal);
@@ -129,8 +118,8 @@ void main()
             viewDir, albedo, roughness, 
             metallic, F0, viewDistance);
     }
-    vec3 ambient = vec3(0.125) * albedo;
-    radianceOut += ambient;
+    vec3 ambient = vec3(0.125) * albedo * material.ao;
+    radianceOut += ambient + material.emissive;
 
     FragColor = vec4(radianceOut, 1.0);
 }
@@ -216,45 +205,3 @@ float linearDepth(float depthSample) {
     float linear = 2.0 * zNear * zFar / (zFar + zNear - depthRange * (zFar - zNear));
     return linear;
 }
-
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}
-
-vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
-{
-    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}  
-
-float DistributionGGX(vec3 N, vec3 H, float roughness) {
-    float a = roughness * roughness;
-    float a2 = a * a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;
-
-    float num = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = M_PI * denom * denom;
-
-    return num / denom;
-}
-
-float GeometrySchlickGGX(float NdotV, float roughness) {
-    float r = (roughness + 1.0);
-    float k = (r * r) / 8;
-
-    float num = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-
-    return num / denom;
-}
-
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-
-    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-
-    return ggx1 * ggx2;
-}
\ No newline at end of file
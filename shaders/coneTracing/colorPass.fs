@@ -32,14 +32,9 @@ uniform sampler2D texture_normal;
 uniform sampler2D texture_metallic;
 uniform sampler3D voxelTexture;
 
-uniform sampler2DArray cascadedMap;
-layout (std140, binding = 0) uniform LightSpaceMatrices {
-    mat4 lightSpaceMatrices[16];
-};
-uniform float cascadePlaneDistances[16];
-uniform int cascadeCount;
-uniform mat4 view;
-uniform float far_plane;
+#include "include/cascade_shadows.glsl"
+#include "include/brdf.glsl"
+
 uniform bool showShadows;
 
 uniform float MAX_DIST = 20.0;
@@ -53,11 +48,8 @@ uniform int gridSize;
 uniform mat4 voxelProjection;
 
 uniform bool useAO;
-uniform bool noNormal;
-uniform bool noMetallicMap;
 
 uniform float shininess;
-uniform vec3 viewPos;
 
 uniform float dirLightMultiplier;
 uniform DirLight dirLight;
@@ -85,62 +77,23 @@ vec4 calcIndirectLighting(vec3 albedo, vec3 normal, vec3 tangent, float metallic
 vec4 coneTrace(vec3 direction, float aperture);
 vec4 sampleVoxels(vec3 worldPosition, float lod);
 
-float DistributionGGX(vec3 N, vec3 H, float roughness) {
-    float a = roughness * roughness;
-    float a2 = a * a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH * NdotH;
-
-    float num = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-
-    return num / denom;
-}
-
-float GeometrySchlickGGX(float NdotV, float roughness) {
-    float r = (roughness + 1.0);
-    float k = (r * r) / 8;
-
-    float num = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-
-    return num / denom;
-}
-
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness) {
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-
-    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
-
-    return ggx1 * ggx2;
-}
-
-vec3 fresnelSchlick(float cosTheta, vec3 F0) {
-    return F0 + (1 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}
-
 void main() {
     vec3 tangent = normalize(Tangent);
-    vec3 normal;
-    if (noNormal) {
-        normal = normalize(Normal);
-    } else {
-        vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
-        normal = normalize(TBN * tangentNormal);
-    }
+#ifdef HAS_NORMAL_MAP
+    vec3 tangentNormal = texture(texture_normal, TexCoords).xyz * 2.0 - 1.0;
+    vec3 normal = normalize(TBN * tangentNormal);
+#else
+    vec3 normal = normalize(Normal);
+#endif
 
+#ifdef HAS_METALLIC_MAP
     vec2 metalRough = texture(texture_metallic, TexCoords).bg;
-    float metallic, roughness;
-    if (noMetallicMap) {
-        metallic = 0.2;
-        roughness = 0.8;
-    } else {
-        metallic = metalRough.r;
-        roughness = metalRough.g;
-    }
+    float metallic = metalRough.r;
+    float roughness = metalRough.g;
+#else
+    float metallic = 0.2;
+    float roughness = 0.8;
+#endif
 
     vec3 viewDir = normalize(viewPos - FragPos);
     vec3 albedo = texture(texture_diffuse, TexCoords).rgb;
@@ -291,44 +244,5 @@ vec3 calcDirLight(vec3 normal, vec3 viewDir, vec3 albedo, float roughness, float
 }
 
 float cascadedShadowCalculation(vec3 fragPosWorldSpace, vec3 lightDir) {
-    vec4 viewSpace = view * vec4(fragPosWorldSpace, 1.0);
-    float depthValue = abs(viewSpace.z);
-
-    int layer = -1;
-    for (int i = 0; i < cascadeCount; i++) {
-        if (depthValue < cascadePlaneDistances[i]) {
-            layer = i;
-            break;
-        }
-    }
-    if (layer == -1) layer = cascadeCount;
-
-    vec4 lightSpacePos = lightSpaceMatrices[layer] * vec4(fragPosWorldSpace, 1.0);
-
-    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
-    projCoords = projCoords * 0.5 + 0.5;
-
-    float currentDepth = projCoords.z;
-    if (currentDepth > 1.0) return 0.0;
-
-    vec3 normal = normalize(Normal);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-
-    if (layer == cascadeCount) bias *= 1 / (far_plane / 0.5);
-    else bias *= 1 / (cascadePlaneDistances[layer] * 0.5);
-
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / vec2(textureSize(cascadedMap, 0));
-
-    for (int x = -1; x <= 1; x++) {
-        for (int y = -1; y <= 1; y++) {
-            float pcfDepth = texture(cascadedMap, vec3(projCoords.xy + vec2(x, y) * texelSize, layer)).r;
-            shadow += (currentDepth - bias) > pcfDepth ? 1.0 : 0.0;
-        }
-    }
-    shadow /= 9.0;
-
-    if (projCoords.z > 1.0) shadow = 0.0;
-
-    return shadow;
-}
\ No newline at end of file
+    return cascadedShadow(fragPosWorldSpace, normalize(Normal), lightDir);
+}
@@ -14,8 +14,7 @@ out vec4 FragPosLightSpace;
 out mat3 TBN;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/camera_constants.glsl"
 uniform mat4 lightSpaceMatrix;
 
 void main()
@@ -1,30 +1,27 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
-layout (location = 3) out vec4 gReflectionPosition;
-layout (location = 4) out vec2 gMetallicRoughness;
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+layout (location = 2) out vec4 gMaterial;
 
 in vec2 TexCoords;
-in vec3 FragPos;
 in vec3 Normal;
-in vec4 modelViewPos;
 
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 uniform sampler2D texture_metallic1;
 
+#include "include/octahedral.glsl"
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    gReflectionPosition = modelViewPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    // Position is rebuilt from depth, only the view space normal is stored
+    gNormal = encodeNormal(normalize(Normal));
     // and the diffuse per-fragment color
     gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb;
     // store specular intensity in gAlbedoSpec's alpha component
     gAlbedoSpec.a = texture(texture_specular1, TexCoords).r;
 
-    gMetallicRoughness = texture(texture_metallic1, TexCoords).gb;
-}
\ No newline at end of file
+    // Occlusion/roughness/metallic texture, stored as metallic, roughness, ao
+    vec3 orm = texture(texture_metallic1, TexCoords).rgb;
+    gMaterial = vec4(orm.b, orm.g, orm.r, 1.0);
+}
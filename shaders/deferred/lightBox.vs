@@ -1,13 +1,26 @@
-#version 330 core
+#version 460 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-uniform mat4 model;
+#include "include/camera_constants.glsl"
+
+struct InstanceData {
+    mat4 modelMatrix;
+    vec4 color;
+};
+
+layout (std430, binding = 11) readonly buffer InstanceBlock {
+    InstanceData instances[];
+};
+uniform uint instanceOffset;
+
+flat out vec3 lightColor;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    InstanceData instance = instances[instanceOffset + gl_InstanceID];
+    lightColor = instance.color.rgb;
+
+    gl_Position = viewProjection * instance.modelMatrix * vec4(aPos, 1.0);
 }
\ No newline at end of file
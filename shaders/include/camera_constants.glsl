@@ -0,0 +1,10 @@
+// Mirrors CameraConstants in gl_frame_constants.h
+layout (std140, binding = 1) uniform CameraConstants {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 invView;
+    mat4 invProjection;
+    vec3 viewPos;
+    vec4 clipInfo;
+};
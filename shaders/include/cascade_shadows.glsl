@@ -0,0 +1,48 @@
+#include "camera_constants.glsl"
+
+// Mirrors ShadowConstants in gl_frame_constants.h
+layout (std140, binding = 0) uniform ShadowConstants {
+    mat4 lightSpaceMatrices[16];
+    float cascadePlaneDistances[16];
+    int cascadeCount;
+    float cascadeFarPlane;
+};
+
+uniform sampler2DArray cascadedMap;
+
+// Picks the cascade from view depth and returns the 3x3 PCF shadow factor, 1 is fully shadowed
+float cascadedShadow(vec3 fragPosWorldSpace, vec3 normal, vec3 lightDir) {
+    vec4 viewSpace = view * vec4(fragPosWorldSpace, 1.0);
+    float depthValue = abs(viewSpace.z);
+
+    int layer = -1;
+    for (int i = 0; i < cascadeCount; i++) {
+        if (depthValue < cascadePlaneDistances[i]) {
+            layer = i;
+            break;
+        }
+    }
+    if (layer == -1) layer = cascadeCount;
+
+    vec4 lightSpacePos = lightSpaceMatrices[layer] * vec4(fragPosWorldSpace, 1.0);
+
+    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
+    projCoords = projCoords * 0.5 + 0.5;
+
+    float currentDepth = projCoords.z;
+    if (currentDepth > 1.0) return 0.0;
+
+    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    if (layer == cascadeCount) bias *= 1 / (cascadeFarPlane / 0.5);
+    else bias *= 1 / (cascadePlaneDistances[layer] * 0.5);
+
+    float shadow = 0.0;
+    vec2 texelSize = 1.0 / vec2(textureSize(cascadedMap, 0));
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            float pcfDepth = texture(cascadedMap, vec3(projCoords.xy + vec2(x, y) * texelSize, layer)).r;
+            shadow += (currentDepth - bias) > pcfDepth ? 1.0 : 0.0;
+        }
+    }
+    return shadow / 9.0;
+}
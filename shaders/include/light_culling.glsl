@@ -0,0 +1,29 @@
+// Shared by the clustered light culling compute shaders. The structs match ClusteredLight,
+// ClusterAABB and LightGridEntry, the bindings the ones in gl_light_bvh.h.
+
+// Lights per leaf and children per inner node
+#define BVH_BRANCHING 32
+#define BVH_MAX_LEVELS 6
+// Threads per group of bvhCull.comp, compactClusters.comp sizes the indirect dispatch with it
+#define CULL_GROUP_SIZE 64
+// Same as ClusteredEngine::maxLightsPerTile
+#define MAX_LIGHTS_PER_CLUSTER 200
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+    uint enabled;
+    float intensity;
+    float range;
+    float something;
+};
+
+struct LightGrid {
+    uint offset;
+    uint count;
+};
+
+struct AABB {
+    vec4 minPoint;
+    vec4 maxPoint;
+};
@@ -0,0 +1,42 @@
+// Mirrors MaterialParameters and the MaterialBuffer layout in material.h / gl_material_buffer.h
+struct MaterialParams {
+    vec3 baseColor;
+    float metallic;
+    vec3 emissive;
+    float roughness;
+    float ao;
+    float shininess;
+    float normalStrength;
+    uint textureMask;
+};
+
+struct Material {
+    uvec2 textureHandles[8];
+    MaterialParams params;
+};
+
+#define MATERIAL_TEXTURE_DIFFUSE 0
+#define MATERIAL_TEXTURE_SPECULAR 1
+#define MATERIAL_TEXTURE_NORMAL 2
+#define MATERIAL_TEXTURE_HEIGHT 3
+#define MATERIAL_TEXTURE_AO 4
+#define MATERIAL_TEXTURE_METALLIC 5
+#define MATERIAL_TEXTURE_ROUGHNESS 6
+
+layout (std430, binding = 7) readonly buffer materialSSBO {
+    Material materials[];
+};
+
+// Shaders enable GL_ARB_bindless_texture when they can use it, without it the handles
+// are slices of the array MaterialBuffer resamples every map into
+#ifdef GL_ARB_bindless_texture
+vec4 sampleMaterialTexture(Material material, int slot, vec2 uv) {
+    return texture(sampler2D(material.textureHandles[slot]), uv);
+}
+#else
+layout (binding = 15) uniform sampler2DArray materialTextures;
+
+vec4 sampleMaterialTexture(Material material, int slot, vec2 uv) {
+    return texture(materialTextures, vec3(uv, float(material.textureHandles[slot].x)));
+}
+#endif
@@ -1,12 +1,12 @@
 #version 460 core
-#extension GL_ARB_bindless_texture : require
+#extension GL_ARB_bindless_texture : enable
 
 out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 FragPos;
-flat in int drawID;
+flat in uint materialID;
 
 struct DirLight {
     vec3 direction;
@@ -16,17 +16,11 @@ struct DirLight {
     vec3 specular;
 };
 
-layout(binding = 0) buffer textureHandleBlock {
-    uvec2 texture_handles[409];
-};
+#include "include/material.glsl"
 
-layout(binding = 1) buffer textureLengthBlock {
-    uint textureLengths[];
-};
+#include "include/camera_constants.glsl"
 
-uniform int index;
 uniform float shininess;
-uniform vec3 viewPos;
 uniform DirLight dirLight;
 
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
@@ -37,11 +31,11 @@ vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
 
-    uint numTextures = textureLengths[drawID];
-    uvec2 handle = texture_handles[numTextures];
-    sampler2D diffuseSampler = sampler2D(handle);
-
-    vec4 albedo = texture(diffuseSampler, TexCoords);
+    Material material = materials[materialID];
+    vec4 albedo = vec4(material.params.baseColor, 1.0);
+    if ((material.params.textureMask & (1u << MATERIAL_TEXTURE_DIFFUSE)) != 0) {
+        albedo *= sampleMaterialTexture(material, MATERIAL_TEXTURE_DIFFUSE, TexCoords);
+    }
 
     vec3 ambient = light.ambient * albedo.rgb;
     vec3 specular = spec * light.specular * albedo.a;
@@ -57,7 +51,5 @@ void main()
 
     vec3 result = calcDirLight(dirLight, normal, viewDir);
 
-    vec3 value = vec3(drawID * 0.1f);
-
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
@@ -1,5 +1,4 @@
 #version 460 core
-#extension GL_ARB_bindless_texture : require
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
@@ -8,19 +7,33 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
-out int drawID;
+flat out uint materialID;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+struct DrawRecord {
+    mat4 modelMatrix;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uint materialID;
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+};
+
+layout (std430, binding = 8) readonly buffer drawRecordSSBO {
+    DrawRecord records[];
+};
+
+#include "include/camera_constants.glsl"
 
 void main()
 {
+    DrawRecord record = records[gl_BaseInstance];
+    mat4 model = record.modelMatrix;
+
     TexCoords = aTexCoords;
     Normal = mat3(transpose(inverse(model))) * aNormal;
     FragPos = vec3(model * vec4(aPos, 1.0));
-    drawID = gl_DrawID;
+    materialID = record.materialID;
     
-    gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = viewProjection * vec4(FragPos, 1.0);
+}
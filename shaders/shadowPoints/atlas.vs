@@ -0,0 +1,13 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+// One face of the light's cube, the viewport picks its tile in the atlas
+uniform mat4 faceMatrix;
+
+out vec4 FragPos;
+
+void main() {
+    FragPos = model * vec4(aPos, 1.0);
+    gl_Position = faceMatrix * FragPos;
+}
@@ -27,22 +27,24 @@ struct PointLight {
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
-uniform samplerCube shadowMaps[4];
+#define POINT_SHADOW_FACES 6
+uniform sampler2D pointShadowAtlas;
+// Per light and cube face, the face's view projection and its tile in the atlas as offset and scale
+uniform mat4 pointShadowMatrices[NR_POINT_LIGHTS * POINT_SHADOW_FACES];
+uniform vec4 pointShadowRects[NR_POINT_LIGHTS * POINT_SHADOW_FACES];
 uniform sampler2D shadowMap;
 
-uniform sampler2DArray cascadedMap;
-layout (std140, binding = 0) uniform LightSpaceMatrices {
-    mat4 lightSpaceMatrices[16];
-};
-uniform float cascadePlaneDistances[16];
-uniform int cascadeCount;
+#include "include/cascade_shadows.glsl"
 
 uniform float shininess;
 uniform float far_plane;
-uniform mat4 view;
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[4];
+
+#define MAX_FRAME_POINT_LIGHTS 32
+layout (std140, binding = 2) uniform LightConstants {
+    DirLight dirLight;
+    PointLight pointLights[MAX_FRAME_POINT_LIGHTS];
+    int numPointLights;
+};
 
 float calcShadow(vec4 fragPosLightSpace) {
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
@@ -70,27 +72,43 @@ float calcShadow(vec4 fragPosLightSpace) {
     return shadow;
 }
 
+// Cube map face order, +X, -X, +Y, -Y, +Z, -Z
+int cubeFace(vec3 direction) {
+    vec3 absDirection = abs(direction);
+    if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z) return direction.x > 0.0 ? 0 : 1;
+    if (absDirection.y >= absDirection.z) return direction.y > 0.0 ? 2 : 3;
+    return direction.z > 0.0 ? 4 : 5;
+}
+
 float shadowCubeCalculation(vec3 fragPos, int index) {
     vec3 fragToLight = fragPos - pointLights[index].position;
+    int face = index * POINT_SHADOW_FACES + cubeFace(fragToLight);
+
+    // Lights the atlas had no room for
+    vec4 rect = pointShadowRects[face];
+    if (rect.z == 0.0) return 0.0;
+
+    vec4 clipPosition = pointShadowMatrices[face] * vec4(fragPos, 1.0);
+    vec2 faceCoords = clipPosition.xy / clipPosition.w * 0.5 + 0.5;
+    vec2 atlasCoords = rect.xy + faceCoords * rect.zw;
+
+    // Taps stay inside the tile, the neighbouring ones belong to other faces and lights
+    vec2 texelSize = 1.0 / vec2(textureSize(pointShadowAtlas, 0));
+    vec2 tileMin = rect.xy + texelSize * 0.5;
+    vec2 tileMax = rect.xy + rect.zw - texelSize * 0.5;
 
     float currentDepth = length(fragToLight);
     float bias = 0.05;
-    float offset = 0.1f;
-    float samples = 4.0f;
     float shadow = 0.0f;
-
-    for (float x = -offset; x < offset; x += offset / (samples * 0.5)) {
-        for (float y = -offset; y < offset; y += offset / (samples * 0.5)) {
-            for (float z = -offset; z < offset; z += offset / (samples * 0.5)) {
-                float closestDepth = texture(shadowMaps[index], fragToLight + vec3(x, y, z)).r;
-                closestDepth *= far_plane;
-                if (currentDepth - bias > closestDepth) shadow += 1.0;
-            }
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec2 coords = clamp(atlasCoords + vec2(x, y) * texelSize * 1.5, tileMin, tileMax);
+            float closestDepth = texture(pointShadowAtlas, coords).r * far_plane;
+            if (currentDepth - bias > closestDepth) shadow += 1.0;
         }
     }
-    shadow /= (samples * samples * samples);
 
-    return shadow;
+    return shadow / 9.0;
 }
 
 vec3 calcPointLight(PointLight light, vec3 position, vec3 normal, vec3 viewDir, int index) {
@@ -109,49 +127,6 @@ vec3 calcPointLight(PointLight light, vec3 position, vec3 normal, vec3 viewDir,
     return (ambient + (1.0 - shadow) * (diffuse + specular)) * texture(texture_diffuse1, TexCoords).rgb;
 }
 
-float cascadedShadowCalculation(vec3 fragPosWorldSpace, vec3 lightDir) {
-    vec4 viewSpace = view * vec4(fragPosWorldSpace, 1.0);
-    float depthValue = abs(viewSpace.z);
-
-    int layer = -1;
-    for (int i = 0; i < cascadeCount; i++) {
-        if (depthValue < cascadePlaneDistances[i]) {
-            layer = i;
-            break;
-        }
-    }
-    if (layer == -1) layer = cascadeCount;
-
-    vec4 lightSpacePos = lightSpaceMatrices[layer] * vec4(fragPosWorldSpace, 1.0);
-
-    vec3 projCoords = lightSpacePos.xyz / lightSpacePos.w;
-    projCoords = projCoords * 0.5 + 0.5;
-
-    float currentDepth = projCoords.z;
-    if (currentDepth > 1.0) return 0.0;
-
-    vec3 normal = normalize(Normal);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
-
-    if (layer == cascadeCount) bias *= 1 / (far_plane / 0.5);
-    else bias *= 1 / (cascadePlaneDistances[layer] * 0.5);
-
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / vec2(textureSize(cascadedMap, 0));
-
-    for (int x = -1; x <= 1; x++) {
-        for (int y = -1; y <= 1; y++) {
-            float pcfDepth = texture(cascadedMap, vec3(projCoords.xy + vec2(x, y) * texelSize, layer)).r;
-            shadow += (currentDepth - bias) > pcfDepth ? 1.0 : 0.0;
-        }
-    }
-    shadow /= 9.0;
-
-    if (projCoords.z > 1.0) shadow = 0.0;
-
-    return shadow;
-}
-
 vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 lightDir = normalize(light.direction);
 
@@ -164,7 +139,7 @@ vec3 calcDirLight(DirLight light, vec3 normal, vec3 viewDir) {
     vec3 specular = spec * light.specular * texture(texture_specular1, TexCoords).rgb;
     vec3 diffuse = diff * light.diffuse * texture(texture_diffuse1, TexCoords).rgb;
 
-    float shadow = cascadedShadowCalculation(FragPos, lightDir);
+    float shadow = cascadedShadow(FragPos, normalize(Normal), lightDir);
 
     vec3 totalColor = ambient + (1.0 - shadow) * (diffuse + specular);
     return totalColor;
@@ -7,15 +7,32 @@ out vec2 TexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 
+struct InstanceData {
+    mat4 modelMatrix;
+    vec4 color;
+};
+
+// Repeated meshes come in as one instanced draw from the render queue,
+// single draws like the plane and the depth pre-pass set model instead
+layout (std430, binding = 11) readonly buffer InstanceBlock {
+    InstanceData instances[];
+};
+uniform uint instanceOffset;
+uniform bool useInstances;
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "include/camera_constants.glsl"
+
+// The depth pre-pass links this shader too, the main pass tests GL_EQUAL against its output
+invariant gl_Position;
 
 void main()
 {
+    mat4 modelMatrix = useInstances ? instances[instanceOffset + gl_InstanceID].modelMatrix : model;
+
     TexCoords = aTexCoords;
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(modelMatrix))) * aNormal;
+    FragPos = vec3(modelMatrix * vec4(aPos, 1.0));
     
     gl_Position = projection * view * vec4(FragPos, 1.0);
 }
\ No newline at end of file
@@ -7,7 +7,12 @@ layout (std140, binding = 0) uniform LightSpaceMatrices {
     mat4 lightSpaceMatrices[16];
 };
 
+// Bit per cascade the caster's bounds miss, set by the engine per draw
+uniform int culledLayers;
+
 void main() {
+    if ((culledLayers & (1 << gl_InvocationID)) != 0) return;
+
     for (int i = 0; i < 3; i++) {
         gl_Position = lightSpaceMatrices[gl_InvocationID] * gl_in[i].gl_Position;
         gl_Layer = gl_InvocationID;
@@ -1,24 +1,41 @@
-#version 330 core
+#version 460 core
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 uniform sampler2D gReflectionColor;
 
-struct Light {
-    vec3 Position;
-    vec3 Color;
-    
-    float Linear;
-    float Quadratic;
-    float Radius;
+#include "include/camera_constants.glsl"
+
+// Matches ClusteredLight, filled by the engine's LightManager
+struct PointLight {
+    vec4 position;
+    vec4 color;
+    uint enabled;
+    float intensity;
+    float range;
+    float something;
 };
-const int NR_LIGHTS = 32;
-uniform Light lights[NR_LIGHTS];
-uniform vec3 viewPos;
+
+layout (std430, binding = 3) readonly buffer lightSSBO {
+    PointLight lights[];
+};
+uniform int numLights;
+// Constant, linear and quadratic terms shared by every light
+uniform vec3 attenuationTerms;
+
+vec3 worldPositionFromDepth(vec2 uv, float depth) {
+    vec4 clipSpacePosition = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 viewSpacePosition = invProjection * clipSpacePosition;
+    viewSpacePosition /= viewSpacePosition.w;
+
+    return (invView * viewSpacePosition).xyz;
+}
+
+#include "include/octahedral.glsl"
 
 vec3 findReflectionColor(sampler2D reflectionColor, vec2 texCoords) {
     vec3 lumaDown = textureOffset(reflectionColor,texCoords,ivec2(0,-1)).rgb;
@@ -32,8 +49,8 @@ vec3 findReflectionColor(sampler2D reflectionColor, vec2 texCoords) {
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos = worldPositionFromDepth(TexCoords, texture(gDepth, TexCoords).x);
+    vec3 Normal = decodeNormal(texture(gNormal, TexCoords).xy);
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
 
@@ -45,20 +62,22 @@ void main()
     // then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.5; // hard-coded ambient component
     vec3 viewDir  = normalize(viewPos - FragPos);
-    for(int i = 0; i < NR_LIGHTS; ++i)
+    for(int i = 0; i < numLights; ++i)
     {
-        float distance = length(lights[i].Position - FragPos);
-        if(distance < lights[i].Radius) {
+        if (lights[i].enabled != 1) continue;
+
+        vec3 lightColor = lights[i].color.rgb * lights[i].intensity;
+        float distance = length(lights[i].position.xyz - FragPos);
+        if(distance < lights[i].range) {
             // diffuse
-            vec3 lightDir = normalize(lights[i].Position - FragPos);
-            vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].Color;
+            vec3 lightDir = normalize(lights[i].position.xyz - FragPos);
+            vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lightColor;
             // specular
             vec3 halfwayDir = normalize(lightDir + viewDir);  
             float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-            vec3 specular = lights[i].Color * spec * Specular;
+            vec3 specular = lightColor * spec * Specular;
             // attenuation
-            float distance = length(lights[i].Position - FragPos);
-            float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
+            float attenuation = 1.0 / (attenuationTerms.x + attenuationTerms.y * distance + attenuationTerms.z * distance * distance);
             diffuse *= attenuation;
             specular *= attenuation;
             lighting += diffuse + specular;  
@@ -5,15 +5,11 @@ layout (location = 0) out vec4 FragColor;
 noperspective in vec2 TexCoords;
 
 uniform sampler2D depthTexture;
-uniform sampler2D positionTexture;
 uniform sampler2D normalTexture;
 uniform sampler2D colorTexture;
-uniform sampler2D metallicRoughnessTexture;
+uniform sampler2D materialTexture;
 
-uniform mat4 projection;
-uniform mat4 invProjection;
-uniform mat4 view;
-uniform mat4 invView;
+#include "include/camera_constants.glsl"
 uniform mat4 invTransposeView;
 
 uniform float depthCutoff = 0.0;
@@ -34,34 +30,40 @@ vec3 binarySearch(inout vec3 dir, inout vec3 hitCoord, inout float dDepth);
 vec3 hash(vec3 a);
 vec3 fresnelSchlick(float cosTheta, vec3 F0);
 
-vec3 positionFromDepth(float depth) {
+vec3 positionFromDepth(vec2 uv, float depth) {
 	float z = depth * 2.0 - 1.0;
 
-	vec4 clipSpacePosition = vec4(TexCoords * 2.0 - 1.0, z, 1.0);
+	vec4 clipSpacePosition = vec4(uv * 2.0 - 1.0, z, 1.0);
 	vec4 viewSpacePosition = invProjection * clipSpacePosition;
 	viewSpacePosition /= viewSpacePosition.w;
 
 	return viewSpacePosition.xyz;
 }
 
+// View space z of whatever the G-buffer holds at uv
+float viewDepthAt(vec2 uv) {
+	return positionFromDepth(uv, texture(depthTexture, uv).x).z;
+}
+
+#include "include/octahedral.glsl"
+
 bool isSignificant(float dd) {
 	return dd < maxRayStep && dd > depthCutoff;
 }
 
 void main() {
-	float metallic = texture(metallicRoughnessTexture, TexCoords).g;
+	float metallic = texture(materialTexture, TexCoords).r;
 	if (metallic < 0.001) discard;
 
 	float currentDepth = texture(depthTexture, TexCoords).x;
-	vec3 depthPos = positionFromDepth(currentDepth);
 
 	if (currentDepth > 0.999999) {
 		FragColor = vec4(0.0);
 		return;
 	}
 
-	vec3 viewNormal = vec3(texture(normalTexture, TexCoords));
-	vec3 viewPos = texture(positionTexture, TexCoords).xyz;
+	vec3 viewNormal = decodeNormal(texture(normalTexture, TexCoords).xy);
+	vec3 viewPos = positionFromDepth(TexCoords, currentDepth);
 	vec3 albedo = texture(colorTexture, TexCoords).xyz;
 	float spec = texture(colorTexture, TexCoords).w;
 
@@ -104,7 +106,7 @@ vec4 rayCast(in vec3 dir, inout vec3 hitCoord, out float dDepth) {
 		projectedCoord.xy /= projectedCoord.w;
 		projectedCoord.xy = projectedCoord.xy * 0.5 + 0.5;
 
-		depth = texture(positionTexture, projectedCoord.xy).z;
+		depth = viewDepthAt(projectedCoord.xy);
 
 		if (depth > 1000.0) continue;
 
@@ -129,7 +131,7 @@ vec3 binarySearch(inout vec3 dir, inout vec3 hitCoord, inout float dDepth) {
 		projectedCoord.xy /= projectedCoord.w;
 		projectedCoord.xy = projectedCoord.xy * 0.5 + 0.5;
 
-		depth = texture(positionTexture, projectedCoord.xy).z;
+		depth = viewDepthAt(projectedCoord.xy);
 
 		dDepth = hitCoord.z - depth;
 
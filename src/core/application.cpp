@@ -72,10 +72,10 @@ void Application::init()
 
     UI::init();
 
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_STENCIL_TEST);
+    GLState::get().enable(GL_DEPTH_TEST);
+    GLState::get().enable(GL_STENCIL_TEST);
 
     camera = Camera(glm::vec3(0.0f, 5.0f, 5.0f));
     camera.aspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
@@ -101,6 +101,11 @@ void Application::init()
 
 void Application::cleanup()
 {
+    // GL objects have to go while the context is still around
+    for (Model& model : usableObjs) mRenderer->unloadModelData(model);
+    usableObjs.clear();
+    ResourceRegistry::get().flush();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
@@ -121,7 +126,9 @@ void Application::mainLoop()
         handleEvents();
         handleImportedObjs();
 
+        mRenderer->beginFrame();
         mRenderer->render(usableObjs);
+        mRenderer->endFrame();
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL2_NewFrame();
@@ -233,11 +240,12 @@ void Application::scroll_callback(double yoffset)
 
 void Application::framebuffer_callback(int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::get().viewport(0, 0, width, height);
     WINDOW_HEIGHT = height;
     WINDOW_WIDTH = width;
-    mRenderer->WINDOW_HEIGHT = height;
-    mRenderer->WINDOW_WIDTH = width;
+    mRenderer->resize(width, height);
+
+    if (height > 0) camera.aspect = (float)width / (float)height;
 }
 
 void Application::handleClick(double xposIn, double yposIn)
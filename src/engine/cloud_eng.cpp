@@ -6,8 +6,10 @@
 
 void CloudEngine::init_resources()
 {
-	worleyNoiseShader = Shader("clouds/volume.vert", "clouds/volume.frag");
-	worleyNoiseCompute = ComputeShader("clouds/worleyNoise.comp");
+	ShaderManager& shaders = ShaderManager::get();
+	shaders.load(worleyNoiseShader, "clouds/volume.vert", "clouds/volume.frag");
+	shaders.load(worleyNoiseCompute, "clouds/worleyNoise.comp");
+	shaders.finish();
 	cubeBuffer = glutil::createUnitCube();
 
 	worleyNoiseTexture = glutil::createTexture3D(worleyNoiseDimensions.x, worleyNoiseDimensions.y,
@@ -53,13 +55,13 @@ void CloudEngine::render(std::vector<Model>& objs)
 	worleyNoiseShader.setVec3("backgroundColor", glm::vec3(1.0f, 0.0f, 0.0));
 	worleyNoiseShader.setVec4("phaseParams", phaseParams);
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_3D, worleyNoiseTexture);
+	GLState::get().bindTexture(0, GL_TEXTURE_3D, worleyNoiseTexture);
 	worleyNoiseShader.setFloat("layer", layer);
 	worleyNoiseShader.setInt("worleyNoiseTexture", 0);
 
-	glBindVertexArray(cubeBuffer.VAO);
+	GLState::get().bindVertexArray(cubeBuffer.VAO);
 	glDrawArrays(GL_TRIANGLES, 0, 36);
+	GLState::get().recordDraw();
 }
 
 void CloudEngine::handleImGui()
@@ -1,8 +1,10 @@
 #include "gl_base_engine.h"
 #include "utils/gl_funcs.h"
 
+#include <bitset>
 #include <iostream>
 #include <iterator>
+#include <limits>
 #include <SDL.h>
 #include <thread>
 #include <future>
@@ -17,11 +19,43 @@
 void GLEngine::init_resources() {}
 void render(std::vector<Model>& objs) {}
 
-void GLEngine::drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions) {
+void GLEngine::updateAnimations(std::vector<Model>& models) {
+    if (animatedFrame == frameConstants.time.frameIndex) return;
+    animatedFrame = frameConstants.time.frameIndex;
+
+    for (Model& model : models) {
+        if (model.scene == nullptr || model.scene->mAnimations <= 0) continue;
+
+        for (Mesh& mesh : model.meshes) {
+            if (mesh.bone_data.size() == 0) continue;
+            mesh.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
+        }
+    }
+}
+
+void GLEngine::prepareVariants(std::vector<Model>& models, ShaderVariants& variants, ShaderFeatures features) {
+    variants.get(features);
+    for (Model& model : models) {
+        for (const Material& material : model.materials_loaded) variants.get(features | material.getShaderFeatures());
+    }
+}
+
+void GLEngine::recordModels(RenderQueue& queue, CommandBuffer& commands, std::vector<Model>& models,
+    const Shader& shader, unsigned char drawOptions, const ShaderVariants* variants, ShaderFeatures features) const {
+    submitModels(queue, models, shader, drawOptions, variants, features);
+    recordQueue(queue, commands, drawOptions);
+}
+
+void GLEngine::submitModels(RenderQueue& queue, std::vector<Model>& models, const Shader& shader,
+    unsigned char drawOptions, const ShaderVariants* variants, ShaderFeatures features) const {
     bool shouldSkipTextures = drawOptions & SKIP_TEXTURES;
     bool shouldSkipCulling = drawOptions & SKIP_CULLING;
+    RenderPassType pass = shouldSkipTextures ? PASS_SHADOW : PASS_OPAQUE;
 
-    for (Model& model : models) {
+    queue.clear();
+
+    for (size_t modelIndex = 0; modelIndex < models.size(); modelIndex++) {
+        Model& model = models[modelIndex];
         if (!shouldSkipCulling) {
             glm::vec4 transformedMax = model.model_matrix * model.aabb.maxPoint;
             glm::vec4 transformedMin = model.model_matrix * model.aabb.minPoint;
@@ -33,58 +67,230 @@ void GLEngine::drawModels(std::vector<Model>& models, Shader& shader, unsigned c
             Mesh& mesh = model.meshes[j];
 
             glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
+            glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
+            glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
             if (!shouldSkipCulling) {
-                glm::vec4 meshMin = finalModelMatrix * mesh.aabb.minPoint;
-                glm::vec4 meshMax = finalModelMatrix * mesh.aabb.maxPoint;
                 bool shouldDraw = camera->isInsideFrustum(meshMax, meshMin);
                 if (!shouldDraw) continue;
             }
 
-            shader.setMat4("model", finalModelMatrix);
-            if (!shouldSkipTextures) {
-                Material material = model.materials_loaded[mesh.materialIndex];
-
-                if (material.textures.size() != 4) {
-                    shader.setBool("noMetallicMap", true);
-                    shader.setBool("noNormalMap", true);
-                } else {
-                    shader.setBool("noMetallicMap", false);
-                    shader.setBool("noNormalMap", false);
-                }
-
-                for (unsigned int i = 0; i < material.textures.size(); i++) {
-                    glActiveTexture(GL_TEXTURE0 + i);
-
-                    string number;
-                    string name = material.textures[i].type;
-
-                    string key = name;
-                    shader.setInt(key.c_str(), i);
-
-                    glBindTexture(GL_TEXTURE_2D, material.textures[i].id);
-                }
-                glActiveTexture(GL_TEXTURE0);
-
-                if (mesh.bone_data.size() != 0 && model.scene->mAnimations > 0) {
-                    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, mesh.SSBO);
-
-                    mesh.getBoneTransforms(animationTime, model.scene, model.nodes, chosenAnimation);
-                    std::string boneString = "boneMatrices[";
-                    for (unsigned int i = 0; i < mesh.bone_info.size(); i++) {
-                        shader.setMat4(boneString + std::to_string(i) + "]", 
-                            mesh.bone_info[i].finalTransform);
-                    }
-                }
+            glm::vec3 center = glm::vec3(meshMin + meshMax) * 0.5f;
+            float depth = glm::dot(center - camera->Position, camera->Front) / camera->zFar;
+            const Material& material = model.materials_loaded[mesh.materialIndex];
+            unsigned int materialID = shouldSkipTextures ? 0 : material.materialID;
+
+            const Shader* meshShader = &shader;
+            if (variants != nullptr) {
+                const Shader* variant = variants->find(features | (shouldSkipTextures ? 0 : material.getShaderFeatures()));
+                if (variant != nullptr) meshShader = variant;
             }
 
-            glBindVertexArray(mesh.buffer.VAO);
-            glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            DrawItem item;
+            item.sortKey = RenderQueue::createSortKey(pass, meshShader->ID, materialID, mesh.geometry.firstIndex, depth);
+            item.program = meshShader->ID;
+            item.reflection = &meshShader->getReflection();
+            item.VAO = geometryArena.getVAO();
+            item.indexCount = mesh.geometry.indexCount;
+            item.firstIndex = mesh.geometry.firstIndex;
+            item.baseVertex = mesh.geometry.baseVertex;
+            item.material = shouldSkipTextures ? nullptr : &material;
+            item.modelMatrix = finalModelMatrix;
+            item.model = &model;
+            item.mesh = &mesh;
+
+            queue.submit(item);
         }
     }
+
+    queue.sort();
+}
+
+ShadowCullingStats GLEngine::submitShadowCasters(RenderQueue& queue, std::vector<Model>& models, const Shader& shader,
+    const std::vector<ShadowVolume>& volumes, const std::function<bool(size_t)>& filter, uint32_t activeLayers) const {
+    ShadowCullingStats stats;
+    queue.clear();
+
+    for (size_t modelIndex = 0; modelIndex < models.size(); modelIndex++) {
+        if (filter && !filter(modelIndex)) continue;
+
+        Model& model = models[modelIndex];
+        glm::vec3 modelMin, modelMax;
+        transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, modelMin, modelMax);
+        uint32_t modelMask = getLayerMask(volumes, modelMin, modelMax) & activeLayers;
+
+        for (Mesh& mesh : model.meshes) {
+            stats.casters++;
+            stats.possibleLayerDraws += volumes.size();
+            if (modelMask == 0) {
+                stats.culledCasters++;
+                continue;
+            }
+
+            glm::mat4 finalModelMatrix = mesh.model_matrix * model.model_matrix;
+            glm::vec3 meshMin, meshMax;
+            transformBounds(finalModelMatrix, mesh.aabb.minPoint, mesh.aabb.maxPoint, meshMin, meshMax);
+            uint32_t layerMask = modelMask & getLayerMask(volumes, meshMin, meshMax);
+            if (layerMask == 0) {
+                stats.culledCasters++;
+                continue;
+            }
+            stats.layerDraws += std::bitset<MAX_SHADOW_LAYERS>(layerMask).count();
+
+            DrawItem item;
+            item.sortKey = RenderQueue::createSortKey(PASS_SHADOW, shader.ID, 0, mesh.geometry.firstIndex, 0.0f);
+            item.program = shader.ID;
+            item.reflection = &shader.getReflection();
+            item.VAO = geometryArena.getVAO();
+            item.indexCount = mesh.geometry.indexCount;
+            item.firstIndex = mesh.geometry.firstIndex;
+            item.baseVertex = mesh.geometry.baseVertex;
+            item.modelMatrix = finalModelMatrix;
+            item.layerMask = layerMask;
+            item.model = &model;
+            item.mesh = &mesh;
+
+            queue.submit(item);
+        }
+    }
+
+    queue.sort();
+    return stats;
+}
+
+void GLEngine::recordQueue(RenderQueue& queue, CommandBuffer& commands, unsigned char drawOptions) const {
+    bool shouldSkipTextures = drawOptions & SKIP_TEXTURES;
+    queue.record(commands, [&](const DrawItem& item, CommandBuffer& commands) {
+        recordDrawUniforms(item, commands, !shouldSkipTextures);
+    });
+}
+
+void GLEngine::recordDepthPrePass(RenderQueue& queue, CommandBuffer& commands, const Shader& shader) const {
+    queue.recordDepthOnly(commands, shader.ID, &shader.getReflection(), [&](const DrawItem& item, CommandBuffer& commands) {
+        recordDrawUniforms(item, commands, true);
+    });
+}
+
+void GLEngine::recordDrawUniforms(const DrawItem& item, CommandBuffer& commands, bool bindBones) const {
+    const ProgramReflection& reflection = *item.reflection;
+    commands.setMat4(item.program, reflection.getLocation("model"_u), item.modelMatrix);
+    commands.setInt(item.program, reflection.getLocation("culledLayers"_u), (int) ~item.layerMask);
+    if (!bindBones) return;
+
+    const Mesh& mesh = *item.mesh;
+    const Model& model = *item.model;
+    if (mesh.bone_data.size() != 0 && model.scene->mAnimations > 0) {
+        commands.bindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, mesh.SSBO);
+        for (unsigned int i = 0; i < mesh.bone_info.size(); i++) {
+            commands.setMat4(item.program, reflection.getLocation(uniformArray("boneMatrices", i)), mesh.bone_info[i].finalTransform);
+        }
+    }
+}
+
+void GLEngine::drawModels(std::vector<Model>& models, Shader& shader, unsigned char drawOptions) {
+    updateAnimations(models);
+
+    modelCommands.reset();
+    recordModels(renderQueue, modelCommands, models, shader, drawOptions);
+    modelCommands.execute();
+}
+
+void GLEngine::drawModels(std::vector<Model>& models, ShaderVariants& variants, ShaderFeatures features, unsigned char drawOptions) {
+    updateAnimations(models);
+    prepareVariants(models, variants, features);
+
+    modelCommands.reset();
+    recordModels(renderQueue, modelCommands, models, variants.get(features), drawOptions, &variants, features);
+    modelCommands.execute();
+}
+
+ShadowCullingStats GLEngine::drawShadowCasters(std::vector<Model>& models, Shader& shader, const std::vector<ShadowVolume>& volumes,
+    uint32_t activeLayers) {
+    updateAnimations(models);
+
+    modelCommands.reset();
+    ShadowCullingStats stats = submitShadowCasters(renderQueue, models, shader, volumes, nullptr, activeLayers);
+    recordQueue(renderQueue, modelCommands, SKIP_TEXTURES);
+    modelCommands.execute();
+    return stats;
+}
+
+void GLEngine::getCasterBounds(const std::vector<Model>& models, glm::vec3& boundsMin, glm::vec3& boundsMax) const {
+    boundsMin = glm::vec3(std::numeric_limits<float>::max());
+    boundsMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (const Model& model : models) {
+        glm::vec3 modelMin, modelMax;
+        transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, modelMin, modelMax);
+        boundsMin = glm::min(boundsMin, modelMin);
+        boundsMax = glm::max(boundsMax, modelMax);
+    }
+}
+
+std::vector<CascadeFit> GLEngine::fitCascades(const std::vector<Model>& models, const DepthReduction* depthReduction,
+    float nearPlane, float farPlane, float splitWeight, float aspect, const glm::vec3& lightDirection, int resolution,
+    std::vector<float>& cascadeLevels, float& cascadeNear, float& cascadeFar,
+    const glm::vec3& extraCasterMin, const glm::vec3& extraCasterMax) const {
+    cascadeNear = nearPlane;
+    cascadeFar = farPlane;
+
+    float minDepth, maxDepth;
+    if (depthReduction != nullptr && depthReduction->getRange(minDepth, maxDepth)) {
+        float padding = (maxDepth - minDepth) * CASCADE_RANGE_PADDING;
+        cascadeNear = std::max(nearPlane, minDepth - padding);
+        cascadeFar = std::min(farPlane, maxDepth + padding);
+    }
+
+    int cascadeCount = cascadeLevels.size() + 1;
+    cascadeLevels = computeCascadeSplits(cascadeNear, cascadeFar, cascadeCount, splitWeight);
+
+    glm::vec3 casterMin, casterMax;
+    getCasterBounds(models, casterMin, casterMax);
+    casterMin = glm::min(casterMin, extraCasterMin);
+    casterMax = glm::max(casterMax, extraCasterMax);
+
+    std::vector<CascadeFit> result;
+    glm::mat4 view = camera->getViewMatrix();
+    for (int i = 0; i < cascadeCount; i++) {
+        float sliceNear = i == 0 ? cascadeNear : cascadeLevels[i - 1];
+        float sliceFar = i == cascadeCount - 1 ? cascadeFar : cascadeLevels[i];
+        result.push_back(fitCascade(view, glm::radians(camera->Zoom), aspect, sliceNear, sliceFar,
+            lightDirection, casterMin, casterMax, resolution));
+    }
+
+    return result;
+}
+
+void GLEngine::beginFrame() {
+    ResourceRegistry::get().collect();
+    GLState::get().beginFrame();
+    ShaderManager::get().update();
+    renderQueue.beginFrame();
+    frameConstants.nextFrame();
+    materialBuffer.upload();
+
+    unsigned int ticks = SDL_GetTicks();
+    frameConstants.time.time = ticks / 1000.0f;
+    frameConstants.time.deltaTime = lastFrameTicks == 0 ? 0.0f : (ticks - lastFrameTicks) / 1000.0f;
+    frameConstants.time.frameIndex++;
+    lastFrameTicks = ticks;
+
+    if (resolution.update(frameTimer.getMilliseconds())) resize_resources();
+    frameTimer.begin();
+}
+
+void GLEngine::endFrame() {
+    frameTimer.end();
+}
+
+void GLEngine::resize(int width, int height) {
+    WINDOW_WIDTH = width;
+    WINDOW_HEIGHT = height;
+    resolution.setWindowSize(width, height);
 }
 
 void GLEngine::loadModelData(Model& model) {
+    if (model.id == 0) model.id = nextModelID++;
+
     for (auto& info : model.textures_loaded) {
         Texture& texture = info.second;
         int levels = (texture.type == "texture_normal" || texture.width < 16) ? 1 : 4;
@@ -102,15 +308,41 @@ void GLEngine::loadModelData(Model& model) {
             material.textures.push_back(texture);
         }
     }
+    materialBuffer.compile(model.materials_loaded);
 
-    for (Mesh& mesh : model.meshes) {
+    if (geometryArena.getVAO() == 0) {
         std::vector<VertexType> endpoints = {POSITION, NORMAL, TEXCOORDS, TANGENT, BI_TANGENT, VERTEX_ID};
-        mesh.buffer = glutil::loadVertexBuffer(mesh.vertices, mesh.indices, endpoints);
-        
+        geometryArena.init(endpoints, GEOMETRY_ARENA_VERTICES, GEOMETRY_ARENA_INDICES);
+    }
+
+    for (Mesh& mesh : model.meshes) {
+        mesh.geometry = geometryArena.allocate(mesh.vertices, mesh.indices);
+
         if (mesh.bone_data.size() != 0 && model.scene->mAnimations > 0) {
             glCreateBuffers(1, &mesh.SSBO);
             glNamedBufferStorage(mesh.SSBO, sizeof(VertexBoneData) * mesh.bone_data.size(),
                 mesh.bone_data.data(), GL_DYNAMIC_STORAGE_BIT);
+            ResourceRegistry::get().trackBuffer(mesh.SSBO, sizeof(VertexBoneData) * mesh.bone_data.size(),
+                GL_DYNAMIC_STORAGE_BIT, "bone data");
         }
     }
+    geometryArena.flushUploads();
+}
+
+void GLEngine::unloadModelData(Model& model) {
+    ResourceRegistry& registry = ResourceRegistry::get();
+
+    for (Mesh& mesh : model.meshes) {
+        geometryArena.free(mesh.geometry);
+        registry.release(RESOURCE_BUFFER, mesh.SSBO);
+        mesh.SSBO = 0;
+    }
+
+    // Handles go non-resident and slices free up before the textures behind them are deleted
+    materialBuffer.release(model.materials_loaded);
+    for (auto& info : model.textures_loaded) {
+        registry.release(RESOURCE_TEXTURE, info.second.id);
+        info.second.id = 0;
+    }
+    for (Material& material : model.materials_loaded) material.textures.clear();
 }
\ No newline at end of file
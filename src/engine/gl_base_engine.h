@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <SDL.h>
+#include <limits>
 #include <vector>
 
 #include "utils/gl_types.h"
@@ -10,6 +11,20 @@
 #include "utils/camera.h"
 #include "utils/gl_model.h"
 #include "utils/gl_funcs.h"
+#include "utils/gl_render_queue.h"
+#include "utils/gl_frame_constants.h"
+#include "utils/gl_material_buffer.h"
+#include "utils/gl_geometry_arena.h"
+#include "utils/gl_resources.h"
+#include "utils/gl_gpu_timer.h"
+#include "utils/gl_render_resolution.h"
+#include "utils/gl_state.h"
+#include "utils/cascade_fitting.h"
+#include "utils/gl_depth_reduction.h"
+#include "utils/gl_command_buffer.h"
+#include "utils/thread_pool.h"
+#include "utils/gl_program_cache.h"
+#include "utils/gl_shader_manager.h"
 
 #include "ui/editor.h"
 
@@ -19,6 +34,9 @@
 #include "imgui/imgui_stdlib.h"
 #include "ImGuizmo.h"
 
+#define GEOMETRY_ARENA_VERTICES (1 << 20)
+#define GEOMETRY_ARENA_INDICES (3 << 20)
+
 enum DrawOptions {
     SKIP_TEXTURES = (1u << 0),
     SKIP_CULLING = (1u << 1)
@@ -40,18 +58,18 @@ struct EnviornmentCubemap {
 
     void draw(glm::mat4 &projection, glm::mat4 &view) {
         glm::mat4 convertedView = glm::mat4(glm::mat3(view));
-        glDepthFunc(GL_LEQUAL);
+        GLState::get().depthFunc(GL_LEQUAL);
             pipeline.use();
             pipeline.setMat4("projection", projection);
             pipeline.setMat4("view", convertedView);
 
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+            GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, texture);
             pipeline.setInt("skybox", 0);
 
-            glBindVertexArray(buffer.VAO);
+            GLState::get().bindVertexArray(buffer.VAO);
             glDrawArrays(GL_TRIANGLES, 0, 36);
-        glDepthFunc(GL_LESS);
+            GLState::get().recordDraw();
+        GLState::get().depthFunc(GL_LESS);
     }
 };
 
@@ -65,8 +83,9 @@ struct ScreenQuad {
     }
 
     void draw() {
-        glBindVertexArray(buffer.VAO);
+        GLState::get().bindVertexArray(buffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLState::get().recordDraw();
     }
 };
 
@@ -76,8 +95,21 @@ class GLEngine {
         virtual void render(std::vector<Model> &objs) = 0;
         virtual void handleImGui() = 0;
         virtual void handleObjs(std::vector<Model> &objs) {}
+        // Engine specific counters, drawn at the end of the editor's Stats tab
+        virtual void handleStatsImGui() {}
 
         void loadModelData(Model& model);
+        void unloadModelData(Model& model);
+        void beginFrame();
+        void endFrame();
+        // Window resizes, size dependent targets are recreated at the start of the next frame
+        void resize(int width, int height);
+        void updateMaterial(const Material& material) { materialBuffer.update(material); }
+
+        const RenderQueueStats& getQueueStats() const { return renderQueue.getLastFrameStats(); }
+        GeometryArenaStats getGeometryStats() const { return geometryArena.getStats(); }
+        RenderResolution& getResolution() { return resolution; }
+        float getGPUFrameTime() const { return frameTimer.getMilliseconds(); }
 
         Camera* camera = nullptr;
         int WINDOW_WIDTH = 1920, WINDOW_HEIGHT = 1080;
@@ -88,6 +120,60 @@ class GLEngine {
         float animationTime = 0.0f;
         int chosenAnimation = 0;
 
+        RenderQueue renderQueue;
+        CommandBuffer modelCommands;
+        FrameConstants frameConstants;
+        MaterialBuffer materialBuffer;
+        GeometryArena geometryArena;
+        unsigned int lastFrameTicks = 0;
+        unsigned int nextModelID = 1;
+        unsigned int animatedFrame = 0;
+
+        RenderResolution resolution;
+        GPUTimer frameTimer;
+
+        // Called when the render size changes, engines recreate anything sized to the screen here
+        virtual void resize_resources() {}
+
+        // Poses animated meshes once per frame, call on the GL thread before recording passes in parallel
+        void updateAnimations(std::vector<Model> &models);
+        // Builds the variant every material in models needs on top of features, GL thread only
+        void prepareVariants(std::vector<Model> &models, ShaderVariants& variants, ShaderFeatures features);
+        // Culls, sorts and records the models into commands. Touches neither GL nor the models,
+        // so passes can record on worker threads, each with its own queue. With variants, each mesh
+        // draws with the variant for features plus its material's maps, falling back to shader.
+        void recordModels(RenderQueue& queue, CommandBuffer& commands, std::vector<Model> &models,
+            const Shader& shader, unsigned char drawOptions = 0,
+            const ShaderVariants* variants = nullptr, ShaderFeatures features = 0) const;
+        // The two halves of recordModels, for passes that record one culled queue more than once
+        void submitModels(RenderQueue& queue, std::vector<Model> &models, const Shader& shader,
+            unsigned char drawOptions = 0, const ShaderVariants* variants = nullptr, ShaderFeatures features = 0) const;
+        void recordQueue(RenderQueue& queue, CommandBuffer& commands, unsigned char drawOptions = 0) const;
+        // Shadow pass version of submitModels, culls against the light's volumes instead of the camera so
+        // casters outside the view still land in the layers they reach. Each item keeps the mask of volumes
+        // it touches, and shaders with a culledLayers uniform emit nothing for the other layers.
+        // With a filter, only models whose index it accepts are considered. Layers outside activeLayers
+        // are treated as missed, for passes that keep some layers from earlier frames.
+        ShadowCullingStats submitShadowCasters(RenderQueue& queue, std::vector<Model> &models, const Shader& shader,
+            const std::vector<ShadowVolume>& volumes, const std::function<bool(size_t)>& filter = nullptr,
+            uint32_t activeLayers = ALL_SHADOW_LAYERS) const;
+        // Replays what submitModels left in queue through shader, depth only. Skinned meshes still
+        // get their bones so depth matches a main pass that poses them.
+        void recordDepthPrePass(RenderQueue& queue, CommandBuffer& commands, const Shader& shader) const;
+        void recordDrawUniforms(const DrawItem& item, CommandBuffer& commands, bool bindBones) const;
         void drawModels(std::vector<Model> &models, Shader& shader, unsigned char drawOptions = 0);
+        void drawModels(std::vector<Model> &models, ShaderVariants& variants, ShaderFeatures features, unsigned char drawOptions = 0);
+        ShadowCullingStats drawShadowCasters(std::vector<Model> &models, Shader& shader, const std::vector<ShadowVolume>& volumes,
+            uint32_t activeLayers = ALL_SHADOW_LAYERS);
+        // World space box around every model, min above max when there are none
+        void getCasterBounds(const std::vector<Model> &models, glm::vec3& boundsMin, glm::vec3& boundsMax) const;
+        // Splits the camera range into cascadeLevels.size() + 1 slices and fits a light matrix to each. The
+        // range narrows to what depthReduction last saw when one is given. extraCasterMin/Max cover geometry
+        // drawn outside the models, the defaults are an empty box.
+        std::vector<CascadeFit> fitCascades(const std::vector<Model> &models, const DepthReduction* depthReduction,
+            float nearPlane, float farPlane, float splitWeight, float aspect, const glm::vec3& lightDirection, int resolution,
+            std::vector<float>& cascadeLevels, float& cascadeNear, float& cascadeFar,
+            const glm::vec3& extraCasterMin = glm::vec3(std::numeric_limits<float>::max()),
+            const glm::vec3& extraCasterMax = glm::vec3(std::numeric_limits<float>::lowest())) const;
         void drawPlane();
 };
\ No newline at end of file
@@ -8,14 +8,19 @@
 #include "ImGuizmo.h"
 
 #include "glm/gtx/string_cast.hpp"
+#include <algorithm>
 #include <random>
 
 void ClusteredEngine::init_resources() {
-    tileCreateCompute = ComputeShader("clustered/tileCreate.comp");
-    clusterLightCompute = ComputeShader("clustered/clusterLights.comp");
-    renderPipeline = Shader("clustered/lighting.vs", "clustered/pbr.fs");
-    gBufferPipeline = Shader("deferred/gbuffer.vs", "deferred/gbuffer.fs");
-    lightBoxPipeline = Shader("deferred/lightBox.vs", "deferred/lightBox.fs");
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(tileCreateCompute, "clustered/tileCreate.comp");
+    shaders.load(clusterLightCompute, "clustered/clusterLights.comp");
+    renderPipeline = ShaderVariants("clustered/lighting.vs", "clustered/pbr.fs");
+    shaders.load(gBufferPipeline, "deferred/gbuffer.vs", "deferred/gbuffer.fs");
+    shaders.load(depthPipeline, "clustered/depth.vs", "shadows/map.fs");
+    shaders.load(lightBoxPipeline, "deferred/lightBox.vs", "deferred/lightBox.fs");
+    lightBVH.init(numClusters);
+    shaders.finish();
 
     quadBuffer = glutil::createScreenQuad();
     cubeBuffer = glutil::createUnitCube();
@@ -23,141 +28,291 @@ void ClusteredEngine::init_resources() {
     directionalLight.direction = glm::vec3(0.0f, 1.0f, 0.0f);
     directionalLight.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
 
-    std::random_device rd;
-    std::mt19937 mt(rd());
-    std::uniform_real_distribution<float> color_dist(0.5f, 1.0f);
-    std::uniform_real_distribution<float> pos_dist(-50.f, 50.f);
-    std::uniform_real_distribution<float> posy_dist(0.0f, 100.0f);
-    std::uniform_real_distribution<float> posz_dist(-50.f, 50.f);
-    std::uniform_real_distribution<float> radius_dist(15.0f, 35.0f);
-
-    for (unsigned i = 0; i < numLights; i++) {
-        ClusteredLight light;
-        light.color = glm::vec4(color_dist(mt), color_dist(mt), color_dist(mt), 1.0f);
-        light.position = glm::vec4(pos_dist(mt), posy_dist(mt), posz_dist(mt), 1.0f);
-        light.enabled = 1;
-        light.intensity = 0.1f;
-        light.range = 40.0f;
-
-        lights.push_back(light);
-    }
     float value = log2(camera->zFar / camera->zNear);
     scale = gridSizeZ / value;
     bias = gridSizeZ * log2(camera->zNear) / value;
 
-    glCreateFramebuffers(1, &deferredFBO);
+    // clusterLights.comp runs a 16x9x4 group that shares one light per thread
+    int maxInvocations = 0, maxSharedMemory = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    glGetIntegerv(GL_MAX_COMPUTE_SHARED_MEMORY_SIZE, &maxSharedMemory);
+    unsigned int groupSize = gridSizeX * gridSizeY * 4;
+    useCPUCulling = maxInvocations < (int) groupSize || maxSharedMemory < (int) ((groupSize + 1) * sizeof(ClusteredLight));
+    if (useCPUCulling) std::cout << "WARNING::CLUSTERED::CPU_LIGHT_CULLING compute limits are too low for clusterLights.comp" << std::endl;
+
+    deferredFBO = glutil::createFramebuffer("clustered gbuffer");
+    depthFBO = glutil::createFramebuffer("clustered depth pre-pass");
+    createRenderTargets();
 
-    gPosition = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr);
-    gNormal = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr);
-    gAlbedo = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA8, nullptr);
+    init_SSBOs();
+    createLights(numLights);
+}
+
+void ClusteredEngine::resize_resources() {
+    // Nothing exists yet when the first frame sees the initial size
+    if (deferredFBO == 0) return;
+
+    createRenderTargets();
+    updateScreenToView();
+}
 
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT0, gPosition, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT1, gNormal, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT2, gAlbedo, 0);
+void ClusteredEngine::createRenderTargets() {
+    // Same compact layout as DeferredEngine: octahedral normals, albedo/spec, metallic/roughness/ao,
+    // and a sampleable depth texture to rebuild positions from
+    gNormal = TextureHandle(glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_SHORT, GL_RG, GL_RG16, nullptr, 1));
+    gAlbedo = TextureHandle(glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA8, nullptr, 1));
+    gMaterial = TextureHandle(glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA8, nullptr, 1));
+    gDepth = TextureHandle(glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT32F, nullptr, 1));
+
+    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT0, gNormal, 0);
+    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT1, gAlbedo, 0);
+    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT2, gMaterial, 0);
+    glNamedFramebufferTexture(deferredFBO, GL_DEPTH_ATTACHMENT, gDepth, 0);
+    glNamedFramebufferTexture(depthFBO, GL_DEPTH_ATTACHMENT, gDepth, 0);
+    glNamedFramebufferDrawBuffer(depthFBO, GL_NONE);
 
     unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
     glNamedFramebufferDrawBuffers(deferredFBO, 3, attachments);
-
-    unsigned int rboDepth;
-    glCreateRenderbuffers(1, &rboDepth);
-    glNamedRenderbufferStorage(rboDepth, GL_DEPTH_COMPONENT, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glNamedFramebufferRenderbuffer(deferredFBO, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
     
     if (glCheckNamedFramebufferStatus(deferredFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cout << "Framebuffer not complete! " << std::endl;
     }
-
-    init_SSBOs();
 }
 
 void ClusteredEngine::init_SSBOs() {
-    unsigned int sizeX = (unsigned int) std::ceilf(WINDOW_WIDTH / (float)gridSizeX);
-    unsigned int sizeY = (unsigned int) std::ceilf(WINDOW_HEIGHT / (float)gridSizeY);
-    glCreateBuffers(1, &AABBGridSSBO);
-    glNamedBufferData(AABBGridSSBO, sizeof(glm::vec4) * 2 * numClusters, nullptr, GL_STATIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, AABBGridSSBO);
+    // pbr.fs falls off with 1 / (1 + d^2) and scales every light by the multiplier
+    lights.init(3);
+    lights.setAttenuation(LightAttenuation(), lightCutoff / lightMultiplier);
 
-    glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)WINDOW_WIDTH/ (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+    AABBGridSSBO = glutil::createBuffer(sizeof(glm::vec4) * 2 * numClusters, nullptr, GL_STATIC_DRAW, "cluster AABBs");
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, AABBGridSSBO);
 
-    ScreenToView info;
-    info.inverseProj = glm::inverse(projection);
-    info.screenDimensions = glm::uvec2(WINDOW_WIDTH, WINDOW_HEIGHT);
-    info.tileSizes = glm::uvec4(gridSizeX, gridSizeY, gridSizeZ, sizeX);
-    info.tileScreenSizes = glm::uvec2(sizeX, sizeY);
-    glCreateBuffers(1, &screenToViewSSBO);
-    glNamedBufferData(screenToViewSSBO, sizeof(ScreenToView), &info, GL_STATIC_DRAW);
+    screenToViewSSBO = glutil::createBuffer(sizeof(ScreenToView), nullptr, GL_STATIC_DRAW, "screen to view");
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, screenToViewSSBO);
-
-    glCreateBuffers(1, &lightSSBO);
-    glNamedBufferData(lightSSBO, maxLights * sizeof(ClusteredLight), lights.data(), GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lightSSBO);
+    updateScreenToView();
 
     unsigned int totalNumLights = numClusters * maxLightsPerTile;
-    glCreateBuffers(1, &lightIndicesSSBO);
-    glNamedBufferData(lightIndicesSSBO, totalNumLights * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+    lightIndicesSSBO = glutil::createBuffer(totalNumLights * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW, "light indices");
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, lightIndicesSSBO);
 
-    glCreateBuffers(1, &lightGridSSBO);
-    glNamedBufferData(lightGridSSBO, numClusters * 2 * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+    lightGridSSBO = glutil::createBuffer(numClusters * 2 * sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW, "light grid");
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, lightGridSSBO);
 
-    glCreateBuffers(1, &lightGlobalCountSSBO);
-    glNamedBufferData(lightGlobalCountSSBO, sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW);
+    lightGlobalCountSSBO = glutil::createBuffer(sizeof(unsigned int), nullptr, GL_DYNAMIC_DRAW, "light count");
     glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, lightGlobalCountSSBO);
 }
 
+void ClusteredEngine::createLights(unsigned int count) {
+    std::random_device rd;
+    std::mt19937 mt(rd());
+    std::uniform_real_distribution<float> color_dist(0.5f, 1.0f);
+    std::uniform_real_distribution<float> pos_dist(-50.f, 50.f);
+    std::uniform_real_distribution<float> posy_dist(0.0f, 100.0f);
+    std::uniform_real_distribution<float> posz_dist(-50.f, 50.f);
+
+    lights.clear();
+    lightIDs.clear();
+    lightOrigins.clear();
+    for (unsigned i = 0; i < count; i++) {
+        glm::vec3 color = glm::vec3(color_dist(mt), color_dist(mt), color_dist(mt));
+        glm::vec3 position = glm::vec3(pos_dist(mt), posy_dist(mt), posz_dist(mt));
+
+        lightIDs.push_back(lights.addLight(position, color));
+        lightOrigins.push_back(position);
+    }
+}
+
+void ClusteredEngine::updateLights() {
+    float time = SDL_GetTicks() / 1000.0f;
+    unsigned int numMoving = std::min((unsigned int) movingLights, (unsigned int) lightIDs.size());
+    for (unsigned int i = 0; i < numMoving; i++) {
+        glm::vec3 offset = glm::vec3(std::sin(time + i), std::cos(time * 0.5f + i), std::cos(time + i)) * 5.0f;
+        lights.moveLight(lightIDs[i], lightOrigins[i] + offset);
+    }
+
+    if (lights.update()) lightBoxesDirty = true;
+    lights.bind();
+}
+
+// Tile sizes and the inverse projection depend on the window, tileCreate rebuilds the AABBs from them every frame
+void ClusteredEngine::updateScreenToView() {
+    unsigned int sizeX = (unsigned int) std::ceilf(WINDOW_WIDTH / (float)gridSizeX);
+    unsigned int sizeY = (unsigned int) std::ceilf(WINDOW_HEIGHT / (float)gridSizeY);
+
+    glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)WINDOW_WIDTH/ (float)WINDOW_HEIGHT, 0.1f, 100.0f);
+
+    screenToView.inverseProj = glm::inverse(projection);
+    screenToView.screenDimensions = glm::uvec2(WINDOW_WIDTH, WINDOW_HEIGHT);
+    screenToView.tileSizes = glm::uvec4(gridSizeX, gridSizeY, gridSizeZ, sizeX);
+    screenToView.tileScreenSizes = glm::uvec2(sizeX, sizeY);
+    glNamedBufferSubData(screenToViewSSBO, 0, sizeof(ScreenToView), &screenToView);
+    GLState::get().recordUpload(sizeof(ScreenToView));
+}
+
+ClusterGrid ClusteredEngine::getClusterGrid() const {
+    ClusterGrid grid;
+    grid.sizeX = gridSizeX;
+    grid.sizeY = gridSizeY;
+    grid.sizeZ = gridSizeZ;
+    grid.screenToView = screenToView;
+    grid.zNear = camera->zNear;
+    grid.zFar = camera->zFar;
+    return grid;
+}
+
+// Only the light grid and index list are read while shading, the AABBs stay on the CPU
+void ClusteredEngine::cullLightsCPU(const glm::mat4& view) {
+    cpuCuller.buildClusters(getClusterGrid());
+    cpuCuller.assignLights(lights.data(), lights.size(), view, maxLightsPerTile);
+
+    const std::vector<LightGridEntry>& lightGrid = cpuCuller.getLightGrid();
+    const std::vector<unsigned int>& indices = cpuCuller.getLightIndices();
+    unsigned int indexCount = indices.size();
+
+    glNamedBufferSubData(lightGridSSBO, 0, lightGrid.size() * sizeof(LightGridEntry), lightGrid.data());
+    glNamedBufferSubData(lightIndicesSSBO, 0, indices.size() * sizeof(unsigned int), indices.data());
+    glNamedBufferSubData(lightGlobalCountSSBO, 0, sizeof(unsigned int), &indexCount);
+    GLState::get().recordUpload(lightGrid.size() * sizeof(LightGridEntry) + (indices.size() + 1) * sizeof(unsigned int));
+}
+
+void ClusteredEngine::validateCulling(const glm::mat4& view) {
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    std::vector<ClusterAABB> gpuClusters(numClusters);
+    std::vector<LightGridEntry> gpuGrid(numClusters);
+    unsigned int gpuIndexCount = 0;
+    glGetNamedBufferSubData(AABBGridSSBO, 0, numClusters * sizeof(ClusterAABB), gpuClusters.data());
+    glGetNamedBufferSubData(lightGridSSBO, 0, numClusters * sizeof(LightGridEntry), gpuGrid.data());
+    glGetNamedBufferSubData(lightGlobalCountSSBO, 0, sizeof(unsigned int), &gpuIndexCount);
+
+    gpuIndexCount = std::min(gpuIndexCount, numClusters * maxLightsPerTile);
+    std::vector<unsigned int> gpuIndices(gpuIndexCount);
+    glGetNamedBufferSubData(lightIndicesSSBO, 0, gpuIndexCount * sizeof(unsigned int), gpuIndices.data());
+
+    // Clusters the depth pre-pass left out keep an empty light list on purpose
+    std::vector<unsigned char> activeClusters;
+    if (useLightBVH && useActiveClusters) {
+        unsigned int header[4] = {};
+        glGetNamedBufferSubData(lightBVH.getActiveClusterListBuffer(), 0, sizeof(header), header);
+
+        std::vector<unsigned int> activeList(std::min(header[3], numClusters));
+        glGetNamedBufferSubData(lightBVH.getActiveClusterListBuffer(), sizeof(header), activeList.size() * sizeof(unsigned int), activeList.data());
+
+        activeClusters.assign(numClusters, 0);
+        for (unsigned int cluster : activeList) activeClusters[cluster] = 1;
+    }
+
+    cpuCuller.buildClusters(getClusterGrid());
+    cpuCuller.assignLights(lights.data(), lights.size(), view, maxLightsPerTile);
+    lastComparison = cpuCuller.compare(gpuClusters.data(), gpuGrid.data(), gpuIndices.data(), gpuIndices.size(),
+        activeClusters.empty() ? nullptr : activeClusters.data());
+    hasComparison = true;
+
+    if (!lastComparison.matches()) {
+        std::cout << "WARNING::CLUSTERED::CULLING_MISMATCH " << lastComparison.mismatchedBounds << " bounds and "
+            << lastComparison.mismatchedLights << " light lists differ from the CPU, first at cluster "
+            << lastComparison.firstMismatch << std::endl;
+    }
+}
+
 void ClusteredEngine::render(std::vector<Model>& objs) {
     glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), camera->aspect, 0.1f, 100.0f);
     glm::mat4 view = camera->getViewMatrix();
 
-    tileCreateCompute.use();
-    tileCreateCompute.setFloat("zNear", camera->zNear);
-    tileCreateCompute.setFloat("zFar", camera->zFar);
-    glDispatchCompute(gridSizeX, gridSizeY, gridSizeZ);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-
-    clusterLightCompute.use();
-    clusterLightCompute.setMat4("view", view);
-    glDispatchCompute(1, 1, 6);
-    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    frameConstants.setCamera(projection, view, camera->Position, camera->zNear, camera->zFar,
+        WINDOW_WIDTH, WINDOW_HEIGHT);
+    frameConstants.upload();
 
     glm::mat4 model = glm::mat4(1.0f);
     model = glm::scale(model, glm::vec3(0.1f));
+    objs[0].model_matrix = model;
+
+    updateLights();
+
+    cullingTimer.begin();
+    if (useCPUCulling) {
+        cullLightsCPU(view);
+    } else {
+        tileCreateCompute.use();
+        tileCreateCompute.setFloat("zNear", camera->zNear);
+        tileCreateCompute.setFloat("zFar", camera->zFar);
+        glDispatchCompute(gridSizeX, gridSizeY, gridSizeZ);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        if (useLightBVH) {
+            if (useActiveClusters) {
+                GLState::get().bindFramebuffer(depthFBO);
+                glClear(GL_DEPTH_BUFFER_BIT);
+                drawModels(objs, depthPipeline, SKIP_TEXTURES);
+                GLState::get().bindFramebuffer(0);
+
+                lightBVH.markClusters(gDepth, WINDOW_WIDTH, WINDOW_HEIGHT, camera->zNear, camera->zFar, scale, bias);
+            } else {
+                lightBVH.markAllClusters();
+            }
+
+            lightBVH.build(lights.size(), view, screenToView.inverseProj, camera->zFar);
+            glClearNamedBufferData(lightGlobalCountSSBO, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+            lightBVH.cull();
+        } else {
+            clusterLightCompute.use();
+            clusterLightCompute.setMat4("view", view);
+            glDispatchCompute(1, 1, 6);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        }
+
+        if (shouldValidateCulling) {
+            validateCulling(view);
+            shouldValidateCulling = false;
+        }
+    }
+    cullingTimer.end();
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    renderPipeline.use();
-
-    renderPipeline.setFloat("zNear", camera->zNear);
-    renderPipeline.setFloat("zFar", camera->zFar);
-    renderPipeline.setFloat("bias", bias);
-    renderPipeline.setFloat("scale", scale);
-    renderPipeline.setVec3("viewPos", camera->Position);
-    renderPipeline.setFloat("multiplier", lightMultiplier);
-        
-    renderPipeline.setVec3("dirLight.direction", directionalLight.direction);
-    renderPipeline.setVec3("dirLight.color", directionalLight.diffuse);
-
-    renderPipeline.setMat4("view", view);
-    renderPipeline.setMat4("projection", projection);
-    renderPipeline.setBool("useFragNormalFunction", shouldUseFragFunction);
-    objs[0].model_matrix = model;
 
-    drawModels(objs, renderPipeline);
+    ShaderFeatures features = shouldUseFragFunction ? (ShaderFeatures) SHADER_FEATURE_FRAG_NORMALS : (ShaderFeatures) 0;
+    prepareVariants(objs, renderPipeline, features);
+    for (auto& [variantFeatures, variant] : renderPipeline.getVariants()) {
+        variant.use();
+
+        variant.setFloat("zNear", camera->zNear);
+        variant.setFloat("zFar", camera->zFar);
+        variant.setFloat("bias", bias);
+        variant.setFloat("scale", scale);
+        variant.setFloat("multiplier", lightMultiplier);
+
+        variant.setVec3("dirLight.direction", directionalLight.direction);
+        variant.setVec3("dirLight.color", directionalLight.diffuse);
+    }
+
+    drawModels(objs, renderPipeline, features);
+
+    // Every light cube in one draw, transforms and colors come from the instance buffer
+    if (lightBoxesDirty) updateLightBoxInstances();
+    lightBoxInstances.bind();
 
     lightBoxPipeline.use();
-    lightBoxPipeline.setMat4("projection", projection);
-    lightBoxPipeline.setMat4("view", view);
+    lightBoxPipeline.setUint("instanceOffset"_u, 0);
 
+    GLState::get().bindVertexArray(cubeBuffer.VAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, lights.size());
+    GLState::get().recordDraw();
+}
+
+void ClusteredEngine::updateLightBoxInstances() {
+    const ClusteredLight* lightData = lights.data();
+    std::vector<InstanceData> instances(lights.size());
     for (unsigned int i = 0; i < lights.size(); i++) {
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(lights[i].position));
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(lightData[i].position));
         model = glm::scale(model, glm::vec3(0.25f));
-        lightBoxPipeline.setMat4("model", model);
-        lightBoxPipeline.setVec3("lightColor", lights[i].color);
 
-        glBindVertexArray(cubeBuffer.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        instances[i].modelMatrix = model;
+        instances[i].color = lightData[i].color;
     }
+
+    lightBoxInstances.upload(instances);
+    lightBoxesDirty = false;
 }
 
 void ClusteredEngine::handleImGui()
@@ -165,9 +320,62 @@ void ClusteredEngine::handleImGui()
     if (ImGui::CollapsingHeader("Scene Info")) {
         ImGui::SliderFloat("Bias", &bias, 0.01f, 1.0f);
         ImGui::SliderFloat("Scale", &scale, 0.5f, 10.0f);
-        ImGui::SliderFloat("Multiplier ", &lightMultiplier, 1.0f, 100.0f);
+        if (ImGui::SliderFloat("Multiplier ", &lightMultiplier, 1.0f, 100.0f)) {
+            lights.setAttenuation(lights.getAttenuation(), lightCutoff / lightMultiplier);
+        }
         ImGui::Checkbox("Should use Frag Function", &shouldUseFragFunction);
     }
+    if (ImGui::CollapsingHeader("Light Culling")) {
+        ImGui::InputInt("Lights", &numLights);
+        numLights = std::clamp(numLights, 0, 100000);
+        if (ImGui::Button("Regenerate Lights")) createLights(numLights);
+        if (ImGui::SliderFloat("Light Cutoff", &lightCutoff, 0.001f, 0.1f)) {
+            lights.setAttenuation(lights.getAttenuation(), lightCutoff / lightMultiplier);
+        }
+        ImGui::InputInt("Moving Lights", &movingLights);
+        movingLights = std::clamp(movingLights, 0, (int) lightIDs.size());
+
+        if (ImGui::Button("Add Light")) {
+            glm::vec3 position = camera->Position + camera->Front * 5.0f;
+            lightIDs.push_back(lights.addLight(position, glm::vec3(1.0f)));
+            lightOrigins.push_back(position);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Remove Light") && !lightIDs.empty()) {
+            lights.removeLight(lightIDs.back());
+            lightIDs.pop_back();
+            lightOrigins.pop_back();
+        }
+
+        const LightManagerStats& lightStats = lights.getStats();
+        ImGui::Text("Lights: %u of %u, Dirty: %u", lightStats.lights, lightStats.capacity, lightStats.dirtyLights);
+        ImGui::Text("Uploaded: %zu B in %u ranges", lightStats.uploadedBytes, lightStats.uploadRanges);
+        ImGui::Text("Culling: %.3f ms", cullingTimer.getMilliseconds());
+
+        ImGui::Checkbox("CPU Light Culling", &useCPUCulling);
+        if (!useCPUCulling) {
+            ImGui::Checkbox("Light BVH", &useLightBVH);
+            if (useLightBVH) {
+                ImGui::Checkbox("Only Clusters With Geometry", &useActiveClusters);
+                const LightBVHStats& stats = lightBVH.getStats();
+                ImGui::Text("Levels: %u, Nodes: %u, Capacity: %u", stats.numLevels, stats.numNodes, stats.lightCapacity);
+                ImGui::Text("Sort: %u keys in %u dispatches", stats.numKeys, stats.sortDispatches);
+            }
+        }
+
+        if (useCPUCulling) {
+            const ClusterCullingStats& stats = cpuCuller.getStats();
+            ImGui::Text("Build: %.3f ms, Assign: %.3f ms", stats.buildMilliseconds, stats.assignMilliseconds);
+            ImGui::Text("Indices: %u, Most in a Cluster: %u", stats.indices, stats.maxClusterLights);
+            ImGui::Text("Overflowed Clusters: %u", stats.overflowedClusters);
+        } else if (ImGui::Button("Validate Against CPU")) {
+            shouldValidateCulling = true;
+        }
+        if (hasComparison) {
+            ImGui::Text("Last Validation: %s (%u bounds, %u light lists differ of %u)", lastComparison.matches() ? "match" : "MISMATCH",
+                lastComparison.mismatchedBounds, lastComparison.mismatchedLights, lastComparison.clusters);
+        }
+    }
     if (ImGui::CollapsingHeader("Directional Light Info")) {
         ImGui::SliderFloat3("Direction", (float*)&directionalLight.direction, -1.0f, 1.0f);
         ImGui::SliderFloat3("Color", (float*)&directionalLight.diffuse, 0.0f, 1.0f);
@@ -2,22 +2,11 @@
 
 #include "gl_base_engine.h"
 #include "utils/gl_compute.h"
-
-struct ClusteredLight {
-    glm::vec4 position;
-    glm::vec4 color;
-    unsigned int enabled;
-    float intensity;
-    float range;
-    float something;
-};
-
-struct ScreenToView {
-    glm::mat4 inverseProj;
-    glm::uvec4 tileSizes;
-    glm::uvec2 screenDimensions;
-    glm::uvec2 tileScreenSizes;
-};
+#include "utils/gl_instancing.h"
+#include "utils/gl_resources.h"
+#include "utils/cluster_culling.h"
+#include "utils/gl_light_bvh.h"
+#include "utils/gl_light_manager.h"
 
 class ClusteredEngine : public GLEngine {
 public:
@@ -27,35 +16,71 @@ public:
     
 private:
     void init_SSBOs();
+    void createRenderTargets();
+    void updateScreenToView();
+    void resize_resources();
+
+    // Replaces the lights with count random ones
+    void createLights(unsigned int count);
+    // Moves the animated lights and uploads whatever changed
+    void updateLights();
+
+    ClusterGrid getClusterGrid() const;
+    void cullLightsCPU(const glm::mat4& view);
+    // Reads back what the compute shaders produced and checks it against the CPU
+    void validateCulling(const glm::mat4& view);
 
     float lightMultiplier = 10.0f;
     float multiplier = 0.01f;
     bool shouldUseFragFunction = false;
 
     DirLight directionalLight;
-    std::vector<ClusteredLight> lights;
-    unsigned int numLights = 16 * 9 * 4;
-    unsigned int maxLights = 1000;
+    LightManager lights;
+    // Added order, the first movingLights of them bob around where they were placed
+    std::vector<LightID> lightIDs;
+    std::vector<glm::vec3> lightOrigins;
+    int numLights = 16 * 9 * 4;
+    int movingLights = 0;
+    // Brightness after lightMultiplier below which a light's range ends
+    float lightCutoff = 5.0f / 256.0f;
     unsigned int maxLightsPerTile = 200;
     float bias = 0.01f, scale = 1.0f;
 
     ComputeShader tileCreateCompute;
     ComputeShader clusterLightCompute;
 
+    // Light BVH culling, only clusters the depth pre-pass touches are culled when useActiveClusters is set
+    LightBVH lightBVH;
+    bool useLightBVH = true;
+    bool useActiveClusters = true;
+    GPUTimer cullingTimer;
+
+    // Fallback for drivers whose compute can't run clusterLights.comp, and the reference it's checked against
+    ClusterCuller cpuCuller;
+    bool useCPUCulling = false;
+    bool shouldValidateCulling = false;
+    bool hasComparison = false;
+    ClusterComparison lastComparison;
+    ScreenToView screenToView;
+
     const unsigned int gridSizeX = 16, gridSizeY = 9, gridSizeZ = 24;
     const unsigned int numClusters = gridSizeX * gridSizeY * gridSizeZ;
 
-    unsigned int deferredFBO;
-    unsigned int gPosition, gNormal, gAlbedo, gReflectionPosition;
-    unsigned int depthMap;
+    FramebufferHandle deferredFBO, depthFBO;
+    TextureHandle gNormal, gAlbedo, gMaterial, gDepth;
 
-    unsigned int AABBGridSSBO, screenToViewSSBO, lightSSBO, 
+    BufferHandle AABBGridSSBO, screenToViewSSBO,
         lightIndicesSSBO, lightGridSSBO, lightGlobalCountSSBO;
 
     AllocatedBuffer quadBuffer;
     AllocatedBuffer cubeBuffer;
 
-    Shader renderPipeline;
+    InstanceBuffer lightBoxInstances;
+    bool lightBoxesDirty = true;
+    void updateLightBoxInstances();
+
+    ShaderVariants renderPipeline;
     Shader gBufferPipeline;
+    Shader depthPipeline;
     Shader lightBoxPipeline;
 };
\ No newline at end of file
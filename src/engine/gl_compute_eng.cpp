@@ -3,7 +3,10 @@
 #include <random>
 
 void ComputeEngine::init_resources() {
-    computePipeline = ComputeShader("compute/basic.glsl");
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(computePipeline, "compute/basic.glsl");
+    shaders.load(renderPipeline, "default/defaultScreen.vs", "default/defaultTexture.fs");
+    shaders.finish();
 
     imgTexture = glutil::createTexture(imgWidth, imgHeight, GL_FLOAT, GL_RGBA, GL_RGBA32F, nullptr);
     glBindImageTexture(0, imgTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
@@ -11,8 +14,6 @@ void ComputeEngine::init_resources() {
     std::string cubemapPath = "../../resources/textures/skybox/";
     cubemapTexture = glutil::loadCubemap(cubemapPath);
 
-    renderPipeline = Shader("default/defaultScreen.vs", "default/defaultTexture.fs");
-
     quadBuffer = glutil::createScreenQuad();
 
     createValues();
@@ -70,39 +71,32 @@ void ComputeEngine::render(std::vector<Model>& objs) {
     computePipeline.setMat4("inverseView", inverseView);
 
     for (int i = 0; i < 4; i++) {
-        std::string name = "pointLights[" + std::to_string(i) + "]";
-
-        computePipeline.setVec3(name + ".position", pointLights[i].position);
-        computePipeline.setVec3(name + ".ambient", pointLights[i].ambient);
-        computePipeline.setVec3(name + ".specular", pointLights[i].specular);
-        computePipeline.setVec3(name + ".diffuse", pointLights[i].diffuse);
+        computePipeline.setVec3(uniformArray("pointLights", i, "position"), pointLights[i].position);
+        computePipeline.setVec3(uniformArray("pointLights", i, "ambient"), pointLights[i].ambient);
+        computePipeline.setVec3(uniformArray("pointLights", i, "specular"), pointLights[i].specular);
+        computePipeline.setVec3(uniformArray("pointLights", i, "diffuse"), pointLights[i].diffuse);
     }
 
     for (int i = 0; i < 25; i++) {
-        std::string name = "spheres[" + std::to_string(i) + "]";
-
-        computePipeline.setVec3(name + ".origin", spheres[i].origin);
-        computePipeline.setVec3(name + ".albedo", spheres[i].albedo);
-        computePipeline.setVec3(name + ".specular", spheres[i].specular);
-        computePipeline.setFloat(name + ".radius", spheres[i].radius);
+        computePipeline.setVec3(uniformArray("spheres", i, "origin"), spheres[i].origin);
+        computePipeline.setVec3(uniformArray("spheres", i, "albedo"), spheres[i].albedo);
+        computePipeline.setVec3(uniformArray("spheres", i, "specular"), spheres[i].specular);
+        computePipeline.setFloat(uniformArray("spheres", i, "radius"), spheres[i].radius);
     }
-    std::string name = "plane";
-    computePipeline.setVec3(name + ".point", plane.point);
-    computePipeline.setVec3(name + ".normal", plane.normal);
-    computePipeline.setVec3(name + ".albedo", plane.albedo);
-    computePipeline.setVec3(name + ".specular", plane.specular);
-
-    name = "dirLight";
-    computePipeline.setVec3(name + ".direction", dirLight.direction);
-    computePipeline.setVec3(name + ".diffuse", dirLight.diffuse);
-    computePipeline.setVec3(name + ".ambient", dirLight.ambient);
-    computePipeline.setVec3(name + ".specular", dirLight.specular);
+    computePipeline.setVec3("plane.point"_u, plane.point);
+    computePipeline.setVec3("plane.normal"_u, plane.normal);
+    computePipeline.setVec3("plane.albedo"_u, plane.albedo);
+    computePipeline.setVec3("plane.specular"_u, plane.specular);
+
+    computePipeline.setVec3("dirLight.direction"_u, dirLight.direction);
+    computePipeline.setVec3("dirLight.diffuse"_u, dirLight.diffuse);
+    computePipeline.setVec3("dirLight.ambient"_u, dirLight.ambient);
+    computePipeline.setVec3("dirLight.specular"_u, dirLight.specular);
 
     computePipeline.setInt("numReflections", numReflections);
     computePipeline.setInt("shininess", shininess);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    GLState::get().bindTexture(1, GL_TEXTURE_CUBE_MAP, cubemapTexture);
     computePipeline.setInt("cubemap", 1);
 
     glDispatchCompute((unsigned int) imgWidth/8, (unsigned int) imgHeight/4, 1);
@@ -112,11 +106,11 @@ void ComputeEngine::render(std::vector<Model>& objs) {
 
     renderPipeline.use();
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, imgTexture);
+    GLState::get().bindTexture(0, GL_TEXTURE_2D, imgTexture);
     renderPipeline.setInt("texture1", 0);
-    glBindVertexArray(quadBuffer.VAO);
+    GLState::get().bindVertexArray(quadBuffer.VAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    GLState::get().recordDraw();
 }
 
 void ComputeEngine::handleImGui()
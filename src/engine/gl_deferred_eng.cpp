@@ -3,16 +3,35 @@
 #include "glm/gtx/string_cast.hpp"
 #include <random>
 
-void DeferredEngine::init_resources() {
-    renderPipeline = Shader("deferred/lighting.vs", "ssr/finalPassF.glsl");
-    gbufferPipeline = Shader("aliasing/taa/taaGbuffer.vs", "aliasing/taa/taaGbuffer.fs");
-    fxaaPipeline = Shader("deferred/lighting.vs", "aliasing/fxaa.fs");
-    ssrPipeline = Shader("deferred/lighting.vs", "ssr/ssrF.glsl");
-
-    taaResolvePipeline = Shader("deferred/lighting.vs", "aliasing/taa/taaResolve.fs");
-    taaHistoryPipeline = Shader("deferred/lighting.vs", "aliasing/taa/taaHistory.fs");
+// Attachments written by the G-buffer pass, before and after the compact layout.
+// Only used to compare bytes written per frame.
+static const GLenum legacyGBufferFormats[] = {
+    GL_RGBA16F, GL_RGBA16F, GL_RGBA8, GL_RGBA16F, GL_RG16F, GL_RG16F, GL_DEPTH32F_STENCIL8
+};
+static const GLenum compactGBufferFormats[] = {
+    GL_RG16, GL_RGBA8, GL_RGBA8, GL_RG16F, GL_DEPTH32F_STENCIL8
+};
+
+template <size_t N>
+static size_t getBytesPerPixel(const GLenum (&formats)[N]) {
+    size_t bytes = 0;
+    for (GLenum format : formats) bytes += ResourceRegistry::estimateTextureSize(GL_TEXTURE_2D, format, 1, 1, 1, 1);
+    return bytes;
+}
 
-    inverseScreenSize = glm::vec2(1.0 / WINDOW_WIDTH, 1.0 / WINDOW_HEIGHT);
+void DeferredEngine::init_resources() {
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(renderPipeline, "deferred/lighting.vs", "ssr/finalPassF.glsl");
+    shaders.load(tiledLightingCompute, "deferred/tiledLighting.comp");
+    shaders.load(gbufferPipeline, "aliasing/taa/taaGbuffer.vs", "aliasing/taa/taaGbuffer.fs");
+    shaders.load(fxaaPipeline, "deferred/lighting.vs", "aliasing/fxaa.fs");
+    shaders.load(ssrPipeline, "deferred/lighting.vs", "ssr/ssrF.glsl");
+
+    shaders.load(taaResolvePipeline, "deferred/lighting.vs", "aliasing/taa/taaResolve.fs");
+    shaders.load(taaHistoryPipeline, "deferred/lighting.vs", "aliasing/taa/taaHistory.fs");
+    shaders.finish();
+
+    resolution.setScalingSupported(true);
    for (int i = 0; i < 128; i++) {
     haltonSequences[i] = glm::vec2(createHaltonSequence(i + 1, 2), createHaltonSequence(i + 1, 3));
    }
@@ -31,86 +50,32 @@ void DeferredEngine::init_resources() {
     std::uniform_real_distribution<float> posz_dist(-3.f, 3.f);
     std::uniform_real_distribution<float> pos_dist(-3.f, 3.f);
 
-    for (int i = 0; i < 32; i++) {
-        DeferredLight light;
-        light.color = glm::vec3(color_dist(mt), color_dist(mt), color_dist(mt));
-        light.position = glm::vec3(pos_dist(mt), pos_dist(mt), posz_dist(mt));
+    LightAttenuation attenuation;
+    attenuation.linear = 0.7f;
+    attenuation.quadratic = 1.8f;
+    lights.init(3, 32);
+    lights.setAttenuation(attenuation, 5.0f / 256.0f);
 
-        lights.push_back(light);
+    for (int i = 0; i < 32; i++) {
+        glm::vec3 color = glm::vec3(color_dist(mt), color_dist(mt), color_dist(mt));
+        glm::vec3 position = glm::vec3(pos_dist(mt), pos_dist(mt), posz_dist(mt));
+        lightIDs.push_back(lights.addLight(position, color));
     }
     directionalLight.direction = glm::vec3(0.0f, 1.0f, 0.0f);
     directionalLight.color = glm::vec3(1.0f, 1.0f, 1.0f);
 
-    glCreateFramebuffers(1, &deferredFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, deferredFBO);
-
-    gPosition = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr);
-    gNormal = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F, nullptr);
-    gAlbedo = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_UNSIGNED_BYTE, GL_RGBA, GL_RGBA8, nullptr);
-    gReflectionColor = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F);
-    gReflectionPosition = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA16F);
-    gMetallic = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RG, GL_RG16F, nullptr);
-    gVelocity = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RG, GL_RG16F, nullptr);
-
-    depthMap = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, GL_DEPTH_STENCIL, GL_DEPTH32F_STENCIL8);
-    
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT0, gPosition, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT1, gNormal, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT2, gAlbedo, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT3, gReflectionPosition, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT4, gMetallic, 0);
-    glNamedFramebufferTexture(deferredFBO, GL_COLOR_ATTACHMENT5, gVelocity, 0);
-
-    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthMap, 0);
-
-    glNamedFramebufferTexture(deferredFBO, GL_DEPTH_STENCIL_ATTACHMENT, depthMap, 0);
-
-    unsigned int attachments[6] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, 
-        GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5 };
-    glNamedFramebufferDrawBuffers(deferredFBO, 6, attachments);
-    
-    if (glCheckNamedFramebufferStatus(deferredFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "Framebuffer not complete! " << std::endl;
-    }
-    glBindFramebuffer(deferredFBO, 0);
-
-    glCreateFramebuffers(1, &ssrFBO);
-    glNamedFramebufferTexture(ssrFBO, GL_COLOR_ATTACHMENT0, gReflectionColor, 0);
-    glNamedFramebufferDrawBuffer(ssrFBO, GL_COLOR_ATTACHMENT0);
-
-    unsigned int ssrDepth = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, GL_DEPTH_STENCIL, GL_DEPTH32F_STENCIL8);
-    glNamedFramebufferTexture(ssrFBO, GL_DEPTH_STENCIL_ATTACHMENT, ssrDepth, 0);
+    glCreateQueries(GL_SAMPLES_PASSED, 2, gbufferQueries);
 
-    if (glCheckNamedFramebufferStatus(ssrFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "Framebuffer not complete! " << std::endl;
-    }
-
-    glCreateFramebuffers(1, &aaFBO);
-    colorTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA8, nullptr);
-    glNamedFramebufferTexture(aaFBO, GL_COLOR_ATTACHMENT0, colorTexture, 0);
-    glNamedFramebufferDrawBuffer(aaFBO, GL_COLOR_ATTACHMENT0);
-
-    if (glCheckNamedFramebufferStatus(aaFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "Framebuffer not complete! " << std::endl;
-    }
-
-    glCreateFramebuffers(1, &simpleColorFBO);
-    simpleColorTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA8, nullptr);
-    glNamedFramebufferTexture(simpleColorFBO, GL_COLOR_ATTACHMENT0, simpleColorTexture, 0);
-    glNamedFramebufferDrawBuffer(simpleColorFBO, GL_COLOR_ATTACHMENT0);
-
-    if (glCheckNamedFramebufferStatus(simpleColorFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "Framebuffer not complete! " << std::endl;
-    }
+    resize_resources();
+}
 
-    glCreateFramebuffers(1, &historyFBO);
-    historyColorTexture = glutil::createTexture(WINDOW_WIDTH, WINDOW_HEIGHT, GL_FLOAT, GL_RGBA, GL_RGBA8, nullptr);
-    glNamedFramebufferTexture(historyFBO, GL_COLOR_ATTACHMENT0, historyColorTexture, 0);
-    glNamedFramebufferDrawBuffer(historyFBO, GL_COLOR_ATTACHMENT0);
+// Frame graph targets follow the descs built each frame, only the history is sized by hand
+void DeferredEngine::resize_resources() {
+    int width = resolution.getRenderWidth(), height = resolution.getRenderHeight();
+    inverseScreenSize = glm::vec2(1.0 / width, 1.0 / height);
 
-    if (glCheckNamedFramebufferStatus(historyFBO, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cout << "Framebuffer not complete! " << std::endl;
-    }
+    frameGraph.invalidate(historyColorTexture);
+    historyColorTexture = TextureHandle(glutil::createTexture(width, height, GL_FLOAT, GL_RGBA, GL_RGBA8, nullptr, 1));
 }
 
 
@@ -123,13 +88,49 @@ void DeferredEngine::render(std::vector<Model>& objs) {
     glm::mat4 view = camera->getViewMatrix();
     glm::mat4 model = glm::mat4(1.0f);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, deferredFBO);
+    // Everything up to the resolve runs at the render size, the last pass upscales to the window
+    int renderWidth = resolution.getRenderWidth(), renderHeight = resolution.getRenderHeight();
+    frameConstants.setCamera(projection, view, camera->Position, 0.1f, 100.0f, renderWidth, renderHeight);
+    frameConstants.upload();
+
+    RenderTargetDesc colorDesc, halfDesc, depthDesc;
+    colorDesc.width = halfDesc.width = depthDesc.width = renderWidth;
+    colorDesc.height = halfDesc.height = depthDesc.height = renderHeight;
+    colorDesc.format = GL_RGBA8;
+    halfDesc.format = GL_RGBA16F;
+    depthDesc.format = GL_DEPTH32F_STENCIL8;
+
+    RenderTargetDesc rgDesc = colorDesc;
+    rgDesc.format = GL_RG16F;
+    RenderTargetDesc normalDesc = colorDesc;
+    normalDesc.format = GL_RG16;
+
+    if (gbufferQueryUsed[gbufferQueryIndex]) {
+        glGetQueryObjectui64v(gbufferQueries[gbufferQueryIndex], GL_QUERY_RESULT, &gbufferSamples);
+    }
+
+    RenderTargetDesc backbufferDesc = colorDesc;
+    backbufferDesc.width = WINDOW_WIDTH;
+    backbufferDesc.height = WINDOW_HEIGHT;
+
+    lights.update();
+
+    frameGraph.reset();
+    FrameGraphResource backbuffer = frameGraph.import("backbuffer", 0, backbufferDesc);
+
+    FrameGraphResource gNormal = frameGraph.create("gNormal", normalDesc);
+    FrameGraphResource gAlbedo = frameGraph.create("gAlbedo", colorDesc);
+    FrameGraphResource gMaterial = frameGraph.create("gMaterial", colorDesc);
+    FrameGraphResource gVelocity = frameGraph.create("gVelocity", rgDesc);
+    FrameGraphResource gDepth = frameGraph.create("gDepth", depthDesc);
+    FrameGraphResource gReflectionColor = frameGraph.create("gReflectionColor", halfDesc);
+    FrameGraphResource sceneColor = frameGraph.create("sceneColor", colorDesc);
+
+    unsigned int gbufferPass = frameGraph.addPass("gbuffer", [&](FrameGraph&) {
         glClearColor(0.0, 0.0, 0.0, 1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         gbufferPipeline.use();
-        gbufferPipeline.setMat4("projection", projection);
-        gbufferPipeline.setMat4("view", view);
 
         gbufferPipeline.setMat4("prevProjection", prevProjection);
         gbufferPipeline.setMat4("prevView", prevView);
@@ -138,13 +139,16 @@ void DeferredEngine::render(std::vector<Model>& objs) {
         else 
             gbufferPipeline.setVec2("jitter", jitter);
 
-        glBindTextureUnit(0, planeTexture);
+        glBeginQuery(GL_SAMPLES_PASSED, gbufferQueries[gbufferQueryIndex]);
+
+        GLState::get().bindTextureUnit(0, planeTexture);
         gbufferPipeline.setInt("texture_diffuse1", 0);
 
         gbufferPipeline.setMat4("model", planeModel);
 
-        glBindVertexArray(planeBuffer.VAO);
+        GLState::get().bindVertexArray(planeBuffer.VAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        GLState::get().recordDraw();
 
         model = glm::mat4(1.0f);
         model = glm::scale(model, glm::vec3(0.1f));
@@ -152,83 +156,63 @@ void DeferredEngine::render(std::vector<Model>& objs) {
 
         gbufferPipeline.setMat4("model", model);
         drawModels(objs, gbufferPipeline);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, ssrFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glEndQuery(GL_SAMPLES_PASSED);
+    });
+    frameGraph.write(gbufferPass, gNormal);
+    frameGraph.write(gbufferPass, gAlbedo);
+    frameGraph.write(gbufferPass, gMaterial);
+    frameGraph.write(gbufferPass, gVelocity);
+    frameGraph.write(gbufferPass, gDepth);
+
+    unsigned int ssrPass = frameGraph.addPass("ssr", [&](FrameGraph& graph) {
+        glClear(GL_COLOR_BUFFER_BIT);
         ssrPipeline.use();
-        glBindTextureUnit(0, depthMap);
-        glBindTextureUnit(1, gNormal);
-        glBindTextureUnit(2, gAlbedo);
-        glBindTextureUnit(3, gReflectionPosition);
-        glBindTextureUnit(4, gMetallic);
+        GLState::get().bindTextureUnit(0, graph.getTexture(gDepth));
+        GLState::get().bindTextureUnit(1, graph.getTexture(gNormal));
+        GLState::get().bindTextureUnit(2, graph.getTexture(gAlbedo));
+        GLState::get().bindTextureUnit(3, graph.getTexture(gMaterial));
 
         ssrPipeline.setInt("normalTexture", 1);
         ssrPipeline.setInt("colorTexture", 2);
         ssrPipeline.setInt("depthTexture", 0);
-        ssrPipeline.setInt("positionTexture", 3);
-        ssrPipeline.setInt("metallicRoughnessTexture", 4);
-
-        ssrPipeline.setMat4("projection", projection);
-        ssrPipeline.setMat4("view", view);
-        ssrPipeline.setMat4("invProjection", glm::inverse(projection));
-        ssrPipeline.setMat4("invView", glm::inverse(view));
-        glBindVertexArray(quadBuffer.VAO);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    if (shouldFXAA) 
-        glBindFramebuffer(GL_FRAMEBUFFER, aaFBO);
-    else 
-        glBindFramebuffer(GL_FRAMEBUFFER, simpleColorFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        renderPipeline.use();
-
-        glBindTextureUnit(0, gPosition);
-        glBindTextureUnit(1, gNormal);
-        glBindTextureUnit(2, gAlbedo);
-        glBindTextureUnit(3, gReflectionColor);
-
-        renderPipeline.setInt("gPosition", 0);
-        renderPipeline.setInt("gNormal", 1);
-        renderPipeline.setInt("gAlbedoSpec", 2);
-        renderPipeline.setInt("gReflectionColor", 3);
+        ssrPipeline.setInt("materialTexture", 3);
 
-        renderPipeline.setVec3("directionalLight.direction", directionalLight.direction);
-        renderPipeline.setVec3("directionalLight.color", directionalLight.color);
-
-        for (unsigned int i = 0; i < lights.size(); i++) {
-            std::string name = "lights[" + std::to_string(i) + "].";
-            renderPipeline.setVec3(name + "Position", lights[i].position);
-            renderPipeline.setVec3(name + "Color", lights[i].color);
-
-            const float constant = 1.0f;
-            const float linear = 0.7f;
-            const float quadratic = 1.8f;
-
-            renderPipeline.setFloat(name + "Linear", linear);
-            renderPipeline.setFloat(name + "Quadratic", quadratic);
-
-            const float maxBrightness = std::fmaxf(std::fmaxf(lights[i].color.r, lights[i].color.g), lights[i].color.b);
-            float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
-            renderPipeline.setFloat(name + "Radius", globalRadius);
-        }
-        renderPipeline.setVec3("viewPos", camera->Position);
-            
-        glBindVertexArray(quadBuffer.VAO);
+        GLState::get().bindVertexArray(quadBuffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::get().recordDraw();
+    });
+    frameGraph.read(ssrPass, gDepth);
+    frameGraph.read(ssrPass, gNormal);
+    frameGraph.read(ssrPass, gAlbedo);
+    frameGraph.read(ssrPass, gMaterial);
+    frameGraph.write(ssrPass, gReflectionColor);
+
+    if (useTiledLighting) {
+        addTiledLightingPass(gDepth, gNormal, gAlbedo, gReflectionColor, sceneColor);
+    } else {
+        addLightingPass(gDepth, gNormal, gAlbedo, gReflectionColor, sceneColor);
+    }
 
     if (shouldFXAA) {
-        renderFXAA();
+        addFXAAPass(sceneColor, backbuffer);
     } else {
-        renderTAA();
+        addTAAPasses(sceneColor, gVelocity, backbuffer);
     }
 
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, deferredFBO);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    glBlitFramebuffer(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    unsigned int depthCopyPass = frameGraph.addPass("depth copy", [&](FrameGraph& graph) {
+        unsigned int depthFBO = graph.getFramebuffer({ graph.getTexture(gDepth) });
+        glBlitNamedFramebuffer(depthFBO, 0, 0, 0, renderWidth, renderHeight, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+            GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    });
+    frameGraph.read(depthCopyPass, gDepth);
+    frameGraph.write(depthCopyPass, backbuffer);
+
+    frameGraph.compile();
+    frameGraph.execute();
+
+    gbufferQueryUsed[gbufferQueryIndex] = true;
+    gbufferQueryIndex = 1 - gbufferQueryIndex;
 
     prevProjection = projection;
     prevView = view;
@@ -239,12 +223,15 @@ void DeferredEngine::handleImGui() {
 
     ImGui::Begin("Info");
     if (ImGui::CollapsingHeader("Lights")) {
-        for (int i = 0; i < 32; i++) {
+        for (unsigned int i = 0; i < lightIDs.size(); i++) {
             std::string name = "Light  " + std::to_string(i);
-            auto& currentLight = lights[i];
+            const ClusteredLight& currentLight = lights.getLight(lightIDs[i]);
             if (ImGui::TreeNode(name.c_str())) {
-                ImGui::SliderFloat3("Position", (float*)&currentLight.position, -2.0, 2.0);
-                ImGui::SliderFloat3("Color",(float*) &currentLight.color, 0.0, 1.0);
+                glm::vec3 position = glm::vec3(currentLight.position);
+                glm::vec3 color = glm::vec3(currentLight.color);
+                if (ImGui::SliderFloat3("Position", (float*)&position, -2.0, 2.0)) lights.moveLight(lightIDs[i], position);
+                if (ImGui::SliderFloat3("Color", (float*)&color, 0.0, 1.0)) lights.setColor(lightIDs[i], color, currentLight.intensity);
+                ImGui::Text("Radius: %.2f", currentLight.range);
                 ImGui::TreePop();
             }
         }
@@ -254,10 +241,11 @@ void DeferredEngine::handleImGui() {
         ImGui::SliderFloat3("Dir Light Color", (float*)&directionalLight.color, 0.0f, 1.0f);
 
         ImGui::SliderFloat("Camera Multiplier", &multiplier, 0.00001f, 0.01f);
-        ImGui::SliderFloat("Global Radius ", &globalRadius, 1.0f, 10000.0f);
         ImGui::SliderFloat("Step Multiplier", &stepMultiplier, 0.5f, 10.0f);
 
         ImGui::Checkbox("Use FXAA", &shouldFXAA);
+        ImGui::Checkbox("Tiled Lighting", &useTiledLighting);
+        ImGui::Text("Lighting: %.3f ms, Tiled: %.3f ms", lightingTimer.getMilliseconds(), tiledLightingTimer.getMilliseconds());
 
         if(ImGui::RadioButton("Translate", operation == ImGuizmo::TRANSLATE)) {
             operation = ImGuizmo::TRANSLATE;
@@ -269,6 +257,24 @@ void DeferredEngine::handleImGui() {
             operation = ImGuizmo::SCALE;
         }
     }
+    if (ImGui::CollapsingHeader("Frame Graph")) {
+        const FrameGraphStats& stats = frameGraph.getStats();
+        ImGui::Text("Passes: %u (culled %u, merged %u)", stats.numPasses, stats.culledPasses, stats.mergedPasses);
+        ImGui::Text("Resources: %u", stats.numResources);
+        ImGui::Text("Framebuffer Binds: %u", stats.framebufferBinds);
+        ImGui::Text("Requested: %.1f MB", stats.requestedBytes / (1024.0f * 1024.0f));
+        ImGui::Text("Allocated: %.1f MB", stats.allocatedBytes / (1024.0f * 1024.0f));
+    }
+    if (ImGui::CollapsingHeader("G-Buffer")) {
+        // Every attachment is cleared once and then written by each fragment that passes the depth test
+        GLuint64 pixelWrites = (GLuint64) resolution.getRenderWidth() * resolution.getRenderHeight() + gbufferSamples;
+        size_t legacyBytes = getBytesPerPixel(legacyGBufferFormats);
+        size_t compactBytes = getBytesPerPixel(compactGBufferFormats);
+
+        ImGui::Text("Fragments: %llu", (unsigned long long) gbufferSamples);
+        ImGui::Text("Legacy: %zu B/px, %.1f MB written", legacyBytes, pixelWrites * legacyBytes / (1024.0f * 1024.0f));
+        ImGui::Text("Compact: %zu B/px, %.1f MB written", compactBytes, pixelWrites * compactBytes / (1024.0f * 1024.0f));
+    }
     ImGui::End();
 
     glm::mat4 projection = glm::perspective(glm::radians(camera->Zoom), (float)WINDOW_WIDTH/ (float)WINDOW_HEIGHT, 0.1f, 100.0f);
@@ -293,47 +299,134 @@ float DeferredEngine::createHaltonSequence(unsigned int index, int base) {
     return r;
 }
 
-void DeferredEngine::renderFXAA() {
-    fxaaPipeline.use();
-    glBindTextureUnit(0, colorTexture);
+void DeferredEngine::addLightingPass(FrameGraphResource gDepth, FrameGraphResource gNormal, FrameGraphResource gAlbedo,
+    FrameGraphResource gReflectionColor, FrameGraphResource sceneColor) {
+    unsigned int lightingPass = frameGraph.addPass("lighting", [=](FrameGraph& graph) {
+        lightingTimer.begin();
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderPipeline.use();
 
-    fxaaPipeline.setVec2("inverseScreenSize", inverseScreenSize);
-    fxaaPipeline.setInt("screenTexture", 0);
-    fxaaPipeline.setFloat("multiplier", stepMultiplier);
-    glBindVertexArray(quadBuffer.VAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLState::get().bindTextureUnit(0, graph.getTexture(gDepth));
+        GLState::get().bindTextureUnit(1, graph.getTexture(gNormal));
+        GLState::get().bindTextureUnit(2, graph.getTexture(gAlbedo));
+        GLState::get().bindTextureUnit(3, graph.getTexture(gReflectionColor));
+
+        renderPipeline.setInt("gDepth", 0);
+        renderPipeline.setInt("gNormal", 1);
+        renderPipeline.setInt("gAlbedoSpec", 2);
+        renderPipeline.setInt("gReflectionColor", 3);
+
+        renderPipeline.setVec3("directionalLight.direction", directionalLight.direction);
+        renderPipeline.setVec3("directionalLight.color", directionalLight.color);
+
+        // Ranges come from the attenuation, the lights only change when the editor moves one
+        const LightAttenuation& attenuation = lights.getAttenuation();
+        lights.bind();
+        renderPipeline.setInt("numLights", lights.size());
+        renderPipeline.setVec3("attenuationTerms", glm::vec3(attenuation.constant, attenuation.linear, attenuation.quadratic));
+
+        GLState::get().bindVertexArray(quadBuffer.VAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLState::get().recordDraw();
+        lightingTimer.end();
+    });
+    frameGraph.read(lightingPass, gDepth);
+    frameGraph.read(lightingPass, gNormal);
+    frameGraph.read(lightingPass, gAlbedo);
+    frameGraph.read(lightingPass, gReflectionColor);
+    frameGraph.write(lightingPass, sceneColor);
 }
 
-void DeferredEngine::renderTAA() {
-    glBindFramebuffer(GL_FRAMEBUFFER, aaFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void DeferredEngine::addTiledLightingPass(FrameGraphResource gDepth, FrameGraphResource gNormal, FrameGraphResource gAlbedo,
+    FrameGraphResource gReflectionColor, FrameGraphResource sceneColor) {
+    unsigned int lightingPass = frameGraph.addPass("tiled lighting", [=](FrameGraph& graph) {
+        tiledLightingTimer.begin();
+        tiledLightingCompute.use();
+
+        GLState::get().bindTextureUnit(0, graph.getTexture(gDepth));
+        GLState::get().bindTextureUnit(1, graph.getTexture(gNormal));
+        GLState::get().bindTextureUnit(2, graph.getTexture(gAlbedo));
+        GLState::get().bindTextureUnit(3, graph.getTexture(gReflectionColor));
+        glBindImageTexture(0, graph.getTexture(sceneColor), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+        const LightAttenuation& attenuation = lights.getAttenuation();
+        lights.bind();
+        tiledLightingCompute.setInt("numLights", lights.size());
+        tiledLightingCompute.setVec3("attenuationTerms", glm::vec3(attenuation.constant, attenuation.linear, attenuation.quadratic));
+
+        int width = resolution.getRenderWidth(), height = resolution.getRenderHeight();
+        glDispatchCompute((width + DEFERRED_TILE_SIZE - 1) / DEFERRED_TILE_SIZE, (height + DEFERRED_TILE_SIZE - 1) / DEFERRED_TILE_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        tiledLightingTimer.end();
+    });
+    frameGraph.read(lightingPass, gDepth);
+    frameGraph.read(lightingPass, gNormal);
+    frameGraph.read(lightingPass, gAlbedo);
+    frameGraph.read(lightingPass, gReflectionColor);
+    frameGraph.write(lightingPass, sceneColor);
+}
+
+void DeferredEngine::addFXAAPass(FrameGraphResource sceneColor, FrameGraphResource backbuffer) {
+    unsigned int fxaaPass = frameGraph.addPass("fxaa", [this, sceneColor](FrameGraph& graph) {
+        fxaaPipeline.use();
+        GLState::get().bindTextureUnit(0, graph.getTexture(sceneColor));
+
+        fxaaPipeline.setVec2("inverseScreenSize", inverseScreenSize);
+        fxaaPipeline.setInt("screenTexture", 0);
+        fxaaPipeline.setFloat("multiplier", stepMultiplier);
+        GLState::get().bindVertexArray(quadBuffer.VAO);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLState::get().recordDraw();
+    });
+    frameGraph.read(fxaaPass, sceneColor);
+    frameGraph.write(fxaaPass, backbuffer);
+}
+
+void DeferredEngine::addTAAPasses(FrameGraphResource sceneColor, FrameGraphResource velocity, FrameGraphResource backbuffer) {
+    RenderTargetDesc colorDesc;
+    colorDesc.width = resolution.getRenderWidth();
+    colorDesc.height = resolution.getRenderHeight();
+    colorDesc.format = GL_RGBA8;
+
+    FrameGraphResource history = frameGraph.import("history", historyColorTexture, colorDesc);
+    FrameGraphResource resolvedColor = frameGraph.create("resolvedColor", colorDesc);
+
+    unsigned int resolvePass = frameGraph.addPass("taa resolve", [=](FrameGraph& graph) {
+        glClear(GL_COLOR_BUFFER_BIT);
         taaResolvePipeline.use();
-        glBindTextureUnit(0, simpleColorTexture);
-        glBindTextureUnit(1, historyColorTexture);
-        glBindTextureUnit(2, gVelocity);
+        GLState::get().bindTextureUnit(0, graph.getTexture(sceneColor));
+        GLState::get().bindTextureUnit(1, graph.getTexture(history));
+        GLState::get().bindTextureUnit(2, graph.getTexture(velocity));
 
         taaResolvePipeline.setInt("currentColorBuffer", 0);
         taaResolvePipeline.setInt("historyBuffer", 1);
         taaResolvePipeline.setInt("velocityBuffer", 2);
-        glBindVertexArray(quadBuffer.VAO);
+        GLState::get().bindVertexArray(quadBuffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, historyFBO);
+        GLState::get().recordDraw();
+    });
+    frameGraph.read(resolvePass, sceneColor);
+    frameGraph.read(resolvePass, history);
+    frameGraph.read(resolvePass, velocity);
+    frameGraph.write(resolvePass, resolvedColor);
+
+    // The history copy and the present draw the same resolved image
+    auto copyResolved = [=](FrameGraph& graph) {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         taaHistoryPipeline.use();
-        glBindTextureUnit(0, colorTexture);
+        GLState::get().bindTextureUnit(0, graph.getTexture(resolvedColor));
 
         taaHistoryPipeline.setInt("colorTexture", 0);
-        glBindVertexArray(quadBuffer.VAO);
+        GLState::get().bindVertexArray(quadBuffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::get().recordDraw();
+    };
 
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    taaHistoryPipeline.use();
-    glBindTextureUnit(0, colorTexture);
+    unsigned int historyPass = frameGraph.addPass("taa history", copyResolved);
+    frameGraph.read(historyPass, resolvedColor);
+    frameGraph.write(historyPass, history);
 
-    taaHistoryPipeline.setInt("colorTexture", 0);
-    glBindVertexArray(quadBuffer.VAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-}
\ No newline at end of file
+    unsigned int presentPass = frameGraph.addPass("taa present", copyResolved);
+    frameGraph.read(presentPass, resolvedColor);
+    frameGraph.write(presentPass, backbuffer);
+}
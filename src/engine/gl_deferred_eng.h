@@ -1,10 +1,11 @@
 #pragma once
 #include "gl_base_engine.h"
+#include "utils/gl_compute.h"
+#include "utils/gl_frame_graph.h"
+#include "utils/gl_light_manager.h"
 
-struct DeferredLight {
-    glm::vec3 position;
-    glm::vec3 color;
-};
+// Must match TILE_SIZE in deferred/tiledLighting.comp
+#define DEFERRED_TILE_SIZE 16
 
 class DeferredEngine : public GLEngine {
 public:
@@ -15,27 +16,24 @@ public:
     void createValues();
     float createHaltonSequence(unsigned int index, int base);
 
-    void renderFXAA();
-    void renderTAA();
+    void addFXAAPass(FrameGraphResource sceneColor, FrameGraphResource backbuffer);
+    void addLightingPass(FrameGraphResource depth, FrameGraphResource normal, FrameGraphResource albedo,
+        FrameGraphResource reflectionColor, FrameGraphResource sceneColor);
+    // Compute version of the lighting pass that only shades the lights overlapping each tile
+    void addTiledLightingPass(FrameGraphResource depth, FrameGraphResource normal, FrameGraphResource albedo,
+        FrameGraphResource reflectionColor, FrameGraphResource sceneColor);
+    void addTAAPasses(FrameGraphResource sceneColor, FrameGraphResource velocity, FrameGraphResource backbuffer);
 
 private:
     bool shouldFXAA = false;
     float stepMultiplier = 1.0f;
-    std::vector<DeferredLight> lights;
-    float globalRadius = 100.0f;
+    LightManager lights;
+    std::vector<LightID> lightIDs;
     SimpleDirectionalLight directionalLight;
 
-    unsigned int deferredFBO;
-    unsigned int gPosition, gNormal, gAlbedo, gReflectionPosition, gMetallic, gVelocity;
-    unsigned int depthMap;
-
-    unsigned int aaFBO;
-    unsigned int colorTexture;
+    FrameGraph frameGraph;
     glm::vec2 inverseScreenSize;
 
-    unsigned int ssrFBO;
-    unsigned int gReflectionColor;
-
     AllocatedBuffer quadBuffer;
 
     AllocatedBuffer planeBuffer;
@@ -43,6 +41,10 @@ private:
     glm::mat4 planeModel;
 
     Shader renderPipeline;
+    ComputeShader tiledLightingCompute;
+    bool useTiledLighting = true;
+    // Both are shown so the paths can be compared, the inactive one keeps its last reading
+    GPUTimer lightingTimer, tiledLightingTimer;
     Shader gbufferPipeline;
     Shader fxaaPipeline;
     Shader ssrPipeline;
@@ -58,9 +60,14 @@ private:
     float multiplier = 0.01;
     ImGuizmo::OPERATION operation = ImGuizmo::OPERATION::TRANSLATE;
 
-    unsigned int simpleColorFBO;
-    unsigned int simpleColorTexture;
+    // Fragments that reached the G-buffer, read two frames late so the query never stalls
+    unsigned int gbufferQueries[2] = { 0, 0 };
+    bool gbufferQueryUsed[2] = { false, false };
+    int gbufferQueryIndex = 0;
+    GLuint64 gbufferSamples = 0;
+
+    // Read by the next frame's resolve, so it lives outside the frame graph's pool
+    TextureHandle historyColorTexture;
 
-    unsigned int historyFBO;
-    unsigned int historyColorTexture;
+    void resize_resources();
 };
\ No newline at end of file
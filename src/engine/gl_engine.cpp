@@ -1,5 +1,6 @@
 #include "gl_engine.h"
 
+#include <algorithm>
 #include <iostream>
 #include <iterator>
 #include <SDL.h>
@@ -9,25 +10,25 @@
 #include <glm/gtx/string_cast.hpp>
 
 void RenderEngine::init_resources() {
-    pipeline = Shader("shadowPoints/model.vs", "shadowPoints/model.fs");
-    mapPipeline = Shader("cubemap/map.vs", "cubemap/map.fs");
-    cascadeMapPipeline = Shader("shadows/cascadeV.glsl", "shadows/map.fs", "shadows/cascadeG.glsl");
-    depthCubemapPipeline = Shader("shadowPoints/map.vs", "shadowPoints/map.fs",
-        "shadowPoints/map.gs");
-
-    debugCascadePipeline = Shader("cascade/cascadeDebugV.glsl", "cascade/cascadeDebugF.glsl");
-    debugDepthPipeline = Shader("cascade/mapDebugV.glsl", "cascade/mapDebugF.glsl");
-
-    for (int i = 0; i < 4; i++) {
-        depthCubemaps[i] = glutil::createCubemap(2048, 2048, GL_FLOAT, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT);
-    }
-
-    glCreateFramebuffers(1, &depthFBO);
-    glCreateTextures(GL_TEXTURE_2D, 1, &depthMap);
-    glTextureStorage2D(depthMap, 1, GL_DEPTH_COMPONENT32F, 2048, 2048);
-    glNamedFramebufferTexture(depthFBO, GL_DEPTH_ATTACHMENT, depthCubemaps[0], 0);
-    glNamedFramebufferDrawBuffer(depthFBO, GL_NONE);
-    glNamedFramebufferReadBuffer(depthFBO, GL_NONE);
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(pipeline, "shadowPoints/model.vs", "shadowPoints/model.fs");
+    shaders.load(depthPrePassPipeline, "shadowPoints/model.vs", "shadows/map.fs");
+    shaders.load(mapPipeline, "cubemap/map.vs", "cubemap/map.fs");
+    shaders.load(cascadeMapPipeline, "shadows/cascadeV.glsl", "shadows/map.fs", "shadows/cascadeG.glsl");
+    shaders.load(pointShadowPipeline, "shadowPoints/atlas.vs", "shadowPoints/map.fs");
+
+    shaders.load(debugCascadePipeline, "cascade/cascadeDebugV.glsl", "cascade/cascadeDebugF.glsl");
+    shaders.load(debugDepthPipeline, "cascade/mapDebugV.glsl", "cascade/mapDebugF.glsl");
+    depthReduction.init();
+    shaders.finish();
+
+    pointShadows.init(4);
+
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_DEPTH_COMPONENT32F, 2048, 2048);
+    ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F, 2048, 2048, 1, 1, "depth map");
+    depthMap = TextureHandle(texture);
 
     planeBuffer = glutil::createPlane();
     planeTexture = glutil::loadTexture("../../resources/textures/wood.png");
@@ -58,22 +59,19 @@ void RenderEngine::init_resources() {
         pointLights[i].position = pointLightPositions[i];
     }
 
-    glCreateBuffers(1, &matricesUBO);
-    glNamedBufferData(matricesUBO, sizeof(glm::mat4x4) * 16, nullptr, GL_STATIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, matricesUBO);
-
-    glGenTextures(1, &lightDepthMaps);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
-    glTexImage3D(
-        GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, depthMapResolution, depthMapResolution, int(shadowCascadeLevels.size()) + 1,
-        0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    int cascadeLayers = int(shadowCascadeLevels.size()) + 1;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, 1, GL_DEPTH_COMPONENT32F, depthMapResolution, depthMapResolution, cascadeLayers);
+    ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT32F,
+        depthMapResolution, depthMapResolution, cascadeLayers, 1, "cascade shadow maps");
+    lightDepthMaps = TextureHandle(texture);
 
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 
-    glCreateFramebuffers(1, &dirDepthFBO);
+    dirDepthFBO = glutil::createFramebuffer("cascade shadow maps");
     glNamedFramebufferTexture(dirDepthFBO, GL_DEPTH_ATTACHMENT, lightDepthMaps, 0);
     glNamedFramebufferDrawBuffer(dirDepthFBO, GL_NONE);
     glNamedFramebufferReadBuffer(dirDepthFBO, GL_NONE);
@@ -97,143 +95,70 @@ void RenderEngine::render(std::vector<Model>& objs) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
     // Cascaded Shadow calculation
-    auto lightMatrices = getLightSpaceMatrices();
-    if (lightMatricesCache.size() != 0) lightMatrices = lightMatricesCache;
-    glNamedBufferSubData(matricesUBO, 0, sizeof(glm::mat4x4) * lightMatrices.size(), lightMatrices.data());
-
-    cascadeMapPipeline.use();
-
-    glBindFramebuffer(GL_FRAMEBUFFER, dirDepthFBO);
-        glViewport(0, 0, depthMapResolution, depthMapResolution);
-        glClear(GL_DEPTH_BUFFER_BIT);
-
-        glCullFace(GL_FRONT);
-        renderScene(objs, cascadeMapPipeline, true);
-        glCullFace(GL_BACK);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    depthCubemapPipeline.use();
-
-    // Shadow Cubemap Calculation
-    glViewport(0, 0, 2048, 2048);
-    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
-        float aspect = (float)shadowWidth / (float)shadowHeight;
-        float near = 1.0f;
-        float far = 25.0f;
-        glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), aspect, near, far);
-        glm::mat4 planeModel = glm::mat4(1.0f);
-        planeModel = glm::translate(planeModel, glm::vec3(0.0, -2.0, 0.0));
-
-        for (int i = 0; i < 4; i++) {
-            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemaps[i], 0);
-            glClear(GL_DEPTH_BUFFER_BIT);
-
-            glm::vec3 lightPos = pointLights[i].position;
-            std::vector<glm::mat4> shadowTransforms;
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)));
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3(-1.0, 0.0, 0.0), glm::vec3(0.0,-1.0, 0.0)));
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 1.0, 0.0), glm::vec3(0.0, 0.0, 1.0)));
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0,-1.0, 0.0), glm::vec3(0.0, 0.0,-1.0)));
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0, 1.0), glm::vec3(0.0,-1.0, 0.0)));
-            shadowTransforms.push_back(shadowProj * 
-                glm::lookAt(lightPos, lightPos + glm::vec3( 0.0, 0.0,-1.0), glm::vec3(0.0,-1.0, 0.0)));
-
-            for (int i = 0; i < 6; i++) {
-                depthCubemapPipeline.setMat4("shadowMatrices[" + std::to_string(i)+ "]", shadowTransforms[i]);
-            }
-            depthCubemapPipeline.setVec3("lightPos", lightPos);
-            depthCubemapPipeline.setFloat("far_plane", far);
-
-            drawModels(objs, depthCubemapPipeline, SKIP_TEXTURES);
-
-            depthCubemapPipeline.setMat4("model", planeModel);
-            glBindVertexArray(planeBuffer.VAO);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // The plane isn't one of the models but casts and receives like one
+    std::vector<CascadeFit> cascadeFits = fitCascades(objs, fitCascadesToDepth ? &depthReduction : nullptr,
+        cameraNearPlane, cameraFarPlane, cascadeSplitWeight, camera->aspect, directionLight.direction, depthMapResolution,
+        shadowCascadeLevels, cascadeNearDepth, cascadeFarDepth, glm::vec3(-25.0f, -2.5f, -25.0f), glm::vec3(25.0f, -2.5f, 25.0f));
+    cascadeScheduler.update(cascadeFits, directionLight.direction, objs, depthMapResolution);
+    // Layers kept from earlier frames are read back with the matrix they were drawn with
+    lightMatricesCache = cascadeScheduler.getMatrices();
+    updateFrameConstants(lightMatricesCache);
+
+    cascadeVolumes.clear();
+    for (const glm::mat4& lightMatrix : lightMatricesCache) {
+        cascadeVolumes.push_back(ShadowVolume::fromMatrix(lightMatrix));
+    }
 
     glm::mat4 projection = camera->getProjectionMatrix();
     glm::mat4 view = camera->getViewMatrix();
 
-    pipeline.use();
-
-    pipeline.setMat4("projection", projection);
-    pipeline.setMat4("view", view);
-    pipeline.setFloat("shininess", shininess);
-    pipeline.setFloat("far_plane", cameraFarPlane);
-
-    pipeline.setVec3("dirLight.direction", directionLight.direction);
-    pipeline.setVec3("dirLight.ambient", directionLight.ambient);
-    pipeline.setVec3("dirLight.specular", directionLight.specular);
-    pipeline.setVec3("dirLight.diffuse", directionLight.diffuse);
-
-    for (int i = 0; i < 4; i++) {
-        std::string name = "pointLights[" + std::to_string(i) + "]";
-
-        pipeline.setVec3(name + ".position", pointLights[i].position);
-        pipeline.setVec3(name + ".ambient", pointLights[i].ambient);
-        pipeline.setVec3(name + ".specular", pointLights[i].specular);
-        pipeline.setVec3(name + ".diffuse", pointLights[i].diffuse);
-    }
-
-    pipeline.setVec3("viewPos", camera->Position);
-
-    glBindTextureUnit(3, depthMap);
-    pipeline.setInt("shadowMap", 3);
-
-    pipeline.setInt("cascadeCount", shadowCascadeLevels.size());
-    for (size_t i = 0; i < shadowCascadeLevels.size(); i++) {
-        pipeline.setFloat("cascadePlaneDistances[" + std::to_string(i) + "]", shadowCascadeLevels[i]);
+    glm::vec3 pointLightPositions[4];
+    for (int i = 0; i < 4; i++) pointLightPositions[i] = pointLights[i].position;
+    pointShadows.update(pointLightPositions, objs, *camera);
+
+    // Passes only read the scene while recording, so they go wide and replay in order here
+    updateAnimations(objs);
+    ThreadPool::get().parallelFor(NUM_RECORDED_PASSES, [&](size_t pass) {
+        recordPass(pass, objs);
+    });
+
+    GPUTimer& mainTimer = useDepthPrePass ? prePassMainPassTimer : mainPassTimer;
+    for (int i = 0; i < NUM_RECORDED_PASSES; i++) {
+        if (i == RECORDED_MAIN_PASS) mainTimer.begin();
+        passCommands[i].execute();
+        if (i == RECORDED_MAIN_PASS) mainTimer.end();
+        renderQueue.addFrameStats(passQueues[i].takeFrameStats());
     }
-    glActiveTexture(GL_TEXTURE8);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
-    pipeline.setInt("cascadedMap", 8);
-    pipeline.setMat4("view", view);
+    // Before the sky, which would only add far depth
+    depthReduction.reduceFramebuffer(0, WINDOW_WIDTH, WINDOW_HEIGHT, camera->zNear, camera->zFar);
 
-    for (int i = 0; i < 4; i++) {
-        glActiveTexture(GL_TEXTURE4 + i);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemaps[i]);
-        pipeline.setInt("shadowMaps[" + std::to_string(i) + "]", 4 + i);
-    }
-
-    renderScene(objs, pipeline);
-
-    if (lightMatricesCache.size() != 0) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (showCascadeVolumes) {
+        GLState::get().enable(GL_BLEND);
+        GLState::get().blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         debugCascadePipeline.use();
-        debugCascadePipeline.setMat4("projection", projection);
-        debugCascadePipeline.setMat4("view", view);
         drawCascadeVolumeVisualizers(lightMatricesCache, &debugCascadePipeline);
-        glDisable(GL_BLEND);
+        GLState::get().disable(GL_BLEND);
     }
 
-    glDepthFunc(GL_LEQUAL);
+    GLState::get().depthFunc(GL_LEQUAL);
         glm::mat4 convertedView = glm::mat4(glm::mat3(view));
         mapPipeline.use();
         mapPipeline.setMat4("projection", projection);
         mapPipeline.setMat4("view", convertedView);
 
-        glBindVertexArray(cubemapBuffer.VAO);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+        GLState::get().bindVertexArray(cubemapBuffer.VAO);
+        GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
         glDrawArrays(GL_TRIANGLES, 0, 36);
-    glDepthFunc(GL_LESS);
+        GLState::get().recordDraw();
+    GLState::get().depthFunc(GL_LESS);
 
     debugDepthPipeline.use();
     debugDepthPipeline.setInt("layer", debugLayer);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
+    GLState::get().bindTexture(0, GL_TEXTURE_2D_ARRAY, lightDepthMaps);
     if (showQuad) {
-        glBindVertexArray(quadBuffer.VAO);
+        GLState::get().bindVertexArray(quadBuffer.VAO);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLState::get().recordDraw();
     }
 }
 
@@ -248,19 +173,186 @@ void RenderEngine::checkFrustum(std::vector<Model>& objs) {
     }
 }
 
-void RenderEngine::renderScene(std::vector<Model>& objs, Shader& shader, bool skipTextures) {
-    drawModels(objs, shader, skipTextures & SKIP_TEXTURES);
+void RenderEngine::updateFrameConstants(const std::vector<glm::mat4>& lightMatrices) {
+    frameConstants.setCamera(camera->getProjectionMatrix(), camera->getViewMatrix(), camera->Position,
+        cameraNearPlane, cameraFarPlane, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    FrameDirLight& dirLight = frameConstants.lights.dirLight;
+    dirLight.direction = directionLight.direction;
+    dirLight.ambient = directionLight.ambient;
+    dirLight.diffuse = directionLight.diffuse;
+    dirLight.specular = directionLight.specular;
+
+    frameConstants.lights.numPointLights = 4;
+    for (int i = 0; i < 4; i++) {
+        FramePointLight& light = frameConstants.lights.pointLights[i];
+        light.position = pointLights[i].position;
+        light.ambient = pointLights[i].ambient;
+        light.diffuse = pointLights[i].diffuse;
+        light.specular = pointLights[i].specular;
+    }
+
+    ShadowConstants& shadows = frameConstants.shadows;
+    for (size_t i = 0; i < lightMatrices.size() && i < MAX_SHADOW_CASCADES; i++) {
+        shadows.lightSpaceMatrices[i] = lightMatrices[i];
+    }
+    for (size_t i = 0; i < shadowCascadeLevels.size() && i < MAX_SHADOW_CASCADES; i++) {
+        shadows.cascadePlaneDistances[i].x = shadowCascadeLevels[i];
+    }
+    shadows.cascadeCount = shadowCascadeLevels.size();
+    shadows.cascadeFarPlane = cascadeFarDepth;
+
+    frameConstants.upload();
+}
+
+void RenderEngine::recordPass(int pass, std::vector<Model>& objs) {
+    CommandBuffer& commands = passCommands[pass];
+    RenderQueue& queue = passQueues[pass];
+    commands.reset();
+
+    if (pass == RECORDED_CASCADE_PASS) {
+        uint32_t updateMask = cascadeScheduler.getUpdateMask();
+        shadowCullingStats[pass] = ShadowCullingStats();
+        if (updateMask == 0) return;
+
+        // Only the layers being redrawn are cleared, the rest keep their depth from earlier frames
+        commands.bindFramebuffer(dirDepthFBO);
+        commands.viewport(0, 0, depthMapResolution, depthMapResolution);
+        for (size_t i = 0; i < cascadeVolumes.size(); i++) {
+            if (updateMask & (1u << i)) commands.clearDepthRegion(lightDepthMaps, 0, 0, depthMapResolution, depthMapResolution, 1.0f, i);
+        }
+
+        commands.cullFace(GL_FRONT);
+        shadowCullingStats[pass] = submitShadowCasters(queue, objs, cascadeMapPipeline, cascadeVolumes, nullptr, updateMask);
+        recordQueue(queue, commands, SKIP_TEXTURES);
+        recordPlane(commands, cascadeMapPipeline, true, ~updateMask);
+        commands.cullFace(GL_BACK);
+    } else if (pass < RECORDED_MAIN_PASS) {
+        recordPointShadowPass(pass - RECORDED_POINT_SHADOW_PASS, commands, queue, objs);
+    } else {
+        recordMainPass(commands, queue, objs);
+    }
+}
+
+void RenderEngine::recordPointShadowPass(int light, CommandBuffer& commands, RenderQueue& queue, std::vector<Model>& objs) {
+    const PointShadowLight& shadow = pointShadows.getLight(light);
+    shadowCullingStats[RECORDED_POINT_SHADOW_PASS + light] = ShadowCullingStats();
+    if (shadow.updateMask == 0) return;
+
+    const ProgramReflection& reflection = pointShadowPipeline.getReflection();
+    unsigned int program = pointShadowPipeline.ID;
+    commands.setVec3(program, reflection.getLocation("lightPos"_u), shadow.position);
+    commands.setFloat(program, reflection.getLocation("far_plane"_u), pointShadows.farPlane);
+
+    auto isStatic = [&](size_t model) { return !pointShadows.isDynamic(model); };
+    auto isDynamic = [&](size_t model) { return pointShadows.isDynamic(model); };
+
+    // Each face draws only the casters in its own frustum into its own tile
+    for (int i = 0; i < POINT_SHADOW_FACES; i++) {
+        if ((shadow.updateMask & (1u << i)) == 0) continue;
+
+        const PointShadowFace& face = shadow.faces[i];
+        const ShadowAtlasRegion& region = face.region;
+        std::vector<ShadowVolume> volumes = { face.volume };
+        ShadowCullingStats& stats = shadowCullingStats[RECORDED_POINT_SHADOW_PASS + light];
+        commands.setMat4(program, reflection.getLocation("faceMatrix"_u), face.viewProjection);
+
+        if (!pointShadows.useCache) {
+            commands.clearDepthRegion(pointShadows.getAtlas(), region.x, region.y, region.size, region.size);
+            commands.bindFramebuffer(pointShadows.getFramebuffer());
+            commands.viewport(region.x, region.y, region.size, region.size);
+            stats.add(submitShadowCasters(queue, objs, pointShadowPipeline, volumes));
+            recordQueue(queue, commands, SKIP_TEXTURES);
+            recordPlane(commands, pointShadowPipeline, true);
+            continue;
+        }
+
+        if (shadow.staticMask & (1u << i)) {
+            commands.clearDepthRegion(pointShadows.getStaticAtlas(), region.x, region.y, region.size, region.size);
+            commands.bindFramebuffer(pointShadows.getStaticFramebuffer());
+            commands.viewport(region.x, region.y, region.size, region.size);
+            stats.add(submitShadowCasters(queue, objs, pointShadowPipeline, volumes, isStatic));
+            recordQueue(queue, commands, SKIP_TEXTURES);
+            recordPlane(commands, pointShadowPipeline, true);
+        }
+
+        commands.copyTextureRegion(pointShadows.getStaticAtlas(), pointShadows.getAtlas(),
+            region.x, region.y, region.size, region.size);
+        commands.bindFramebuffer(pointShadows.getFramebuffer());
+        commands.viewport(region.x, region.y, region.size, region.size);
+        stats.add(submitShadowCasters(queue, objs, pointShadowPipeline, volumes, isDynamic));
+        recordQueue(queue, commands, SKIP_TEXTURES);
+    }
+    commands.bindFramebuffer(0);
+}
+
+void RenderEngine::recordMainPass(CommandBuffer& commands, RenderQueue& queue, std::vector<Model>& objs) {
+    commands.bindFramebuffer(0);
+    commands.viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    commands.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    // Culled and sorted once, the pre-pass and the shading pass both draw this queue
+    submitModels(queue, objs, pipeline);
+
+    if (useDepthPrePass) {
+        recordDepthPrePass(queue, commands, depthPrePassPipeline);
+        recordPlane(commands, depthPrePassPipeline, true);
+
+        // Only the fragments that won the pre-pass get shaded
+        commands.depthFunc(GL_EQUAL);
+        commands.depthMask(false);
+    }
+
+    // Camera, lights and cascade data come from the frame constant blocks
+    const ProgramReflection& reflection = pipeline.getReflection();
+    unsigned int program = pipeline.ID;
+    commands.useProgram(program);
+
+    commands.setFloat(program, reflection.getLocation("shininess"_u), shininess);
+    // Point shadow depth is stored over the shadow's range, not the camera's
+    commands.setFloat(program, reflection.getLocation("far_plane"_u), pointShadows.farPlane);
+
+    commands.bindTexture(3, depthMap);
+    commands.setSampler(program, reflection.getLocation("shadowMap"_u), 3);
+
+    commands.bindTexture(8, lightDepthMaps, GL_TEXTURE_2D_ARRAY);
+    commands.setSampler(program, reflection.getLocation("cascadedMap"_u), 8);
+
+    commands.bindTexture(4, pointShadows.getAtlas());
+    commands.setSampler(program, reflection.getLocation("pointShadowAtlas"_u), 4);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < POINT_SHADOW_FACES; j++) {
+            int face = i * POINT_SHADOW_FACES + j;
+            commands.setMat4(program, reflection.getLocation(uniformArray("pointShadowMatrices", face)),
+                pointShadows.getLight(i).faces[j].viewProjection);
+            commands.setVec4(program, reflection.getLocation(uniformArray("pointShadowRects", face)), pointShadows.getRect(i, j));
+        }
+    }
+
+    recordQueue(queue, commands);
+    recordPlane(commands, pipeline, false);
+
+    if (useDepthPrePass) {
+        commands.depthFunc(GL_LESS);
+        commands.depthMask(true);
+    }
+}
+
+void RenderEngine::recordPlane(CommandBuffer& commands, const Shader& shader, bool skipTextures, uint32_t culledLayers) {
     glm::mat4 planeModel = glm::mat4(1.0f);
     planeModel = glm::translate(planeModel, glm::vec3(0.0, -2.0, 0.0));
 
+    const ProgramReflection& reflection = shader.getReflection();
+    commands.useProgram(shader.ID);
     if (!skipTextures) {
-        glBindTextureUnit(0, planeTexture);
-        shader.setInt("diffuseTexture", 0);
+        commands.bindTexture(0, planeTexture);
+        commands.setSampler(shader.ID, reflection.getLocation("diffuseTexture"_u), 0);
     }
-    shader.setMat4("model", planeModel);
-    glBindVertexArray(planeBuffer.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    commands.setMat4(shader.ID, reflection.getLocation("model"_u), planeModel);
+    commands.setInt(shader.ID, reflection.getLocation("culledLayers"_u), (int) culledLayers);
+    commands.setInt(shader.ID, reflection.getLocation("useInstances"_u), 0);
+    commands.bindVertexArray(planeBuffer.VAO);
+    commands.drawArrays(GL_TRIANGLES, 0, 6);
 }
 
 void RenderEngine::handleImGui() {
@@ -285,6 +377,9 @@ void RenderEngine::handleImGui() {
         ImGui::SliderFloat3("Ambient", (float*)&directionLight.ambient, 0.0, 1.0);
         ImGui::SliderFloat3("Specular", (float*)&directionLight.specular, 0.0, 1.0);
         ImGui::SliderFloat3("Diffuse", (float*)&directionLight.diffuse, 0.0, 1.0);
+        ImGui::Checkbox("Fit Cascades To Depth", &fitCascadesToDepth);
+        ImGui::SliderFloat("Log Split Weight", &cascadeSplitWeight, 0.0f, 1.0f);
+        ImGui::Text("Cascade Range: %.2f - %.2f", cascadeNearDepth, cascadeFarDepth);
     }
 
     if (ImGui::CollapsingHeader("Extras")) {
@@ -302,6 +397,43 @@ void RenderEngine::handleImGui() {
     }
 }
 
+void RenderEngine::handleStatsImGui() {
+    if (ImGui::CollapsingHeader("Main Pass")) {
+        ImGui::Checkbox("Depth Pre-Pass", &useDepthPrePass);
+        ImGui::Text("Without Pre-Pass: %.3f ms", mainPassTimer.getMilliseconds());
+        ImGui::Text("With Pre-Pass: %.3f ms", prePassMainPassTimer.getMilliseconds());
+    }
+    if (ImGui::CollapsingHeader("Point Shadows")) {
+        const PointShadowStats& stats = pointShadows.getStats();
+        ImGui::Checkbox("Cache Static Casters", &pointShadows.useCache);
+        ImGui::SliderInt("Faces Per Frame", &pointShadows.faceBudget, 1, 4 * POINT_SHADOW_FACES);
+        ImGui::Text("Updated: %u faces (%u static), pending %u", stats.faceUpdates, stats.staticUpdates, stats.pendingFaces);
+        ImGui::Text("Dynamic Casters: %u", stats.dynamicCasters);
+        ImGui::Text("Atlas: %.0f%% used", 100.0f * stats.atlasUsedArea / stats.atlasArea);
+        for (unsigned int i = 0; i < pointShadows.getNumLights(); i++) {
+            const PointShadowLight& light = pointShadows.getLight(i);
+            ImGui::Text("Point Light %u: %u px, priority %.2f", i, light.resolution, light.priority);
+        }
+    }
+    if (ImGui::CollapsingHeader("Cascades")) {
+        const CascadeSchedulerStats& stats = cascadeScheduler.getStats();
+        int cascadeCount = shadowCascadeLevels.size() + 1;
+        ImGui::Checkbox("Cache Far Cascades", &cascadeScheduler.useCache);
+        ImGui::SliderInt("First Cached Cascade", &cascadeScheduler.firstCachedCascade, 0, cascadeCount);
+        ImGui::SliderInt("Far Cascade Interval", &cascadeScheduler.interval, 1, 16);
+        ImGui::Text("Updated: %u (%u forced), reused %u", stats.updated, stats.forced, stats.reused);
+        ImGui::Checkbox("Show Cascade Volumes", &showCascadeVolumes);
+    }
+    if (ImGui::CollapsingHeader("Shadow Casters")) {
+        for (int i = 0; i < RECORDED_MAIN_PASS; i++) {
+            const ShadowCullingStats& stats = shadowCullingStats[i];
+            std::string name = i == RECORDED_CASCADE_PASS ? "Cascades" : "Point Light " + std::to_string(i - RECORDED_POINT_SHADOW_PASS);
+            ImGui::Text("%s: %u of %u casters, %u of %u layer draws", name.c_str(), stats.casters - stats.culledCasters,
+                stats.casters, stats.layerDraws, stats.possibleLayerDraws);
+        }
+    }
+}
+
 void RenderEngine::drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& lightMatrices, Shader* shader)
 {
     visualizerVAOs.resize(8);
@@ -343,26 +475,29 @@ void RenderEngine::drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& li
         glGenBuffers(1, &visualizerVBOs[i]);
         glGenBuffers(1, &visualizerEBOs[i]);
 
-        glBindVertexArray(visualizerVAOs[i]);
+        GLState::get().bindVertexArray(visualizerVAOs[i]);
 
         glBindBuffer(GL_ARRAY_BUFFER, visualizerVBOs[i]);
         glBufferData(GL_ARRAY_BUFFER, vec3s.size() * sizeof(glm::vec3), &vec3s[0], GL_STATIC_DRAW);
+        GLState::get().recordUpload(vec3s.size() * sizeof(glm::vec3));
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, visualizerEBOs[i]);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, 36 * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+        GLState::get().recordUpload(36 * sizeof(GLuint));
 
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
 
-        glBindVertexArray(visualizerVAOs[i]);
+        GLState::get().bindVertexArray(visualizerVAOs[i]);
         shader->setVec4("color", colors[i % 3]);
         glDrawElements(GL_TRIANGLES, GLsizei(36), GL_UNSIGNED_INT, 0);
+        GLState::get().recordDraw();
 
         glDeleteBuffers(1, &visualizerVBOs[i]);
         glDeleteBuffers(1, &visualizerEBOs[i]);
         glDeleteVertexArrays(1, &visualizerVAOs[i]);
 
-        glBindVertexArray(0);
+        GLState::get().bindVertexArray(0);
     }
 
     visualizerVAOs.clear();
@@ -370,61 +505,6 @@ void RenderEngine::drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& li
     visualizerVBOs.clear();
 }
 
-std::vector<glm::mat4> RenderEngine::getLightSpaceMatrices() {
-    std::vector<glm::mat4> result;
-
-    for (int i = 0; i < shadowCascadeLevels.size() + 1; i++) {
-        if (i == 0)
-            result.push_back(getLightSpaceMatrix(cameraNearPlane, shadowCascadeLevels[i]));
-        else if (i < shadowCascadeLevels.size())
-            result.push_back(getLightSpaceMatrix(shadowCascadeLevels[i-1], shadowCascadeLevels[i]));
-        else
-            result.push_back(getLightSpaceMatrix(shadowCascadeLevels[i-1], cameraFarPlane));
-    }
-
-    return result;
-}
-
-glm::mat4 RenderEngine::getLightSpaceMatrix(float nearPlane, float farPlane) {
-    const auto proj = glm::perspective(
-        glm::radians(camera->Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, nearPlane,
-        farPlane);
-    auto corners = getFrustumCornerWorldSpace(proj, camera->getViewMatrix());
-
-    glm::vec3 center(0, 0, 0);
-    for (const auto& v : corners) center += glm::vec3(v);
-    center /= corners.size();
-
-    const auto lightView = glm::lookAt(center + directionLight.direction, center, glm::vec3(0.0f, 1.0f, 0.0f));
-
-    float minX = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float minY = std::numeric_limits<float>::max();
-    float maxY = std::numeric_limits<float>::lowest();
-    float minZ = std::numeric_limits<float>::max();
-    float maxZ = std::numeric_limits<float>::lowest();
-    for (const auto& v : corners)
-    {
-        const auto trf = lightView * v;
-        minX = std::min(minX, trf.x);
-        maxX = std::max(maxX, trf.x);
-        minY = std::min(minY, trf.y);
-        maxY = std::max(maxY, trf.y);
-        minZ = std::min(minZ, trf.z);
-        maxZ = std::max(maxZ, trf.z);
-    }
-
-    float zMult = 10.0f;
-    if (minZ < 0) minZ *= zMult;
-    else minZ /= zMult;
-
-    if (maxZ < 0) maxZ /= zMult;
-    else maxZ *= zMult;
-
-    const glm::mat4 lightProjection = glm::ortho(minX, maxX, minY, maxY, minZ, maxZ);
-    return lightProjection * lightView;
-}
-
 std::vector<glm::vec4> RenderEngine::getFrustumCornerWorldSpace(const glm::mat4& proj, const glm::mat4& view) {
     const auto inv = glm::inverse(proj * view);
 
@@ -4,14 +4,25 @@
 #include <SDL.h>
 #include <vector>
 
+#include "utils/cascade_fitting.h"
+#include "utils/cascade_scheduler.h"
 #include "utils/gl_compute.h"
+#include "utils/gl_depth_reduction.h"
+#include "utils/gl_point_shadows.h"
 #include "gl_base_engine.h"
 
+// Passes recorded in parallel each frame: the cascades, one per point light cubemap, then the main pass
+#define RECORDED_CASCADE_PASS 0
+#define RECORDED_POINT_SHADOW_PASS 1
+#define RECORDED_MAIN_PASS 5
+#define NUM_RECORDED_PASSES 6
+
 class RenderEngine : public GLEngine {
     public:
         void init_resources();
         void render(std::vector<Model>& objs);
         void handleImGui();
+        void handleStatsImGui();
     
     private:
         ImGuizmo::OPERATION operation = ImGuizmo::OPERATION::TRANSLATE;
@@ -26,32 +37,42 @@ class RenderEngine : public GLEngine {
 
         AllocatedBuffer quadBuffer;
         
-        unsigned int depthFBO;
-        unsigned int depthMap;
+        TextureHandle depthMap;
 
-        unsigned int depthCubemaps[4];
-        int shadowHeight = 2048, shadowWidth = 2048;
+        PointShadowCache pointShadows;
 
         float cameraNearPlane = 0.1f;
         float cameraFarPlane = 100.0f;
         int depthMapResolution = 2048;
-        unsigned int lightDepthMaps;
-        unsigned int dirDepthFBO;
+        TextureHandle lightDepthMaps;
+        FramebufferHandle dirDepthFBO;
 
-        unsigned int matricesUBO;
+        // Split again every frame, the initial size sets the cascade count
         std::vector<float> shadowCascadeLevels = { cameraFarPlane / 50.0f, cameraFarPlane / 25.0f, cameraFarPlane / 10.0f, cameraFarPlane / 2.0f };
 
+        // Cascades split the depth range actually on screen, from last frames' depth buffer,
+        // instead of the whole camera range
+        DepthReduction depthReduction;
+        bool fitCascadesToDepth = true;
+        float cascadeSplitWeight = 0.8f;
+        float cascadeNearDepth = 0.0f, cascadeFarDepth = 0.0f;
+        CascadeScheduler cascadeScheduler;
+
         std::vector<GLuint> visualizerVAOs;
         std::vector<GLuint> visualizerVBOs;
         std::vector<GLuint> visualizerEBOs;
 
         Shader pipeline;
+        // Same vertex shader as pipeline, so the main pass can test GL_EQUAL against what it wrote
+        Shader depthPrePassPipeline;
         Shader mapPipeline;
         Shader cascadeMapPipeline;
-        Shader depthCubemapPipeline;
+        Shader pointShadowPipeline;
 
         Shader debugCascadePipeline;
+        // Matrix each cascade layer was last drawn with, what the shaders read it with
         std::vector<glm::mat4> lightMatricesCache;
+        bool showCascadeVolumes = false;
         Shader debugDepthPipeline;
         int debugLayer = 0;
         bool showQuad = false;
@@ -60,12 +81,27 @@ class RenderEngine : public GLEngine {
         PointLight pointLights[4];
         DirLight directionLight;
 
+        RenderQueue passQueues[NUM_RECORDED_PASSES];
+        CommandBuffer passCommands[NUM_RECORDED_PASSES];
+
+        // The main pass shades every covered fragment once when the pre-pass lays depth down first.
+        // Each timer only runs in its own mode, so the last value of both stays up for comparison.
+        bool useDepthPrePass = true;
+        GPUTimer mainPassTimer;
+        GPUTimer prePassMainPassTimer;
+
+        // Cascade volumes of the frame, casters go only to the cascades and cube faces they reach
+        std::vector<ShadowVolume> cascadeVolumes;
+        ShadowCullingStats shadowCullingStats[RECORDED_MAIN_PASS];
+
         void checkFrustum(std::vector<Model> &objs);
-        void renderScene(std::vector<Model> &objs, Shader& shader, bool skipTextures = false);
+        void updateFrameConstants(const std::vector<glm::mat4>& lightMatrices);
+        void recordPass(int pass, std::vector<Model> &objs);
+        void recordPointShadowPass(int light, CommandBuffer& commands, RenderQueue& queue, std::vector<Model> &objs);
+        void recordMainPass(CommandBuffer& commands, RenderQueue& queue, std::vector<Model> &objs);
+        void recordPlane(CommandBuffer& commands, const Shader& shader, bool skipTextures, uint32_t culledLayers = 0);
 
         void drawCascadeVolumeVisualizers(const std::vector<glm::mat4>& lightMatrices, Shader* shader);
 
-        std::vector<glm::mat4> getLightSpaceMatrices();
-        glm::mat4 getLightSpaceMatrix(float nearPlane, float farPlane);
         std::vector<glm::vec4> getFrustumCornerWorldSpace(const glm::mat4& proj, const glm::mat4& view);
 };
\ No newline at end of file
@@ -1,14 +1,7 @@
 #pragma once
 
 #include "gl_base_engine.h"
-
-struct IndirectCommandData {
-    unsigned int indexCount;
-    unsigned int instanceCount;
-    unsigned int firstIndex;
-    int baseVertex;
-    unsigned int baseInstance = 0;
-};
+#include "utils/gl_gpu_scene.h"
 
 struct IndirectArraysCommandData {
     unsigned int vertexCount;
@@ -25,18 +18,9 @@ public:
     void handleObjs(std::vector<Model>& objs);
 
 private:
-    GLuint indirectDrawBuffer;
-    std::vector<IndirectCommandData> mIndirectCommands;
-
-    GLuint textureHandleBuffer, numTextureBuffer;
-    std::vector<GLuint64> mTextureHandles;
-    std::vector<unsigned int> mNumTextures;
+    GPUScene scene;
 
     DirLight directionalLight;
 
-    int index = 0;
-
-
-    AllocatedBuffer simpleBuffer;
     Shader simplePipeline;
 };
\ No newline at end of file
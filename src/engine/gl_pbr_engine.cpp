@@ -1,12 +1,14 @@
 #include "gl_pbr_engine.h"
 
 void PBREngine::init_resources() {
-    pipeline = Shader("pbr/basicVertex.glsl", "pbr/basicFragment.glsl");
-    convertToCubemapPipeline = Shader("pbr/cubemapVertex.glsl", "pbr/cubemapFragment.glsl");
-    createIrradiancePipeline = Shader("pbr/cubemapVertex.glsl", "pbr/irradianceFragment.glsl");
-    backgroundPipeline = Shader("pbr/backgroundV.glsl", "pbr/backgroundF.glsl");
-    prefilterPipeline = Shader("pbr/cubemapVertex.glsl", "pbr/prefilterF.glsl");
-    brdfPipeline = Shader("pbr/brdfV.glsl", "pbr/brdfF.glsl");
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(pipeline, "pbr/basicVertex.glsl", "pbr/basicFragment.glsl");
+    shaders.load(convertToCubemapPipeline, "pbr/cubemapVertex.glsl", "pbr/cubemapFragment.glsl");
+    shaders.load(createIrradiancePipeline, "pbr/cubemapVertex.glsl", "pbr/irradianceFragment.glsl");
+    shaders.load(backgroundPipeline, "pbr/backgroundV.glsl", "pbr/backgroundF.glsl");
+    shaders.load(prefilterPipeline, "pbr/cubemapVertex.glsl", "pbr/prefilterF.glsl");
+    shaders.load(brdfPipeline, "pbr/brdfV.glsl", "pbr/brdfF.glsl");
+    shaders.finish();
 
     albedoMap = glutil::loadTexture("../../resources/textures/reinforced-metal/reinforced-metal_albedo.png");
     aoMap = glutil::loadTexture("../../resources/textures/reinforced-metal/reinforced-metal_ao.png");
@@ -61,8 +63,8 @@ void PBREngine::init_resources() {
 
     glNamedRenderbufferStorage(irradianceRBO, GL_DEPTH_ATTACHMENT, 32, 32);
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    GLState::get().enable(GL_DEPTH_TEST);
+    GLState::get().depthFunc(GL_LEQUAL);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     createIrradianceMap();
@@ -155,29 +157,29 @@ void PBREngine::createIrradianceMap() {
     
     convertToCubemapPipeline.use();
     convertToCubemapPipeline.setMat4("projection", captureProjection);
-    glBindTextureUnit(0, hdrTexture);
+    GLState::get().bindTextureUnit(0, hdrTexture);
     convertToCubemapPipeline.setInt("equirectangularMap", 0);
 
-    glViewport(0, 0, 512, 512);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLState::get().viewport(0, 0, 512, 512);
+    GLState::get().bindFramebuffer(captureFBO);
 
     for (unsigned int i = 0; i < 6; i++) {
         convertToCubemapPipeline.setMat4("view", captureViews[i]);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, cubemapTexture, 0);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glBindVertexArray(cubemapBuffer.VAO);
+        GLState::get().bindVertexArray(cubemapBuffer.VAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        GLState::get().recordDraw();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::get().bindFramebuffer(0);
 
     prefilterPipeline.use();
     prefilterPipeline.setInt("environmentMap", 0);
     prefilterPipeline.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLState::get().bindFramebuffer(captureFBO);
     unsigned int maxMipLevels = 5;
     for (unsigned int mip = 0; mip < maxMipLevels; mip++) {
         unsigned int mipWidth = 128 * std::pow(0.5, mip);
@@ -185,7 +187,7 @@ void PBREngine::createIrradianceMap() {
 
         glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
         glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
-        glViewport(0, 0, mipWidth, mipHeight);
+        GLState::get().viewport(0, 0, mipWidth, mipHeight);
 
         float roughness = (float)mip / (float)(maxMipLevels - 1);
         prefilterPipeline.setFloat("roughness", roughness);
@@ -196,48 +198,50 @@ void PBREngine::createIrradianceMap() {
                 prefilterMap, mip);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-            glBindVertexArray(cubemapBuffer.VAO);
+            GLState::get().bindVertexArray(cubemapBuffer.VAO);
             glDrawArrays(GL_TRIANGLES, 0, 36);
+            GLState::get().recordDraw();
         }
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::get().bindFramebuffer(0);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLState::get().bindFramebuffer(captureFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, irradianceRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
 
     createIrradiancePipeline.use();
     createIrradiancePipeline.setInt("enviornmentMap", 0);
     createIrradiancePipeline.setMat4("projection", captureProjection);
-    glActiveTexture(0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
 
-    glViewport(0, 0, 32, 32);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLState::get().viewport(0, 0, 32, 32);
+    GLState::get().bindFramebuffer(captureFBO);
     for (unsigned int i = 0; i < 6; i++) {
         convertToCubemapPipeline.setMat4("view", captureViews[i]);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glBindVertexArray(cubemapBuffer.VAO);
+        GLState::get().bindVertexArray(cubemapBuffer.VAO);
         glDrawArrays(GL_TRIANGLES, 0, 36);
+        GLState::get().recordDraw();
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::get().bindFramebuffer(0);
 
-    glViewport(0, 0, 512, 512);
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    GLState::get().viewport(0, 0, 512, 512);
+    GLState::get().bindFramebuffer(captureFBO);
     glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 512, 512);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
 
     brdfPipeline.use();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glBindVertexArray(quadBuffer.VAO);
+    GLState::get().bindVertexArray(quadBuffer.VAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    GLState::get().recordDraw();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::get().bindFramebuffer(0);
 
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
 
 void PBREngine::createPrefilter() {
@@ -266,17 +270,14 @@ void PBREngine::render(std::vector<Model> &objs) {
     pipeline.setInt("irradianceMap", 0);
     pipeline.setInt("prefilterMap", 1);
     pipeline.setInt("brdfLUT", 2);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+    GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, irradianceMap);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+    GLState::get().bindTexture(1, GL_TEXTURE_CUBE_MAP, prefilterMap);
+    GLState::get().bindTexture(2, GL_TEXTURE_2D, brdfLUTTexture);
 
     for (unsigned int i = 0; i < lightPositions.size(); i++) {
-        pipeline.setVec3("lights[" + std::to_string(i) + "].position", lightPositions[i]);
-        pipeline.setVec3("lights[" + std::to_string(i) + "].color", lightColors[i]);
+        pipeline.setVec3(uniformArray("lights", i, "position"), lightPositions[i]);
+        pipeline.setVec3(uniformArray("lights", i, "color"), lightColors[i]);
     }
 
     glm::mat4 model = glm::mat4(1.0f);
@@ -285,16 +286,11 @@ void PBREngine::render(std::vector<Model> &objs) {
         drawModels(objs, pipeline);
         pipeline.setBool("isModel", false);
     } else {
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, albedoMap);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, normalMap);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, metallicMap);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, aoMap);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, roughnessMap);
+        GLState::get().bindTexture(3, GL_TEXTURE_2D, albedoMap);
+        GLState::get().bindTexture(4, GL_TEXTURE_2D, normalMap);
+        GLState::get().bindTexture(5, GL_TEXTURE_2D, metallicMap);
+        GLState::get().bindTexture(6, GL_TEXTURE_2D, aoMap);
+        GLState::get().bindTexture(7, GL_TEXTURE_2D, roughnessMap);
 
         pipeline.setInt("texture_diffuse", 3);
         pipeline.setInt("texture_normal", 4);
@@ -319,8 +315,9 @@ void PBREngine::render(std::vector<Model> &objs) {
                 ));
                 pipeline.setMat4("model", model);
 
-                glBindVertexArray(sphereBuffer.VAO);
+                GLState::get().bindVertexArray(sphereBuffer.VAO);
                 glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+                GLState::get().recordDraw();
             }
         }
     }
@@ -329,26 +326,27 @@ void PBREngine::render(std::vector<Model> &objs) {
     {
         glm::vec3 newPos = lightPositions[i] + glm::vec3(sin(SDL_GetTicks() * 5.0) * 5.0, 0.0, 0.0);
         newPos = lightPositions[i];
-        pipeline.setVec3("lights[" + std::to_string(i) + "].position", lightPositions[i]);
-        pipeline.setVec3("lights[" + std::to_string(i) + "].color", lightColors[i]);
+        pipeline.setVec3(uniformArray("lights", i, "position"), lightPositions[i]);
+        pipeline.setVec3(uniformArray("lights", i, "color"), lightColors[i]);
 
         model = glm::mat4(1.0f);
         model = glm::translate(model, newPos);
         model = glm::scale(model, glm::vec3(0.5f));
         pipeline.setMat4("model", model);
-        glBindVertexArray(sphereBuffer.VAO);
+        GLState::get().bindVertexArray(sphereBuffer.VAO);
         glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+        GLState::get().recordDraw();
     }
 
     backgroundPipeline.use();
     backgroundPipeline.setMat4("projection", projection);
     backgroundPipeline.setMat4("view", view);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
     backgroundPipeline.setInt("environmentMap", 0);
 
-    glBindVertexArray(cubemapBuffer.VAO);
+    GLState::get().bindVertexArray(cubemapBuffer.VAO);
     glDrawArrays(GL_TRIANGLES, 0, 36);
+    GLState::get().recordDraw();
 }
 
 void PBREngine::handleImGui(){
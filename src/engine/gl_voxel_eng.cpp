@@ -2,13 +2,19 @@
 
 #include "glm/gtx/component_wise.hpp"
 
+#include <algorithm>
+
 void VoxelEngine::init_resources() {
     camera->zNear = cameraNearPlane;
     camera->zFar = cameraFarPlane;
 
-    voxelGridPipeline = Shader("coneTracing/voxel.vs", "coneTracing/voxel.fs", "coneTracing/voxel.gs");
-    renderPassPipeline = Shader("coneTracing/colorPass.vs", "coneTracing/colorPass.fs");
-    quadPipeline = Shader("shadows/debug.vs", "shadows/debug.fs");
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(voxelGridPipeline, "coneTracing/voxel.vs", "coneTracing/voxel.fs", "coneTracing/voxel.gs");
+    renderPassPipeline = ShaderVariants("coneTracing/colorPass.vs", "coneTracing/colorPass.fs");
+    shaders.load(quadPipeline, "shadows/debug.vs", "shadows/debug.fs");
+    shaders.load(cascadeMapPipeline, "shadows/cascadeV.glsl", "shadows/map.fs", "shadows/cascadeG.glsl");
+    depthReduction.init();
+    shaders.finish();
 
     voxelGridTexture = glutil::createTexture3D(gridSize, gridSize, gridSize);
     glBindImageTexture(0, voxelGridTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
@@ -36,23 +42,21 @@ void VoxelEngine::init_resources() {
     }
 
     // Create Directional Light Shadow Info
-    cascadeMapPipeline = Shader("shadows/cascadeV.glsl", "shadows/map.fs", "shadows/cascadeG.glsl");
-    glCreateBuffers(1, &matricesUBO);
-    glNamedBufferData(matricesUBO, sizeof(glm::mat4x4) * 16, nullptr, GL_STATIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, matricesUBO);
-
-    glGenTextures(1, &lightDepthMaps);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
-    glTexImage3D(
-        GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, depthMapResolution, depthMapResolution, int(shadowCascadeLevels.size()) + 1,
-        0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-
-    glCreateFramebuffers(1, &shadowMapFBO);
+
+    unsigned int texture;
+    int cascadeLayers = int(shadowCascadeLevels.size()) + 1;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    glTextureStorage3D(texture, 1, GL_DEPTH_COMPONENT32F, depthMapResolution, depthMapResolution, cascadeLayers);
+    ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT32F,
+        depthMapResolution, depthMapResolution, cascadeLayers, 1, "voxel cascade shadow maps");
+    lightDepthMaps = TextureHandle(texture);
+
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTextureParameteri(lightDepthMaps, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+
+    shadowMapFBO = glutil::createFramebuffer("voxel cascade shadow maps");
     glNamedFramebufferTexture(shadowMapFBO, GL_DEPTH_ATTACHMENT, lightDepthMaps, 0);
     glNamedFramebufferDrawBuffer(shadowMapFBO, GL_NONE);
     glNamedFramebufferReadBuffer(shadowMapFBO, GL_NONE);
@@ -75,66 +79,95 @@ void VoxelEngine::render(std::vector<Model>& objs) {
     glm::mat4 view = camera->getViewMatrix();
 
     // Create shadowmap
-    auto lightMatrices = getLightSpaceMatrices();
-    glNamedBufferSubData(matricesUBO, 0, sizeof(glm::mat4x4) * lightMatrices.size(), lightMatrices.data());
+    std::vector<CascadeFit> cascadeFits = fitCascades(objs, fitCascadesToDepth ? &depthReduction : nullptr,
+        cameraNearPlane, cameraFarPlane, cascadeSplitWeight, (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
+        directionalLight.direction, depthMapResolution, shadowCascadeLevels, cascadeNearDepth, cascadeFarDepth);
+    cascadeScheduler.update(cascadeFits, directionalLight.direction, objs, depthMapResolution);
+    // Layers kept from earlier frames are read back with the matrix they were drawn with
+    const std::vector<glm::mat4>& lightMatrices = cascadeScheduler.getMatrices();
+    uint32_t updateMask = cascadeScheduler.getUpdateMask();
+    frameConstants.setCamera(projection, view, camera->Position, cameraNearPlane, cameraFarPlane,
+        WINDOW_WIDTH, WINDOW_HEIGHT);
+
+    ShadowConstants& shadows = frameConstants.shadows;
+    for (size_t i = 0; i < lightMatrices.size() && i < MAX_SHADOW_CASCADES; i++) {
+        shadows.lightSpaceMatrices[i] = lightMatrices[i];
+    }
+    for (size_t i = 0; i < shadowCascadeLevels.size() && i < MAX_SHADOW_CASCADES; i++) {
+        shadows.cascadePlaneDistances[i].x = shadowCascadeLevels[i];
+    }
+    shadows.cascadeCount = shadowCascadeLevels.size();
+    shadows.cascadeFarPlane = cascadeFarDepth;
+    frameConstants.upload();
+
+    // Depth clamp pancakes casters in front of a cascade onto it, so they're kept past its near plane
+    std::vector<ShadowVolume> cascadeVolumes;
+    for (const glm::mat4& lightMatrix : lightMatrices) {
+        cascadeVolumes.push_back(ShadowVolume::fromMatrix(lightMatrix, false));
+    }
 
     cascadeMapPipeline.use();
 
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_DEPTH_CLAMP);
-    glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
-        glViewport(0, 0, depthMapResolution, depthMapResolution);
-        glClear(GL_DEPTH_BUFFER_BIT);
+    // Only the layers being redrawn are cleared, the rest keep their depth from earlier frames
+    float farDepth = 1.0f;
+    for (size_t i = 0; i < lightMatrices.size(); i++) {
+        if (updateMask & (1u << i)) {
+            glClearTexSubImage(lightDepthMaps, 0, 0, 0, i, depthMapResolution, depthMapResolution, 1,
+                GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+        }
+    }
 
-        if (cullFront) glCullFace(GL_FRONT);
-        drawModels(objs, cascadeMapPipeline, SKIP_TEXTURES);
-        glCullFace(GL_BACK);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDisable(GL_DEPTH_CLAMP);
-    glDisable(GL_CULL_FACE);
+    shadowCullingStats = ShadowCullingStats();
+    if (updateMask != 0) {
+        GLState::get().enable(GL_CULL_FACE);
+        GLState::get().enable(GL_DEPTH_CLAMP);
+        GLState::get().bindFramebuffer(shadowMapFBO);
+            GLState::get().viewport(0, 0, depthMapResolution, depthMapResolution);
+
+            if (cullFront) GLState::get().cullFace(GL_FRONT);
+            shadowCullingStats = drawShadowCasters(objs, cascadeMapPipeline, cascadeVolumes, updateMask);
+            GLState::get().cullFace(GL_BACK);
+        GLState::get().bindFramebuffer(0);
+        GLState::get().disable(GL_DEPTH_CLAMP);
+        GLState::get().disable(GL_CULL_FACE);
+    }
 
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     // Final Render Pass
-    glActiveTexture(GL_TEXTURE7);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, lightDepthMaps);
+    GLState::get().bindTexture(7, GL_TEXTURE_2D_ARRAY, lightDepthMaps);
+    GLState::get().bindTexture(8, GL_TEXTURE_3D, voxelGridTexture);
 
-    renderPassPipeline.use();
+    prepareVariants(objs, renderPassPipeline, 0);
+    for (auto& [variantFeatures, variant] : renderPassPipeline.getVariants()) {
+        variant.use();
 
-    renderPassPipeline.setInt("cascadedMap", 7);
-    renderPassPipeline.setInt("cascadeCount", shadowCascadeLevels.size());
-    for (size_t i = 0; i < shadowCascadeLevels.size(); i++) {
-        renderPassPipeline.setFloat("cascadePlaneDistances[" + std::to_string(i) + "]", shadowCascadeLevels[i]);
-    }
-    renderPassPipeline.setFloat("far_plane", cameraFarPlane);
-    renderPassPipeline.setBool("showShadows", shouldShowShadowMap);
-
-    renderPassPipeline.setMat4("view", view);
-    renderPassPipeline.setMat4("projection", projection);
-    renderPassPipeline.setFloat("shininess", shininess);
-    renderPassPipeline.setVec3("viewPos", camera->Position);
-    renderPassPipeline.setBool("useAO", useAO);
-
-    renderPassPipeline.setFloat("dirLightMultiplier", dirLightMultiplier);
-    renderPassPipeline.setFloat("indirectLightMultiplier", indirectLightMultiplier);
-    renderPassPipeline.setFloat("specularAngleMultiplier", specularAngleMultiplier);
-
-    renderPassPipeline.setFloat("MAX_DIST", maxDistance);
-    renderPassPipeline.setInt("gridSize", gridSize);
-    renderPassPipeline.setFloat("voxelWorldSize", voxelWorldSize);
-    renderPassPipeline.setMat4("voxelProjection", finalVoxelProjection);
-    renderPassPipeline.setFloat("someLod", someLod);
-
-    renderPassPipeline.setVec3("dirLight.color", directionalLight.color);
-    renderPassPipeline.setVec3("dirLight.direction", directionalLight.direction);
-    for (unsigned int i = 0; i < pointLights.size(); i++) {
-        renderPassPipeline.setVec3("pointLights[" + std::to_string(i) + "].position", pointLights[i].position);
-        renderPassPipeline.setVec3("pointLights[" + std::to_string(i) + "].color", pointLights[i].color);
-    }
-    glActiveTexture(GL_TEXTURE8);
-    glBindTexture(GL_TEXTURE_3D, voxelGridTexture);
+        variant.setInt("cascadedMap", 7);
+        variant.setBool("showShadows", shouldShowShadowMap);
+
+        variant.setFloat("shininess", shininess);
+        variant.setBool("useAO", useAO);
+
+        variant.setFloat("dirLightMultiplier", dirLightMultiplier);
+        variant.setFloat("indirectLightMultiplier", indirectLightMultiplier);
+        variant.setFloat("specularAngleMultiplier", specularAngleMultiplier);
+
+        variant.setFloat("MAX_DIST", maxDistance);
+        variant.setInt("gridSize", gridSize);
+        variant.setFloat("voxelWorldSize", voxelWorldSize);
+        variant.setMat4("voxelProjection", finalVoxelProjection);
+        variant.setFloat("someLod", someLod);
+
+        variant.setVec3("dirLight.color", directionalLight.color);
+        variant.setVec3("dirLight.direction", directionalLight.direction);
+        for (unsigned int i = 0; i < pointLights.size(); i++) {
+            variant.setVec3(uniformArray("pointLights", i, "position"), pointLights[i].position);
+            variant.setVec3(uniformArray("pointLights", i, "color"), pointLights[i].color);
+        }
 
-    renderPassPipeline.setInt("voxelTexture", 8);
-    drawModels(objs, renderPassPipeline);
+        variant.setInt("voxelTexture", 8);
+    }
+    drawModels(objs, renderPassPipeline, 0);
+    depthReduction.reduceFramebuffer(0, WINDOW_WIDTH, WINDOW_HEIGHT, cameraNearPlane, cameraFarPlane);
 
     // Render Cubemap
     cubemap.draw(projection, view);
@@ -157,6 +190,16 @@ void VoxelEngine::handleImGui() {
         
         ImGui::Checkbox("Should show shadows", &shouldShowShadowMap);
         ImGui::Checkbox("Should cull front", &cullFront);
+        ImGui::Checkbox("Fit Cascades To Depth", &fitCascadesToDepth);
+        ImGui::SliderFloat("Log Split Weight", &cascadeSplitWeight, 0.0f, 1.0f);
+        ImGui::Text("Cascade Range: %.2f - %.2f", cascadeNearDepth, cascadeFarDepth);
+
+        const CascadeSchedulerStats& cascadeStats = cascadeScheduler.getStats();
+        ImGui::Checkbox("Cache Far Cascades", &cascadeScheduler.useCache);
+        ImGui::SliderInt("Far Cascade Interval", &cascadeScheduler.interval, 1, 16);
+        ImGui::Text("Cascades updated: %u (%u forced), reused %u", cascadeStats.updated, cascadeStats.forced, cascadeStats.reused);
+        ImGui::Text("Casters: %u of %u, layer draws: %u of %u", shadowCullingStats.casters - shadowCullingStats.culledCasters,
+            shadowCullingStats.casters, shadowCullingStats.layerDraws, shadowCullingStats.possibleLayerDraws);
     }
     directionalLight.direction = glm::normalize(directionalLight.direction);
 }
@@ -173,11 +216,11 @@ void VoxelEngine::createVoxelGrid(std::vector<Model> &objs) {
     glm::mat4 finalProjection = voxelProjection * glm::lookAt(glm::vec3(0, 0, maxCoord + 0.1f), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
     finalVoxelProjection = finalProjection;
 
-    glViewport(0, 0, gridSize, gridSize);
+    GLState::get().viewport(0, 0, gridSize, gridSize);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDisable(GL_CULL_FACE);
-        glDisable(GL_DEPTH_TEST);
-        glDisable(GL_BLEND);
+        GLState::get().disable(GL_CULL_FACE);
+        GLState::get().disable(GL_DEPTH_TEST);
+        GLState::get().disable(GL_BLEND);
 
         // Voxel Grid Color Data
         voxelGridPipeline.use();
@@ -187,13 +230,12 @@ void VoxelEngine::createVoxelGrid(std::vector<Model> &objs) {
         voxelGridPipeline.setVec3("dirLight.color", directionalLight.color);
         voxelGridPipeline.setVec3("dirLight.direction", directionalLight.direction);
         for (unsigned int i = 0; i < pointLights.size(); i++) {
-            voxelGridPipeline.setVec3("pointLights[" + std::to_string(i) + "].position", pointLights[i].position);
-            voxelGridPipeline.setVec3("pointLights[" + std::to_string(i) + "].color", pointLights[i].color);
+            voxelGridPipeline.setVec3(uniformArray("pointLights", i, "position"), pointLights[i].position);
+            voxelGridPipeline.setVec3(uniformArray("pointLights", i, "color"), pointLights[i].color);
         }
         voxelGridPipeline.setInt("gridSize", gridSize);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_3D, voxelGridTexture);
+        GLState::get().bindTexture(0, GL_TEXTURE_3D, voxelGridTexture);
         voxelGridPipeline.setInt("voxelTexture", 0);
         glBindImageTexture(0, voxelGridTexture, 0, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8);
 
@@ -201,83 +243,8 @@ void VoxelEngine::createVoxelGrid(std::vector<Model> &objs) {
         glGenerateTextureMipmap(voxelGridTexture);
         
         
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
+        GLState::get().enable(GL_DEPTH_TEST);
+        GLState::get().enable(GL_BLEND);
 
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    GLState::get().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
 }
-
-std::vector<glm::mat4> VoxelEngine::getLightSpaceMatrices() {
-    std::vector<glm::mat4> result;
-
-    for (int i = 0; i < shadowCascadeLevels.size() + 1; i++) {
-        if (i == 0)
-            result.push_back(getLightSpaceMatrix(cameraNearPlane, shadowCascadeLevels[i]));
-        else if (i < shadowCascadeLevels.size())
-            result.push_back(getLightSpaceMatrix(shadowCascadeLevels[i-1], shadowCascadeLevels[i]));
-        else
-            result.push_back(getLightSpaceMatrix(shadowCascadeLevels[i-1], cameraFarPlane));
-    }
-
-    return result;
-}
-
-glm::mat4 VoxelEngine::getLightSpaceMatrix(float nearPlane, float farPlane) {
-    const auto proj = glm::perspective(
-        glm::radians(camera->Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, nearPlane,
-        farPlane);
-    auto corners = getFrustumCornerWorldSpace(proj, camera->getViewMatrix());
-
-    glm::vec3 center(0, 0, 0);
-    for (const auto& v : corners) center += glm::vec3(v);
-    center /= corners.size();
-
-    const auto lightView = glm::lookAt(center + directionalLight.direction, center, glm::vec3(0.0f, 1.0f, 0.0f));
-
-    float minX = std::numeric_limits<float>::max();
-    float maxX = std::numeric_limits<float>::lowest();
-    float minY = std::numeric_limits<float>::max();
-    float maxY = std::numeric_limits<float>::lowest();
-    float minZ = std::numeric_limits<float>::max();
-    float maxZ = std::numeric_limits<float>::lowest();
-    for (const auto& v : corners)
-    {
-        const auto trf = lightView * v;
-        minX = std::min(minX, trf.x);
-        maxX = std::max(maxX, trf.x);
-        minY = std::min(minY, trf.y);
-        maxY = std::max(maxY, trf.y);
-        minZ = std::min(minZ, trf.z);
-        maxZ = std::max(maxZ, trf.z);
-    }
-
-    float zMult = 10.0f;
-    if (minZ < 0) minZ *= zMult;
-    else minZ /= zMult;
-
-    if (maxZ < 0) maxZ /= zMult;
-    else maxZ *= zMult;
-
-    const glm::mat4 lightProjection = glm::ortho(minX, maxX, minY, maxY, minZ, maxZ);
-    return lightProjection * lightView;
-}
-
-std::vector<glm::vec4> VoxelEngine::getFrustumCornerWorldSpace(const glm::mat4& proj, const glm::mat4& view) {
-    const auto inv = glm::inverse(proj * view);
-
-    std::vector<glm::vec4> frustumCorners;
-    for (unsigned int x = 0; x < 2; x++) {
-        for (unsigned int y = 0; y < 2; y++) {
-            for (unsigned int z = 0; z < 2; z++) {
-                const glm::vec4 pt = inv * glm::vec4(
-                    2.0f * x - 1.0f,
-                    2.0f * y - 1.0f,
-                    2.0f * z - 1.0f,
-                    1.0f);
-                frustumCorners.push_back(pt / pt.w);
-            }
-        }
-    }
-
-    return frustumCorners;
-}
\ No newline at end of file
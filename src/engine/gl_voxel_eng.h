@@ -1,6 +1,9 @@
 #pragma once
 
 #include "gl_base_engine.h"
+#include "utils/cascade_fitting.h"
+#include "utils/cascade_scheduler.h"
+#include "utils/gl_depth_reduction.h"
 
 struct SimpleDirLight {
     glm::vec3 direction;
@@ -34,12 +37,18 @@ class VoxelEngine : public GLEngine {
         float cameraNearPlane = 0.1f;
         float cameraFarPlane = 200.0f;
         int depthMapResolution = 2048;
-        unsigned int shadowMapFBO;
-        unsigned int lightDepthMaps;
-        unsigned int matricesUBO;
-        std::vector<float> shadowCascadeLevels = { cameraFarPlane / 50.0f, 
-            cameraFarPlane / 25.0f, cameraFarPlane / 10.0f, cameraFarPlane / 5.0f, cameraFarPlane / 2.0f };
+        FramebufferHandle shadowMapFBO;
+        TextureHandle lightDepthMaps;
+        // Split again every frame, the initial size sets the cascade count
+        std::vector<float> shadowCascadeLevels = { cameraFarPlane / 50.0f,
+            cameraFarPlane / 25.0f, cameraFarPlane / 10.0f, cameraFarPlane / 2.0f };
+        DepthReduction depthReduction;
+        bool fitCascadesToDepth = true;
+        float cascadeSplitWeight = 0.8f;
+        float cascadeNearDepth = 0.0f, cascadeFarDepth = 0.0f;
+        CascadeScheduler cascadeScheduler;
         Shader cascadeMapPipeline;
+        ShadowCullingStats shadowCullingStats;
 
         AllocatedBuffer quadBuffer;
         Shader quadPipeline;
@@ -51,9 +60,7 @@ class VoxelEngine : public GLEngine {
         std::vector<SimplePointLight> pointLights;
         SimpleDirLight directionalLight;
 
-        Shader voxelGridPipeline, renderPassPipeline;
+        Shader voxelGridPipeline;
+        ShaderVariants renderPassPipeline;
 
-        std::vector<glm::mat4> getLightSpaceMatrices();
-        glm::mat4 getLightSpaceMatrix(float nearPlane, float farPlane);
-        std::vector<glm::vec4> getFrustumCornerWorldSpace(const glm::mat4& proj, const glm::mat4& view);
 };
\ No newline at end of file
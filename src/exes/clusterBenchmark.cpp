@@ -0,0 +1,88 @@
+#include "utils/cluster_culling.h"
+#include "utils/thread_pool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Times ClusterCuller without a window or GL context. Lights are scattered through the
+// view frustum so the counts per cluster resemble the clustered demo's.
+#define BENCHMARK_ITERATIONS 5
+#define BENCHMARK_MAX_LIGHTS_PER_CLUSTER 200
+
+struct BenchmarkGrid {
+    unsigned int sizeX, sizeY, sizeZ;
+};
+
+static ClusterGrid createGrid(const BenchmarkGrid& size, unsigned int width, unsigned int height) {
+    ClusterGrid grid;
+    grid.sizeX = size.sizeX;
+    grid.sizeY = size.sizeY;
+    grid.sizeZ = size.sizeZ;
+    grid.zNear = 0.1f;
+    grid.zFar = 100.0f;
+
+    unsigned int tileSizeX = (width + size.sizeX - 1) / size.sizeX;
+    unsigned int tileSizeY = (height + size.sizeY - 1) / size.sizeY;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), width / (float) height, grid.zNear, grid.zFar);
+    grid.screenToView.inverseProj = glm::inverse(projection);
+    grid.screenToView.tileSizes = glm::uvec4(size.sizeX, size.sizeY, size.sizeZ, tileSizeX);
+    grid.screenToView.screenDimensions = glm::uvec2(width, height);
+    grid.screenToView.tileScreenSizes = glm::uvec2(tileSizeX, tileSizeY);
+    return grid;
+}
+
+static std::vector<ClusteredLight> createLights(unsigned int count, std::mt19937& mt) {
+    std::uniform_real_distribution<float> xyDist(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> depthDist(1.0f, 100.0f);
+    std::uniform_real_distribution<float> rangeDist(1.0f, 5.0f);
+
+    std::vector<ClusteredLight> lights(count);
+    for (ClusteredLight& light : lights) {
+        float depth = depthDist(mt);
+        light.position = glm::vec4(xyDist(mt) * depth * 0.7f, xyDist(mt) * depth * 0.4f, -depth, 1.0f);
+        light.color = glm::vec4(1.0f);
+        light.enabled = 1;
+        light.intensity = 1.0f;
+        light.range = rangeDist(mt);
+    }
+    return lights;
+}
+
+int main() {
+    const unsigned int lightCounts[] = { 64, 256, 1024, 4096, 16384, 65536 };
+    const BenchmarkGrid grids[] = { { 16, 9, 24 }, { 32, 18, 24 }, { 32, 18, 48 } };
+
+    std::mt19937 mt(1234);
+    ClusterCuller culler;
+    glm::mat4 view = glm::mat4(1.0f);
+
+    printf("%u worker threads, %d iterations per row\n\n", ThreadPool::get().getNumThreads(), BENCHMARK_ITERATIONS);
+    printf("%10s %14s %10s %12s %12s %10s %10s\n", "lights", "grid", "clusters", "build (ms)", "assign (ms)", "indices", "overflow");
+
+    for (const BenchmarkGrid& size : grids) {
+        ClusterGrid grid = createGrid(size, 1920, 1080);
+        for (unsigned int lightCount : lightCounts) {
+            std::vector<ClusteredLight> lights = createLights(lightCount, mt);
+
+            float buildTime = 0.0f, assignTime = 0.0f;
+            for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+                culler.buildClusters(grid);
+                culler.assignLights(lights.data(), lights.size(), view, BENCHMARK_MAX_LIGHTS_PER_CLUSTER);
+                buildTime += culler.getStats().buildMilliseconds;
+                assignTime += culler.getStats().assignMilliseconds;
+            }
+
+            char gridName[32];
+            snprintf(gridName, sizeof(gridName), "%ux%ux%u", size.sizeX, size.sizeY, size.sizeZ);
+            const ClusterCullingStats& stats = culler.getStats();
+            printf("%10u %14s %10u %12.3f %12.3f %10u %10u\n", lightCount, gridName, grid.getNumClusters(),
+                buildTime / BENCHMARK_ITERATIONS, assignTime / BENCHMARK_ITERATIONS, stats.indices, stats.overflowedClusters);
+            fflush(stdout);
+        }
+    }
+
+    return 0;
+}
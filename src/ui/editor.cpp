@@ -37,8 +37,13 @@ void SceneEditor::render(Camera& camera)
 		ImGui::BeginChild("entities");
 
 		if (objs != nullptr) {
-			for (Model& model : *objs) {
-				renderAsList(model);
+			for (size_t i = 0; i < objs->size();) {
+				ImGui::PushID((int) i);
+				bool remove = renderAsList((*objs)[i]);
+				ImGui::PopID();
+
+				if (remove) removeModel(i);
+				else i++;
 			}
 		}
 
@@ -61,6 +66,88 @@ void SceneEditor::render(Camera& camera)
 	}
 
 	if (ImGui::BeginTabItem("Stats")) {
+		const RenderQueueStats& stats = renderer->getQueueStats();
+		if (ImGui::CollapsingHeader("Render Queue")) {
+			ImGui::Text("Draw Calls: %u", stats.drawCalls);
+			ImGui::Text("Program Binds: %u (saved %u)", stats.programBinds, stats.programBindsSaved);
+			ImGui::Text("VAO Binds: %u (saved %u)", stats.vaoBinds, stats.vaoBindsSaved);
+			ImGui::Text("Texture Binds: %u (saved %u)", stats.textureBinds, stats.textureBindsSaved);
+			ImGui::Text("Material Changes: %u (saved %u)", stats.materialChanges, stats.materialChangesSaved);
+			ImGui::Text("Instanced Batches: %u (merged %u)", stats.instancedBatches, stats.instancesMerged);
+		}
+		if (ImGui::CollapsingHeader("GL State")) {
+			const GLStateStats& state = GLState::get().getLastFrameStats();
+			unsigned int issued = 0, skipped = 0;
+			for (int i = 0; i < STATE_CALL_COUNT; i++) {
+				const StateCallStats& calls = state.calls[i];
+				ImGui::Text("%s: %u (skipped %u)", getStateCallName((StateCallType)i), calls.issued, calls.skipped);
+				issued += calls.issued;
+				skipped += calls.skipped;
+			}
+			ImGui::Text("Total State Calls: %u (skipped %u)", issued, skipped);
+			ImGui::Text("Draw Calls: %u", state.drawCalls);
+			ImGui::Text("Uploaded: %.1f KB", state.bytesUploaded / 1024.0f);
+		}
+		if (ImGui::CollapsingHeader("Programs")) {
+			const ProgramCacheStats& programs = ProgramCache::get().getStats();
+			ImGui::Text("Compiled: %u", programs.compiled);
+			ImGui::Text("Loaded From Disk: %u (rejected %u)", programs.loadedFromDisk, programs.rejected);
+			ImGui::Text("Shared: %u", programs.shared);
+
+			ShaderManager& shaders = ShaderManager::get();
+			const ShaderManagerStats& manager = shaders.getStats();
+			ImGui::Text("Parallel Compile: %s", ProgramCache::get().supportsParallelCompile() ? "yes" : "no");
+			ImGui::Text("Last Batch: %u programs in %.1f ms", manager.lastBatchSize, manager.lastBatchMilliseconds);
+			ImGui::Text("Building: %u of %u", manager.pending, manager.programs);
+			ImGui::Text("Reloads: %u (failed %u)", manager.reloads, manager.failedReloads);
+			ImGui::Checkbox("Hot Reload", &shaders.hotReload);
+		}
+		if (ImGui::CollapsingHeader("Geometry Arena")) {
+			GeometryArenaStats geometry = renderer->getGeometryStats();
+			ImGui::Text("Vertices: %zu / %zu", geometry.verticesUsed, geometry.vertexCapacity);
+			ImGui::Text("Indices: %zu / %zu", geometry.indicesUsed, geometry.indexCapacity);
+			ImGui::Text("Free Ranges: %zu", geometry.freeRanges);
+		}
+		if (ImGui::CollapsingHeader("GPU Resources")) {
+			ResourceRegistry& registry = ResourceRegistry::get();
+			ResourceStats resources = registry.getStats();
+			for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+				const ResourceCategoryStats& category = resources.categories[i];
+				ImGui::Text("%s: %u (%.1f MB)", getResourceCategoryName((ResourceCategory)i),
+					category.count, category.bytes / (1024.0f * 1024.0f));
+			}
+			ImGui::Text("Pending Deletes: %u (%.1f MB)", resources.pendingDeletes, resources.pendingBytes / (1024.0f * 1024.0f));
+
+			bool overBudget = resources.totalBytes > resources.budget;
+			ImGui::TextColored(overBudget ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImVec4(1.0f, 1.0f, 1.0f, 1.0f),
+				"Total: %.1f MB", resources.totalBytes / (1024.0f * 1024.0f));
+
+			int budgetMB = (int) (resources.budget / (1024 * 1024));
+			if (ImGui::InputInt("Budget (MB)", &budgetMB, 64, 256) && budgetMB > 0) {
+				registry.setBudget((size_t) budgetMB * 1024 * 1024);
+			}
+		}
+		if (ImGui::CollapsingHeader("Resolution")) {
+			RenderResolution& resolution = renderer->getResolution();
+			ImGui::Text("GPU Frame: %.2f ms (smoothed %.2f ms)", renderer->getGPUFrameTime(), resolution.getSmoothedFrameTime());
+			ImGui::Text("Window: %d x %d", resolution.getWindowWidth(), resolution.getWindowHeight());
+			ImGui::Text("Render: %d x %d (%.0f%%)", resolution.getRenderWidth(), resolution.getRenderHeight(),
+				resolution.getScale() * 100.0f);
+
+			if (resolution.getScalingSupported()) {
+				bool isDynamic = resolution.getDynamic();
+				if (ImGui::Checkbox("Dynamic Resolution", &isDynamic)) resolution.setDynamic(isDynamic);
+				ImGui::SliderFloat("Frame Budget (ms)", &resolution.frameBudget, 4.0f, 33.3f);
+
+				float scale = resolution.getScale();
+				if (!isDynamic && ImGui::SliderFloat("Scale", &scale, resolution.minScale, resolution.maxScale)) {
+					resolution.setScale(scale);
+				}
+			} else {
+				ImGui::Text("This engine renders at window size");
+			}
+		}
+		renderer->handleStatsImGui();
 		ImGui::EndTabItem();
 	}
 	ImGui::EndTabBar();
@@ -79,20 +166,20 @@ void SceneEditor::render(Camera& camera)
 					}
 				}
 			}
-			if (ImGui::CollapsingHeader("Ints")) {
-				for (auto& pair : chosenMaterial->uniformInts) {
-					ImGui::SliderInt(pair.first.c_str(), &pair.second, 0.0f, 1.0f);
-				}
-			}
-			if (ImGui::CollapsingHeader("Floats")) {
-				for (auto& pair : chosenMaterial->uniformFloats) {
-					ImGui::SliderFloat(pair.first.c_str(), &pair.second, 0.0f, 1.0f);
-				}
-			}
-			if (ImGui::CollapsingHeader("Vec3s")) {
-				for (auto& pair : chosenMaterial->uniformVec3s) {
-					ImGui::SliderFloat3(pair.first.c_str(), glm::value_ptr(pair.second), 0.0f, 1.0f);
+			if (ImGui::CollapsingHeader("Parameters")) {
+				ImGui::Text("Material ID: %u", chosenMaterial->materialID);
+
+				bool changed = false;
+				unsigned char* params = (unsigned char*)&chosenMaterial->params;
+				for (int i = 0; i < numMaterialParameters; i++) {
+					const MaterialParameterInfo& info = materialParameterInfos[i];
+					float* value = (float*)(params + info.offset);
+					if (info.type == MATERIAL_PARAM_VEC3)
+						changed |= ImGui::SliderFloat3(info.name, value, info.min, info.max);
+					else
+						changed |= ImGui::SliderFloat(info.name, value, info.min, info.max);
 				}
+				if (changed && renderer != nullptr) renderer->updateMaterial(*chosenMaterial);
 			}
 		}
 	}
@@ -112,7 +199,17 @@ void SceneEditor::renderDebug(Camera& camera)
 {
 }
 
-void SceneEditor::renderAsList(Model& model) {
+// Frees the model's geometry, textures and material slots before it leaves the scene
+void SceneEditor::removeModel(size_t index) {
+	if (renderer != nullptr) renderer->unloadModelData((*objs)[index]);
+	objs->erase(objs->begin() + index);
+
+	// Selections point into the models, which just moved
+	chosenObj = nullptr;
+	chosenMaterial = nullptr;
+}
+
+bool SceneEditor::renderAsList(Model& model) {
 	ImVec4 color(0.8f, 0.8f, 0.8f, 1.0f);
 
 	bool open = ImGui::TreeNodeEx("##Model", ImGuiTreeNodeFlags_OpenOnArrow);
@@ -120,6 +217,8 @@ void SceneEditor::renderAsList(Model& model) {
 	UI::drawIcon(1, 5, 0, 1.0f);
 	ImGui::SameLine();
 	ImGui::Text("Model");
+	ImGui::SameLine();
+	bool remove = ImGui::SmallButton("Remove");
 	ImGui::PushStyleColor(ImGuiCol_Text, color);
 
 	if (open) {
@@ -145,5 +244,5 @@ void SceneEditor::renderAsList(Model& model) {
 	}
 
 	ImGui::PopStyleColor();
-	
+	return remove;
 }
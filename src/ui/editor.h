@@ -15,7 +15,8 @@ public:
 	SceneEditor() = default;
 
 	void render(Camera& camera);
-	void renderAsList(Model& model);
+	// True when the model's remove button was pressed
+	bool renderAsList(Model& model);
 	void renderDebug(Camera& camera);
 
 	GLEngine* renderer = nullptr;
@@ -24,4 +25,5 @@ public:
 	Material* chosenMaterial = nullptr;
 
 private:
+	void removeModel(size_t index);
 };
\ No newline at end of file
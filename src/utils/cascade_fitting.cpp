@@ -0,0 +1,90 @@
+#include "cascade_fitting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+
+std::vector<float> computeCascadeSplits(float nearDepth, float farDepth, int count, float logWeight) {
+    std::vector<float> splits;
+    nearDepth = std::max(nearDepth, 1e-3f);
+    farDepth = std::max(farDepth, nearDepth * 1.001f);
+
+    for (int i = 1; i < count; i++) {
+        float fraction = (float) i / count;
+        float logSplit = nearDepth * std::pow(farDepth / nearDepth, fraction);
+        float uniformSplit = nearDepth + (farDepth - nearDepth) * fraction;
+        splits.push_back(logWeight * logSplit + (1.0f - logWeight) * uniformSplit);
+    }
+    return splits;
+}
+
+glm::mat4 getLightView(const glm::vec3& lightDirection) {
+    glm::vec3 forward = -glm::normalize(lightDirection);
+    glm::vec3 up = std::abs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), forward, up);
+}
+
+CascadeFit fitCascade(const glm::mat4& view, float fovY, float aspect, float sliceNear, float sliceFar,
+    const glm::vec3& lightDirection, const glm::vec3& casterMin, const glm::vec3& casterMax, int resolution) {
+    glm::mat4 inverseView = glm::inverse(view);
+    float tanHalfY = std::tan(fovY * 0.5f);
+    float tanHalfX = tanHalfY * aspect;
+
+    CascadeFit fit;
+    glm::vec3* corners = fit.corners;
+    glm::vec3 center(0.0f);
+    for (int i = 0; i < 8; i++) {
+        float depth = (i & 4) ? sliceFar : sliceNear;
+        float x = (i & 1) ? tanHalfX : -tanHalfX;
+        float y = (i & 2) ? tanHalfY : -tanHalfY;
+        corners[i] = glm::vec3(inverseView * glm::vec4(x * depth, y * depth, -depth, 1.0f));
+        center += corners[i];
+    }
+    center /= 8.0f;
+
+    float radius = 0.0f;
+    for (int i = 0; i < 8; i++) radius = std::max(radius, glm::length(corners[i] - center));
+    radius = std::pow(CASCADE_RADIUS_STEP, std::ceil(std::log(std::max(radius, 1e-3f)) / std::log(CASCADE_RADIUS_STEP)));
+
+    // Without a translation in the light view, snapping in light space is snapping to the map's texel grid
+    glm::mat4 lightView = getLightView(lightDirection);
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    float texelSize = 2.0f * radius / resolution;
+    lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+    lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+    // Light space z grows towards the light
+    float sliceMinZ = std::numeric_limits<float>::max();
+    float sliceMaxZ = std::numeric_limits<float>::lowest();
+    for (int i = 0; i < 8; i++) {
+        float z = (lightView * glm::vec4(corners[i], 1.0f)).z;
+        sliceMinZ = std::min(sliceMinZ, z);
+        sliceMaxZ = std::max(sliceMaxZ, z);
+    }
+
+    float casterMinZ = std::numeric_limits<float>::max();
+    float casterMaxZ = std::numeric_limits<float>::lowest();
+    bool hasCasters = glm::all(glm::lessThanEqual(casterMin, casterMax));
+    for (int i = 0; hasCasters && i < 8; i++) {
+        glm::vec3 corner((i & 1) ? casterMax.x : casterMin.x, (i & 2) ? casterMax.y : casterMin.y, (i & 4) ? casterMax.z : casterMin.z);
+        float z = (lightView * glm::vec4(corner, 1.0f)).z;
+        casterMinZ = std::min(casterMinZ, z);
+        casterMaxZ = std::max(casterMaxZ, z);
+    }
+
+    // Anything closer to the light than the slice can still shadow it, but nothing past the last
+    // caster receives a shadow. With no casters the slice alone decides.
+    float nearZ = sliceMaxZ;
+    float farZ = sliceMinZ;
+    if (hasCasters) {
+        nearZ = casterMaxZ;
+        farZ = std::max(sliceMinZ, casterMinZ);
+    }
+    farZ = std::min(farZ, nearZ - 1e-3f);
+
+    glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+        lightCenter.y - radius, lightCenter.y + radius, -nearZ, -farZ);
+    fit.viewProjection = lightProjection * lightView;
+    return fit;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Fraction of the reduced depth range added on both ends, the range is a frame or two old by the
+// time cascades are fitted to it and geometry coming into view shouldn't land outside every cascade
+#define CASCADE_RANGE_PADDING 0.05f
+// Cascade radii are rounded up to steps of this ratio, so a slice that changes length from frame to
+// frame keeps its texel size and only shimmers when it crosses a step
+#define CASCADE_RADIUS_STEP 1.0905f
+
+// View depths between count cascades over [nearDepth, farDepth], count - 1 of them. logWeight blends
+// logarithmic splits, which keep texels per pixel even across the range, with uniform ones.
+std::vector<float> computeCascadeSplits(float nearDepth, float farDepth, int count, float logWeight);
+
+struct CascadeFit {
+    glm::mat4 viewProjection;
+    // World space corners of the camera slice it was fitted to
+    glm::vec3 corners[8];
+};
+
+// Orthographic light matrix for the part of the camera frustum between sliceNear and sliceFar.
+// X and Y cover a sphere around the slice, so the size doesn't change as the camera turns, with the
+// center snapped to whole texels of a resolution sized map so edges don't crawl as it moves.
+// Z runs from the caster closest to the light to the far end of the slice, clipped to the caster bounds.
+CascadeFit fitCascade(const glm::mat4& view, float fovY, float aspect, float sliceNear, float sliceFar,
+    const glm::vec3& lightDirection, const glm::vec3& casterMin, const glm::vec3& casterMax, int resolution);
+
+// Rotation only view looking along -lightDirection, lightDirection points towards the light
+glm::mat4 getLightView(const glm::vec3& lightDirection);
@@ -0,0 +1,99 @@
+#include "cascade_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+void CascadeScheduler::invalidate() {
+    for (CascadeState& cascade : cascades) cascade.isValid = false;
+}
+
+void CascadeScheduler::update(const std::vector<CascadeFit>& fits, const glm::vec3& lightDirection,
+    std::vector<Model>& models, int resolution) {
+    stats = CascadeSchedulerStats();
+    updateMask = 0;
+    forcedMask = 0;
+    frame++;
+
+    if (cascades.size() != fits.size()) {
+        cascades.assign(fits.size(), CascadeState());
+        matrices.assign(fits.size(), glm::mat4(1.0f));
+    }
+    // Every cached layer was drawn along the old direction
+    if (lightDirection != lastDirection) {
+        lastDirection = lightDirection;
+        invalidate();
+    }
+    updateCasters(models);
+
+    for (size_t i = 0; i < fits.size() && i < MAX_SHADOW_LAYERS; i++) {
+        CascadeState& cascade = cascades[i];
+        uint32_t bit = 1u << i;
+
+        bool due = !useCache || (int) i < firstCachedCascade || (frame + i) % std::max(interval, 1) == 0;
+        bool forced = !cascade.isValid || (forcedMask & bit) != 0 || !covers(i, fits[i]);
+        if (!due && !forced) {
+            stats.reused++;
+            continue;
+        }
+
+        if (!due) stats.forced++;
+        stats.updated++;
+        updateMask |= bit;
+
+        // Rows of an orthographic light matrix are 2 / extent long
+        const glm::mat4& matrix = fits[i].viewProjection;
+        float rowLength = glm::length(glm::vec3(matrix[0][0], matrix[1][0], matrix[2][0]));
+
+        matrices[i] = matrix;
+        cascade.volume = ShadowVolume::fromMatrix(matrix);
+        cascade.texelSize = 2.0f / (rowLength * resolution);
+        cascade.isValid = true;
+    }
+}
+
+void CascadeScheduler::updateCasters(std::vector<Model>& models) {
+    if (casters.size() != models.size()) {
+        casters.assign(models.size(), CasterState());
+        for (size_t i = 0; i < models.size(); i++) {
+            Model& model = models[i];
+            casters[i].lastMatrix = model.model_matrix;
+            transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, casters[i].boundsMin, casters[i].boundsMax);
+        }
+        invalidate();
+        return;
+    }
+
+    for (size_t i = 0; i < models.size(); i++) {
+        Model& model = models[i];
+        CasterState& caster = casters[i];
+
+        bool isAnimated = model.scene != nullptr && model.scene->mNumAnimations > 0;
+        if (!isAnimated && model.model_matrix == caster.lastMatrix) continue;
+
+        // Both where it left and where it went are stale
+        markCascades(caster.boundsMin, caster.boundsMax);
+        caster.lastMatrix = model.model_matrix;
+        transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, caster.boundsMin, caster.boundsMax);
+        markCascades(caster.boundsMin, caster.boundsMax);
+    }
+}
+
+void CascadeScheduler::markCascades(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    float extent = glm::length(boundsMax - boundsMin);
+    for (size_t i = 0; i < cascades.size() && i < MAX_SHADOW_LAYERS; i++) {
+        const CascadeState& cascade = cascades[i];
+        if (!cascade.isValid || extent < minCasterTexels * cascade.texelSize) continue;
+        if (cascade.volume.intersects(boundsMin, boundsMax)) forcedMask |= 1u << i;
+    }
+}
+
+bool CascadeScheduler::covers(int cascade, const CascadeFit& fit) const {
+    const glm::mat4& matrix = matrices[cascade];
+    for (const glm::vec3& corner : fit.corners) {
+        glm::vec4 clip = matrix * glm::vec4(corner, 1.0f);
+        if (std::abs(clip.x) > 1.0f || std::abs(clip.y) > 1.0f) return false;
+        // The far plane was fitted to the old slice, receivers past it would read as unshadowed
+        if (std::abs(clip.z) > 1.0f) return false;
+    }
+    return true;
+}
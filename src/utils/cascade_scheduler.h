@@ -0,0 +1,70 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "utils/cascade_fitting.h"
+#include "utils/gl_model.h"
+#include "utils/shadow_culling.h"
+
+struct CascadeSchedulerStats {
+    unsigned int updated = 0;
+    // Redrawn before their turn, because the light turned, a caster moved or the camera left their map
+    unsigned int forced = 0;
+    unsigned int reused = 0;
+};
+
+// Decides which cascade layers get redrawn each frame. Cascades before firstCachedCascade are
+// redrawn every frame, the ones after every interval frames, staggered so they take turns. A
+// cascade left alone keeps its depth layer and the matrix it was drawn with, which still projects
+// the scene into it correctly since the light didn't move, as long as the camera's slice stays
+// inside it. It is redrawn early when the slice leaves it, the light direction changes, or a
+// caster moves in it that spans at least minCasterTexels of its texels.
+class CascadeScheduler {
+    public:
+        // fits are this frame's fitted cascades, nearest first
+        void update(const std::vector<CascadeFit>& fits, const glm::vec3& lightDirection,
+            std::vector<Model>& models, int resolution);
+        // Every cascade is redrawn next update
+        void invalidate();
+
+        // What each layer holds once this frame's updates are drawn, for the shaders and the casters
+        const std::vector<glm::mat4>& getMatrices() const { return matrices; }
+        // Bit i set when layer i is redrawn this frame
+        uint32_t getUpdateMask() const { return updateMask; }
+        const CascadeSchedulerStats& getStats() const { return stats; }
+
+        bool useCache = true;
+        int firstCachedCascade = 2;
+        int interval = 4;
+        float minCasterTexels = 4.0f;
+
+    private:
+        struct CascadeState {
+            ShadowVolume volume;
+            float texelSize = 0.0f;
+            bool isValid = false;
+        };
+        struct CasterState {
+            glm::mat4 lastMatrix;
+            glm::vec3 boundsMin, boundsMax;
+        };
+
+        std::vector<CascadeState> cascades;
+        std::vector<glm::mat4> matrices;
+        std::vector<CasterState> casters;
+        glm::vec3 lastDirection = glm::vec3(0.0f);
+        unsigned int frame = 0;
+
+        uint32_t updateMask = 0;
+        uint32_t forcedMask = 0;
+        CascadeSchedulerStats stats;
+
+        void updateCasters(std::vector<Model>& models);
+        // Flags the cascades the box touches and is big enough to show up in
+        void markCascades(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+        // The slice projects inside the layer's map and between its near and far planes
+        bool covers(int cascade, const CascadeFit& fit) const;
+};
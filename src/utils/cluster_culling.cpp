@@ -0,0 +1,226 @@
+#include "cluster_culling.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define CLUSTER_CULLING_SSE
+#include <emmintrin.h>
+#endif
+
+typedef std::chrono::duration<float, std::milli> Milliseconds;
+
+static glm::vec4 screenToViewSpace(const ScreenToView& screenToView, glm::vec4 coords) {
+    glm::vec2 texCoord = glm::vec2(coords) / glm::vec2(screenToView.screenDimensions);
+    glm::vec4 clip = glm::vec4(texCoord * 2.0f - 1.0f, coords.z, coords.w);
+
+    glm::vec4 view = screenToView.inverseProj * clip;
+    return view / view.w;
+}
+
+static void forEachChunk(size_t count, const std::function<void(size_t, size_t)>& job) {
+    size_t numChunks = (count + CLUSTER_CULLING_CHUNK - 1) / CLUSTER_CULLING_CHUNK;
+    ThreadPool::get().parallelFor(numChunks, [&](size_t chunk) {
+        size_t first = chunk * CLUSTER_CULLING_CHUNK;
+        job(first, std::min(first + CLUSTER_CULLING_CHUNK, count));
+    });
+}
+
+// Same math as tileCreate.comp, including using the tile width for both axes
+void ClusterCuller::buildClusters(const ClusterGrid& grid) {
+    auto start = std::chrono::steady_clock::now();
+
+    const unsigned int numClusters = grid.getNumClusters();
+    clusters.resize(numClusters);
+
+    const float tileSizePx = (float) grid.screenToView.tileSizes.w;
+    forEachChunk(numClusters, [&](size_t first, size_t last) {
+        for (size_t cluster = first; cluster < last; cluster++) {
+            unsigned int x = cluster % grid.sizeX;
+            unsigned int y = (cluster / grid.sizeX) % grid.sizeY;
+            unsigned int z = cluster / (grid.sizeX * grid.sizeY);
+
+            glm::vec4 maxPointSS = glm::vec4(glm::vec2(x + 1, y + 1) * tileSizePx, -1.0f, 1.0f);
+            glm::vec4 minPointSS = glm::vec4(glm::vec2(x, y) * tileSizePx, -1.0f, 1.0f);
+
+            glm::vec3 maxPointVS = glm::vec3(screenToViewSpace(grid.screenToView, maxPointSS));
+            glm::vec3 minPointVS = glm::vec3(screenToViewSpace(grid.screenToView, minPointSS));
+
+            float tileNear = -grid.zNear * std::pow(grid.zFar / grid.zNear, z / float(grid.sizeZ));
+            float tileFar = -grid.zNear * std::pow(grid.zFar / grid.zNear, (z + 1) / float(grid.sizeZ));
+
+            glm::vec3 minPointNear = minPointVS * tileNear / minPointVS.z;
+            glm::vec3 maxPointNear = maxPointVS * tileNear / maxPointVS.z;
+            glm::vec3 minPointFar = minPointVS * tileFar / minPointVS.z;
+            glm::vec3 maxPointFar = maxPointVS * tileFar / maxPointVS.z;
+
+            glm::vec3 finalMin = glm::min(glm::min(minPointNear, minPointFar), glm::min(maxPointFar, maxPointNear));
+            glm::vec3 finalMax = glm::max(glm::max(minPointNear, minPointFar), glm::max(maxPointFar, maxPointNear));
+
+            clusters[cluster].minPoint = glm::vec4(finalMin, 1.0f);
+            clusters[cluster].maxPoint = glm::vec4(finalMax, 1.0f);
+        }
+    });
+
+    stats.buildMilliseconds = Milliseconds(std::chrono::steady_clock::now() - start).count();
+}
+
+void ClusterCuller::assignLights(const ClusteredLight* lights, size_t count, const glm::mat4& view,
+    unsigned int maxLightsPerCluster) {
+    auto start = std::chrono::steady_clock::now();
+
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    radiusSquared.clear();
+    lightIDs.clear();
+
+    // Light order is kept so every cluster lists its lights in the order the GPU finds them
+    for (size_t i = 0; i < count; i++) {
+        if (lights[i].enabled != 1) continue;
+
+        glm::vec3 center = glm::vec3(view * lights[i].position);
+        centerX.push_back(center.x);
+        centerY.push_back(center.y);
+        centerZ.push_back(center.z);
+        radiusSquared.push_back(lights[i].range * lights[i].range);
+        lightIDs.push_back(i);
+    }
+    stats.enabledLights = lightIDs.size();
+
+    // A negative squared radius fails against any distance
+    while (centerX.size() % 4 != 0) {
+        centerX.push_back(0.0f);
+        centerY.push_back(0.0f);
+        centerZ.push_back(0.0f);
+        radiusSquared.push_back(-1.0f);
+    }
+
+    const size_t numClusters = clusters.size();
+    lightGrid.resize(numClusters);
+    clusterSlots.resize(numClusters * maxLightsPerCluster);
+
+    forEachChunk(numClusters, [&](size_t first, size_t last) {
+        for (size_t cluster = first; cluster < last; cluster++) assignCluster(cluster, maxLightsPerCluster);
+    });
+
+    stats.indices = 0;
+    stats.maxClusterLights = 0;
+    stats.overflowedClusters = 0;
+    for (LightGridEntry& entry : lightGrid) {
+        entry.offset = stats.indices;
+        stats.indices += std::min(entry.count, maxLightsPerCluster);
+        stats.maxClusterLights = std::max(stats.maxClusterLights, entry.count);
+        if (entry.count > maxLightsPerCluster) {
+            entry.count = maxLightsPerCluster;
+            stats.overflowedClusters++;
+        }
+    }
+
+    lightIndices.resize(stats.indices);
+    forEachChunk(numClusters, [&](size_t first, size_t last) {
+        for (size_t cluster = first; cluster < last; cluster++) {
+            const unsigned int* slots = &clusterSlots[cluster * maxLightsPerCluster];
+            std::copy(slots, slots + lightGrid[cluster].count, lightIndices.begin() + lightGrid[cluster].offset);
+        }
+    });
+
+    stats.assignMilliseconds = Milliseconds(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sphere against AABB as squareDistancePointAABB does it, the count keeps going past the limit
+// so overflow can be reported
+void ClusterCuller::assignCluster(size_t cluster, unsigned int maxLightsPerCluster) {
+    const ClusterAABB& bounds = clusters[cluster];
+    unsigned int* slots = &clusterSlots[cluster * maxLightsPerCluster];
+    unsigned int visible = 0;
+
+    auto addLight = [&](size_t light) {
+        if (visible < maxLightsPerCluster) slots[visible] = lightIDs[light];
+        visible++;
+    };
+
+    size_t numLanes = centerX.size();
+#ifdef CLUSTER_CULLING_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 minX = _mm_set1_ps(bounds.minPoint.x), maxX = _mm_set1_ps(bounds.maxPoint.x);
+    const __m128 minY = _mm_set1_ps(bounds.minPoint.y), maxY = _mm_set1_ps(bounds.maxPoint.y);
+    const __m128 minZ = _mm_set1_ps(bounds.minPoint.z), maxZ = _mm_set1_ps(bounds.maxPoint.z);
+
+    for (size_t i = 0; i < numLanes; i += 4) {
+        __m128 x = _mm_loadu_ps(&centerX[i]);
+        __m128 y = _mm_loadu_ps(&centerY[i]);
+        __m128 z = _mm_loadu_ps(&centerZ[i]);
+
+        // At most one side is positive, so this is the distance to the box along each axis
+        __m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minX, x), zero), _mm_max_ps(_mm_sub_ps(x, maxX), zero));
+        __m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minY, y), zero), _mm_max_ps(_mm_sub_ps(y, maxY), zero));
+        __m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(minZ, z), zero), _mm_max_ps(_mm_sub_ps(z, maxZ), zero));
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(&radiusSquared[i])));
+        for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+            if (mask & 1) addLight(i + lane);
+        }
+    }
+#else
+    for (size_t i = 0; i < numLanes; i++) {
+        float point[3] = { centerX[i], centerY[i], centerZ[i] };
+        float distance = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            float v = point[axis];
+            if (v < bounds.minPoint[axis]) distance += (bounds.minPoint[axis] - v) * (bounds.minPoint[axis] - v);
+            if (v > bounds.maxPoint[axis]) distance += (v - bounds.maxPoint[axis]) * (v - bounds.maxPoint[axis]);
+        }
+        if (distance <= radiusSquared[i]) addLight(i);
+    }
+#endif
+
+    lightGrid[cluster].count = visible;
+}
+
+ClusterComparison ClusterCuller::compare(const ClusterAABB* gpuClusters, const LightGridEntry* gpuGrid,
+    const unsigned int* gpuIndices, size_t gpuIndexCount, const unsigned char* activeClusters) const {
+    ClusterComparison result;
+    result.clusters = clusters.size();
+
+    auto close = [](float a, float b) {
+        return std::abs(a - b) <= 1e-3f * std::max(1.0f, std::abs(a));
+    };
+
+    std::vector<unsigned int> cpuLights, gpuLights;
+    for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+        const ClusterAABB& cpu = clusters[cluster];
+        const ClusterAABB& gpu = gpuClusters[cluster];
+        bool boundsMatch = true;
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMatch &= close(cpu.minPoint[axis], gpu.minPoint[axis]) && close(cpu.maxPoint[axis], gpu.maxPoint[axis]);
+        }
+
+        if (activeClusters != nullptr && activeClusters[cluster] == 0) {
+            if (!boundsMatch) result.mismatchedBounds++;
+            if (!boundsMatch && result.firstMismatch < 0) result.firstMismatch = cluster;
+            continue;
+        }
+
+        const LightGridEntry& entry = lightGrid[cluster];
+        cpuLights.assign(lightIndices.begin() + entry.offset, lightIndices.begin() + entry.offset + entry.count);
+
+        const LightGridEntry& gpuEntry = gpuGrid[cluster];
+        size_t gpuEnd = std::min<size_t>((size_t) gpuEntry.offset + gpuEntry.count, gpuIndexCount);
+        gpuLights.assign(gpuIndices + std::min<size_t>(gpuEntry.offset, gpuEnd), gpuIndices + gpuEnd);
+
+        std::sort(cpuLights.begin(), cpuLights.end());
+        std::sort(gpuLights.begin(), gpuLights.end());
+        bool lightsMatch = cpuLights == gpuLights;
+
+        if (!boundsMatch) result.mismatchedBounds++;
+        if (!lightsMatch) result.mismatchedLights++;
+        if ((!boundsMatch || !lightsMatch) && result.firstMismatch < 0) result.firstMismatch = cluster;
+    }
+
+    return result;
+}
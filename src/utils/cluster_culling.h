@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Clusters handed to one ThreadPool job
+#define CLUSTER_CULLING_CHUNK 64
+
+// Matches PointLight in clustered/clusterLights.comp and clustered/pbr.fs
+struct ClusteredLight {
+    glm::vec4 position;
+    glm::vec4 color;
+    unsigned int enabled;
+    float intensity;
+    float range;
+    float something;
+};
+
+struct ScreenToView {
+    glm::mat4 inverseProj;
+    glm::uvec4 tileSizes;
+    glm::uvec2 screenDimensions;
+    glm::uvec2 tileScreenSizes;
+};
+
+// std430 layouts of the AABB and LightGrid structs in the clustered compute shaders
+struct ClusterAABB {
+    glm::vec4 minPoint;
+    glm::vec4 maxPoint;
+};
+
+struct LightGridEntry {
+    unsigned int offset;
+    unsigned int count;
+};
+
+struct ClusterGrid {
+    unsigned int sizeX = 16, sizeY = 9, sizeZ = 24;
+    // Same contents as the screenToView SSBO, tileSizes.w is the tile size in pixels
+    ScreenToView screenToView;
+    float zNear = 0.1f, zFar = 100.0f;
+
+    unsigned int getNumClusters() const { return sizeX * sizeY * sizeZ; }
+};
+
+struct ClusterCullingStats {
+    unsigned int enabledLights = 0;
+    unsigned int indices = 0;
+    unsigned int maxClusterLights = 0;
+    // Clusters that hit maxLightsPerCluster and dropped lights
+    unsigned int overflowedClusters = 0;
+
+    float buildMilliseconds = 0.0f;
+    float assignMilliseconds = 0.0f;
+};
+
+struct ClusterComparison {
+    unsigned int clusters = 0;
+    unsigned int mismatchedBounds = 0;
+    unsigned int mismatchedLights = 0;
+    int firstMismatch = -1;
+
+    bool matches() const { return mismatchedBounds == 0 && mismatchedLights == 0; }
+};
+
+// CPU version of tileCreate.comp and clusterLights.comp. Clusters are split across the
+// ThreadPool and each one tests four lights at a time with SSE, falling back to scalar code
+// elsewhere. The output has the layout of the lightGrid and globalLightIndexList buffers, but
+// offsets are in cluster order where the GPU's follow its atomics, so compare checks each
+// cluster's lights as a set.
+class ClusterCuller {
+    public:
+        void buildClusters(const ClusterGrid& grid);
+        // Lights past maxLightsPerCluster are dropped from that cluster and counted in the stats
+        void assignLights(const ClusteredLight* lights, size_t count, const glm::mat4& view, unsigned int maxLightsPerCluster);
+
+        // Checks read back GPU buffers against the last CPU result. With activeClusters, light
+        // lists are only compared for clusters flagged non-zero, the rest were never culled.
+        ClusterComparison compare(const ClusterAABB* gpuClusters, const LightGridEntry* gpuGrid,
+            const unsigned int* gpuIndices, size_t gpuIndexCount, const unsigned char* activeClusters = nullptr) const;
+
+        const std::vector<ClusterAABB>& getClusters() const { return clusters; }
+        const std::vector<LightGridEntry>& getLightGrid() const { return lightGrid; }
+        const std::vector<unsigned int>& getLightIndices() const { return lightIndices; }
+        const ClusterCullingStats& getStats() const { return stats; }
+
+    private:
+        std::vector<ClusterAABB> clusters;
+        std::vector<LightGridEntry> lightGrid;
+        std::vector<unsigned int> lightIndices;
+
+        // View space light spheres as structure of arrays, padded to a multiple of four with
+        // lanes that never pass. Disabled lights are padding as well.
+        std::vector<float> centerX, centerY, centerZ, radiusSquared;
+        std::vector<unsigned int> lightIDs;
+
+        // maxLightsPerCluster slots per cluster, compacted into lightIndices afterwards
+        std::vector<unsigned int> clusterSlots;
+        ClusterCullingStats stats;
+
+        void assignCluster(size_t cluster, unsigned int maxLightsPerCluster);
+};
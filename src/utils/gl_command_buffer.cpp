@@ -0,0 +1,284 @@
+#include "gl_command_buffer.h"
+#include "gl_state.h"
+
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+
+struct FramebufferCommand { unsigned int framebuffer; };
+struct FramebufferTextureCommand { unsigned int framebuffer; GLenum attachment; unsigned int texture; };
+struct ViewportCommand { int x, y, width, height; };
+struct ClearCommand { GLbitfield mask; };
+struct TextureRegionCommand { unsigned int source, destination; int x, y, layer, width, height; float depth; };
+struct CullFaceCommand { GLenum mode; };
+struct DepthFuncCommand { GLenum func; };
+struct DepthMaskCommand { bool write; };
+struct ProgramCommand { unsigned int program; };
+struct VertexArrayCommand { unsigned int VAO; };
+struct TextureCommand { unsigned int unit; unsigned int texture; GLenum target; };
+struct SamplerCommand { unsigned int program; int location; int unit; };
+struct EmptyCommand {};
+struct UniformCommand { unsigned int program; int location; CommandUniformType type; };
+struct BufferRangeCommand { GLenum target; unsigned int binding; unsigned int buffer; size_t offset, size; };
+struct InstancesCommand { size_t first, count; };
+struct DrawArraysCommand { GLenum mode; int first, count; };
+struct DrawElementsCommand { GLenum mode; unsigned int indexCount, firstIndex; int baseVertex; unsigned int instanceCount; };
+struct DispatchCommand { unsigned int x, y, z; };
+struct BarrierCommand { GLbitfield barriers; };
+
+template <typename T>
+void CommandBuffer::write(CommandType type, const T& payload, const void* extra, size_t extraSize) {
+    CommandHeader header;
+    header.type = type;
+    header.size = sizeof(T) + extraSize;
+
+    size_t offset = stream.size();
+    stream.resize(offset + sizeof(CommandHeader) + header.size);
+    std::memcpy(&stream[offset], &header, sizeof(CommandHeader));
+    std::memcpy(&stream[offset + sizeof(CommandHeader)], &payload, sizeof(T));
+    if (extraSize > 0) std::memcpy(&stream[offset + sizeof(CommandHeader) + sizeof(T)], extra, extraSize);
+
+    numCommands++;
+}
+
+void CommandBuffer::bindFramebuffer(unsigned int framebuffer) {
+    write(CMD_BIND_FRAMEBUFFER, FramebufferCommand{ framebuffer });
+}
+
+void CommandBuffer::framebufferTexture(unsigned int framebuffer, GLenum attachment, unsigned int texture) {
+    write(CMD_FRAMEBUFFER_TEXTURE, FramebufferTextureCommand{ framebuffer, attachment, texture });
+}
+
+void CommandBuffer::viewport(int x, int y, int width, int height) {
+    write(CMD_VIEWPORT, ViewportCommand{ x, y, width, height });
+}
+
+void CommandBuffer::clear(GLbitfield mask) {
+    write(CMD_CLEAR, ClearCommand{ mask });
+}
+
+void CommandBuffer::clearDepthRegion(unsigned int texture, int x, int y, int width, int height, float depth, int layer) {
+    write(CMD_CLEAR_DEPTH_REGION, TextureRegionCommand{ 0, texture, x, y, layer, width, height, depth });
+}
+
+void CommandBuffer::copyTextureRegion(unsigned int source, unsigned int destination, int x, int y, int width, int height) {
+    write(CMD_COPY_TEXTURE_REGION, TextureRegionCommand{ source, destination, x, y, 0, width, height, 0.0f });
+}
+
+void CommandBuffer::cullFace(GLenum mode) {
+    write(CMD_CULL_FACE, CullFaceCommand{ mode });
+}
+
+void CommandBuffer::depthFunc(GLenum func) {
+    write(CMD_DEPTH_FUNC, DepthFuncCommand{ func });
+}
+
+void CommandBuffer::depthMask(bool writeDepth) {
+    write(CMD_DEPTH_MASK, DepthMaskCommand{ writeDepth });
+}
+
+void CommandBuffer::useProgram(unsigned int program) {
+    write(CMD_USE_PROGRAM, ProgramCommand{ program });
+}
+
+void CommandBuffer::bindVertexArray(unsigned int VAO) {
+    write(CMD_BIND_VERTEX_ARRAY, VertexArrayCommand{ VAO });
+}
+
+void CommandBuffer::bindTexture(unsigned int unit, unsigned int texture, GLenum target) {
+    write(CMD_BIND_TEXTURE, TextureCommand{ unit, texture, target });
+}
+
+void CommandBuffer::setSampler(unsigned int program, int location, int unit) {
+    if (location < 0) return;
+    write(CMD_SET_SAMPLER, SamplerCommand{ program, location, unit });
+}
+
+void CommandBuffer::forgetSamplers() {
+    write(CMD_FORGET_SAMPLERS, EmptyCommand{});
+}
+
+void CommandBuffer::writeUniform(unsigned int program, int location, CommandUniformType type, const void* value, size_t size) {
+    if (location < 0) return;
+    write(CMD_UNIFORM, UniformCommand{ program, location, type }, value, size);
+}
+
+void CommandBuffer::setInt(unsigned int program, int location, int value) {
+    writeUniform(program, location, COMMAND_UNIFORM_INT, &value, sizeof(int));
+}
+
+void CommandBuffer::setUint(unsigned int program, int location, unsigned int value) {
+    writeUniform(program, location, COMMAND_UNIFORM_UINT, &value, sizeof(unsigned int));
+}
+
+void CommandBuffer::setFloat(unsigned int program, int location, float value) {
+    writeUniform(program, location, COMMAND_UNIFORM_FLOAT, &value, sizeof(float));
+}
+
+void CommandBuffer::setVec3(unsigned int program, int location, const glm::vec3& value) {
+    writeUniform(program, location, COMMAND_UNIFORM_VEC3, glm::value_ptr(value), sizeof(glm::vec3));
+}
+
+void CommandBuffer::setVec4(unsigned int program, int location, const glm::vec4& value) {
+    writeUniform(program, location, COMMAND_UNIFORM_VEC4, glm::value_ptr(value), sizeof(glm::vec4));
+}
+
+void CommandBuffer::setMat4(unsigned int program, int location, const glm::mat4& value) {
+    writeUniform(program, location, COMMAND_UNIFORM_MAT4, glm::value_ptr(value), sizeof(glm::mat4));
+}
+
+void CommandBuffer::bindBufferRange(GLenum target, unsigned int binding, unsigned int buffer, size_t offset, size_t size) {
+    write(CMD_BIND_BUFFER_RANGE, BufferRangeCommand{ target, binding, buffer, offset, size });
+}
+
+void CommandBuffer::uploadInstances(const std::vector<InstanceData>& instances) {
+    InstancesCommand command{ instanceData.size(), instances.size() };
+    instanceData.insert(instanceData.end(), instances.begin(), instances.end());
+    write(CMD_UPLOAD_INSTANCES, command);
+}
+
+void CommandBuffer::drawArrays(GLenum mode, int first, int count) {
+    write(CMD_DRAW_ARRAYS, DrawArraysCommand{ mode, first, count });
+}
+
+void CommandBuffer::drawElements(GLenum mode, unsigned int indexCount, unsigned int firstIndex, int baseVertex, unsigned int instanceCount) {
+    write(CMD_DRAW_ELEMENTS, DrawElementsCommand{ mode, indexCount, firstIndex, baseVertex, instanceCount });
+}
+
+void CommandBuffer::dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ) {
+    write(CMD_DISPATCH, DispatchCommand{ groupsX, groupsY, groupsZ });
+}
+
+void CommandBuffer::memoryBarrier(GLbitfield barriers) {
+    write(CMD_MEMORY_BARRIER, BarrierCommand{ barriers });
+}
+
+template <typename T>
+static T readPayload(const unsigned char* data) {
+    T payload;
+    std::memcpy(&payload, data, sizeof(T));
+    return payload;
+}
+
+static void executeUniform(const UniformCommand& command, const unsigned char* data) {
+    switch (command.type) {
+        case COMMAND_UNIFORM_INT: glProgramUniform1i(command.program, command.location, readPayload<int>(data)); break;
+        case COMMAND_UNIFORM_UINT: glProgramUniform1ui(command.program, command.location, readPayload<unsigned int>(data)); break;
+        case COMMAND_UNIFORM_FLOAT: glProgramUniform1f(command.program, command.location, readPayload<float>(data)); break;
+        case COMMAND_UNIFORM_VEC3: {
+            glm::vec3 value = readPayload<glm::vec3>(data);
+            glProgramUniform3fv(command.program, command.location, 1, glm::value_ptr(value));
+            break;
+        }
+        case COMMAND_UNIFORM_VEC4: {
+            glm::vec4 value = readPayload<glm::vec4>(data);
+            glProgramUniform4fv(command.program, command.location, 1, glm::value_ptr(value));
+            break;
+        }
+        case COMMAND_UNIFORM_MAT4: {
+            glm::mat4 value = readPayload<glm::mat4>(data);
+            glProgramUniformMatrix4fv(command.program, command.location, 1, GL_FALSE, glm::value_ptr(value));
+            break;
+        }
+    }
+}
+
+void CommandBuffer::execute() {
+    GLState& state = GLState::get();
+
+    size_t offset = 0;
+    while (offset < stream.size()) {
+        CommandHeader header = readPayload<CommandHeader>(&stream[offset]);
+        const unsigned char* data = &stream[offset + sizeof(CommandHeader)];
+        offset += sizeof(CommandHeader) + header.size;
+
+        switch (header.type) {
+            case CMD_BIND_FRAMEBUFFER: state.bindFramebuffer(readPayload<FramebufferCommand>(data).framebuffer); break;
+            case CMD_FRAMEBUFFER_TEXTURE: {
+                FramebufferTextureCommand command = readPayload<FramebufferTextureCommand>(data);
+                glNamedFramebufferTexture(command.framebuffer, command.attachment, command.texture, 0);
+                break;
+            }
+            case CMD_VIEWPORT: {
+                ViewportCommand command = readPayload<ViewportCommand>(data);
+                state.viewport(command.x, command.y, command.width, command.height);
+                break;
+            }
+            case CMD_CLEAR: glClear(readPayload<ClearCommand>(data).mask); break;
+            case CMD_CLEAR_DEPTH_REGION: {
+                TextureRegionCommand command = readPayload<TextureRegionCommand>(data);
+                glClearTexSubImage(command.destination, 0, command.x, command.y, command.layer, command.width, command.height, 1,
+                    GL_DEPTH_COMPONENT, GL_FLOAT, &command.depth);
+                break;
+            }
+            case CMD_COPY_TEXTURE_REGION: {
+                TextureRegionCommand command = readPayload<TextureRegionCommand>(data);
+                glCopyImageSubData(command.source, GL_TEXTURE_2D, 0, command.x, command.y, 0,
+                    command.destination, GL_TEXTURE_2D, 0, command.x, command.y, 0, command.width, command.height, 1);
+                break;
+            }
+            case CMD_CULL_FACE: state.cullFace(readPayload<CullFaceCommand>(data).mode); break;
+            case CMD_DEPTH_FUNC: state.depthFunc(readPayload<DepthFuncCommand>(data).func); break;
+            case CMD_DEPTH_MASK: state.depthMask(readPayload<DepthMaskCommand>(data).write); break;
+            case CMD_USE_PROGRAM: state.useProgram(readPayload<ProgramCommand>(data).program); break;
+            case CMD_BIND_VERTEX_ARRAY: state.bindVertexArray(readPayload<VertexArrayCommand>(data).VAO); break;
+            case CMD_BIND_TEXTURE: {
+                TextureCommand command = readPayload<TextureCommand>(data);
+                if (command.target == GL_NONE) state.bindTextureUnit(command.unit, command.texture);
+                else state.bindTexture(command.unit, command.target, command.texture);
+                break;
+            }
+            case CMD_SET_SAMPLER: {
+                SamplerCommand command = readPayload<SamplerCommand>(data);
+                state.setSampler(command.program, command.location, command.unit);
+                break;
+            }
+            case CMD_FORGET_SAMPLERS: state.forgetSamplers(); break;
+            case CMD_UNIFORM: {
+                UniformCommand command = readPayload<UniformCommand>(data);
+                executeUniform(command, data + sizeof(UniformCommand));
+                break;
+            }
+            case CMD_BIND_BUFFER_RANGE: {
+                BufferRangeCommand command = readPayload<BufferRangeCommand>(data);
+                if (command.size == 0) glBindBufferBase(command.target, command.binding, command.buffer);
+                else glBindBufferRange(command.target, command.binding, command.buffer, command.offset, command.size);
+                break;
+            }
+            case CMD_UPLOAD_INSTANCES: {
+                InstancesCommand command = readPayload<InstancesCommand>(data);
+                instanceBuffer.upload(instanceData.data() + command.first, command.count);
+                break;
+            }
+            case CMD_DRAW_ARRAYS: {
+                DrawArraysCommand command = readPayload<DrawArraysCommand>(data);
+                glDrawArrays(command.mode, command.first, command.count);
+                state.recordDraw();
+                break;
+            }
+            case CMD_DRAW_ELEMENTS: {
+                DrawElementsCommand command = readPayload<DrawElementsCommand>(data);
+                void* indexOffset = (void*) (command.firstIndex * sizeof(unsigned int));
+                if (command.instanceCount > 1) {
+                    glDrawElementsInstancedBaseVertex(command.mode, command.indexCount, GL_UNSIGNED_INT, indexOffset,
+                        command.instanceCount, command.baseVertex);
+                } else {
+                    glDrawElementsBaseVertex(command.mode, command.indexCount, GL_UNSIGNED_INT, indexOffset, command.baseVertex);
+                }
+                state.recordDraw();
+                break;
+            }
+            case CMD_DISPATCH: {
+                DispatchCommand command = readPayload<DispatchCommand>(data);
+                glDispatchCompute(command.x, command.y, command.z);
+                break;
+            }
+            case CMD_MEMORY_BARRIER: glMemoryBarrier(readPayload<BarrierCommand>(data).barriers); break;
+        }
+    }
+}
+
+void CommandBuffer::reset() {
+    stream.clear();
+    instanceData.clear();
+    numCommands = 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "utils/gl_instancing.h"
+
+enum CommandType : uint32_t {
+    CMD_BIND_FRAMEBUFFER = 0,
+    CMD_FRAMEBUFFER_TEXTURE,
+    CMD_CLEAR_DEPTH_REGION,
+    CMD_COPY_TEXTURE_REGION,
+    CMD_VIEWPORT,
+    CMD_CLEAR,
+    CMD_CULL_FACE,
+    CMD_DEPTH_FUNC,
+    CMD_DEPTH_MASK,
+    CMD_USE_PROGRAM,
+    CMD_BIND_VERTEX_ARRAY,
+    CMD_BIND_TEXTURE,
+    CMD_SET_SAMPLER,
+    CMD_FORGET_SAMPLERS,
+    CMD_UNIFORM,
+    CMD_BIND_BUFFER_RANGE,
+    CMD_UPLOAD_INSTANCES,
+    CMD_DRAW_ARRAYS,
+    CMD_DRAW_ELEMENTS,
+    CMD_DISPATCH,
+    CMD_MEMORY_BARRIER
+};
+
+enum CommandUniformType : uint32_t {
+    COMMAND_UNIFORM_INT = 0,
+    COMMAND_UNIFORM_UINT,
+    COMMAND_UNIFORM_FLOAT,
+    COMMAND_UNIFORM_VEC3,
+    COMMAND_UNIFORM_VEC4,
+    COMMAND_UNIFORM_MAT4
+};
+
+// Packed stream of GL work recorded without touching GL, so any thread can fill one.
+// The GL thread replays it with execute, which sends every bind through the state cache.
+// Uniforms are written with glProgramUniform so they don't depend on the bound program.
+class CommandBuffer {
+    public:
+        void bindFramebuffer(unsigned int framebuffer);
+        void framebufferTexture(unsigned int framebuffer, GLenum attachment, unsigned int texture);
+        void viewport(int x, int y, int width, int height);
+        void clear(GLbitfield mask);
+        // Region of a 2D depth texture or one layer of an array, no framebuffer or scissor needed
+        void clearDepthRegion(unsigned int texture, int x, int y, int width, int height, float depth = 1.0f, int layer = 0);
+        // Same region of two 2D textures of one format, like atlases sharing a layout
+        void copyTextureRegion(unsigned int source, unsigned int destination, int x, int y, int width, int height);
+        void cullFace(GLenum mode);
+        void depthFunc(GLenum func);
+        void depthMask(bool write);
+
+        void useProgram(unsigned int program);
+        void bindVertexArray(unsigned int VAO);
+        // GL_NONE binds through glBindTextureUnit
+        void bindTexture(unsigned int unit, unsigned int texture, GLenum target = GL_NONE);
+        void setSampler(unsigned int program, int location, int unit);
+        void forgetSamplers();
+
+        // Locations of -1 (uniforms the program doesn't use) are dropped while recording
+        void setInt(unsigned int program, int location, int value);
+        void setUint(unsigned int program, int location, unsigned int value);
+        void setFloat(unsigned int program, int location, float value);
+        void setVec3(unsigned int program, int location, const glm::vec3& value);
+        void setVec4(unsigned int program, int location, const glm::vec4& value);
+        void setMat4(unsigned int program, int location, const glm::mat4& value);
+
+        // GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER, a size of 0 binds the whole buffer
+        void bindBufferRange(GLenum target, unsigned int binding, unsigned int buffer, size_t offset = 0, size_t size = 0);
+        // Copied into the stream now, uploaded to the instance buffer when replayed
+        void uploadInstances(const std::vector<InstanceData>& instances);
+
+        void drawArrays(GLenum mode, int first, int count);
+        void drawElements(GLenum mode, unsigned int indexCount, unsigned int firstIndex, int baseVertex, unsigned int instanceCount = 1);
+        void dispatch(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
+        void memoryBarrier(GLbitfield barriers);
+
+        void execute();
+        void reset();
+
+        bool empty() const { return numCommands == 0; }
+        unsigned int getNumCommands() const { return numCommands; }
+        size_t getSize() const { return stream.size(); }
+
+    private:
+        struct CommandHeader {
+            CommandType type;
+            uint32_t size;
+        };
+
+        std::vector<unsigned char> stream;
+        std::vector<InstanceData> instanceData;
+        unsigned int numCommands = 0;
+
+        // Only touched by execute on the GL thread
+        InstanceBuffer instanceBuffer;
+
+        template <typename T>
+        void write(CommandType type, const T& payload, const void* extra = nullptr, size_t extraSize = 0);
+        void writeUniform(unsigned int program, int location, CommandUniformType type, const void* value, size_t size);
+};
@@ -1,4 +1,7 @@
 #include "gl_compute.h"
+#include "gl_state.h"
+#include "gl_program_cache.h"
+#include "gl_shader_preprocessor.h"
 
 #include <fstream>
 #include <sstream>
@@ -7,102 +10,122 @@
 ComputeShader::ComputeShader() {}
 
 ComputeShader::ComputeShader(std::string computePath) {
-    std::string generalPath = "../../shaders/";
-    std::string fullPath = generalPath + computePath;
+    ShaderPreprocessor preprocessor;
     std::string computeCode;
-    std::ifstream computeFile;
+    preprocessor.process(computePath, 0, computeCode);
 
-    computeFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    try {
-        computeFile.open(fullPath);
-        std::stringstream computeStream;
-
-        computeStream << computeFile.rdbuf();
-        computeFile.close();
-
-        computeCode = computeStream.str();
-    } catch (std::ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
-
-    unsigned int compute;
-
-    const char* cShaderCode = computeCode.c_str();
-    compute = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(compute, 1, &cShaderCode, nullptr);
-    glCompileShader(compute);
-    checkCompileErrors(compute, "COMPUTE");
-
-    ID = glCreateProgram();
-    glAttachShader(ID, compute);
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    setProgram(ProgramCache::get().getProgram({ { GL_COMPUTE_SHADER, computePath, computeCode } }));
+}
 
-    glDeleteShader(compute);
+void ComputeShader::setProgram(unsigned int program) {
+    ID = program;
+    reflection.reflect(ID);
 }
 
 void ComputeShader::use() {
-    glUseProgram(ID);
+    GLState::get().useProgram(ID);
 }
 
 void ComputeShader::setBool(const std::string &name, bool value) const
 {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    glUniform1i(reflection.getLocation(UniformId(name)), (int)value); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setInt(const std::string &name, int value) const
 { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(reflection.getLocation(UniformId(name)), value); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setFloat(const std::string &name, float value) const
 { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(reflection.getLocation(UniformId(name)), value); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setVec2(const std::string &name, const glm::vec2 &value) const
 { 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform2fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void ComputeShader::setVec2(const std::string &name, float x, float y) const
 { 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    glUniform2f(reflection.getLocation(UniformId(name)), x, y); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setVec3(const std::string &name, const glm::vec3 &value) const
 { 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform3fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void ComputeShader::setVec3(const std::string &name, float x, float y, float z) const
 { 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    glUniform3f(reflection.getLocation(UniformId(name)), x, y, z); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setVec4(const std::string &name, const glm::vec4 &value) const
 { 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform4fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void ComputeShader::setVec4(const std::string &name, float x, float y, float z, float w) 
 { 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    glUniform4f(reflection.getLocation(UniformId(name)), x, y, z, w); 
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void ComputeShader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
+}
+
+// ------------------------------------------------------------------------
+int ComputeShader::getUniformLocation(UniformId id) const
+{
+    return reflection.getLocation(id);
+}
+void ComputeShader::setBool(UniformId id, bool value) const
+{
+    glUniform1i(reflection.getLocation(id), (int)value);
+}
+void ComputeShader::setInt(UniformId id, int value) const
+{
+    glUniform1i(reflection.getLocation(id), value);
+}
+void ComputeShader::setFloat(UniformId id, float value) const
+{
+    glUniform1f(reflection.getLocation(id), value);
+}
+void ComputeShader::setVec2(UniformId id, const glm::vec2 &value) const
+{
+    glUniform2fv(reflection.getLocation(id), 1, &value[0]);
+}
+void ComputeShader::setVec3(UniformId id, const glm::vec3 &value) const
+{
+    glUniform3fv(reflection.getLocation(id), 1, &value[0]);
+}
+void ComputeShader::setVec4(UniformId id, const glm::vec4 &value) const
+{
+    glUniform4fv(reflection.getLocation(id), 1, &value[0]);
+}
+void ComputeShader::setMat2(UniformId id, const glm::mat2 &mat) const
+{
+    glUniformMatrix2fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
+}
+void ComputeShader::setMat3(UniformId id, const glm::mat3 &mat) const
+{
+    glUniformMatrix3fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
+}
+void ComputeShader::setMat4(UniformId id, const glm::mat4 &mat) const
+{
+    glUniformMatrix4fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
 }
 
-void checkCompileErrors(unsigned int shader, std::string type) {
+bool checkCompileErrors(unsigned int shader, std::string type) {
     int success;
     char infoLog[1024];
     if (type != "PROGRAM")
@@ -123,4 +146,5 @@ void checkCompileErrors(unsigned int shader, std::string type) {
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success;
 }
\ No newline at end of file
@@ -6,15 +6,19 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "gl_reflection.h"
 
 class ComputeShader {
     public:
-        unsigned int ID;
+        unsigned int ID = 0;
 
         ComputeShader();
         ComputeShader(std::string computePath);
         void use();
 
+        // Points the shader at a linked program and reflects it, used by the ShaderManager
+        void setProgram(unsigned int program);
+
         void setBool(const std::string &name, bool value) const;
         // ------------------------------------------------------------------------
         void setInt(const std::string &name, int value) const;
@@ -35,6 +39,24 @@ class ComputeShader {
         void setMat3(const std::string &name, const glm::mat3 &mat) const;
         // ------------------------------------------------------------------------
         void setMat4(const std::string &name, const glm::mat4 &mat) const;
+
+        // Cached location versions, use "name"_u for literals or uniformArray for array elements
+        void setBool(UniformId id, bool value) const;
+        void setInt(UniformId id, int value) const;
+        void setFloat(UniformId id, float value) const;
+        void setVec2(UniformId id, const glm::vec2 &value) const;
+        void setVec3(UniformId id, const glm::vec3 &value) const;
+        void setVec4(UniformId id, const glm::vec4 &value) const;
+        void setMat2(UniformId id, const glm::mat2 &mat) const;
+        void setMat3(UniformId id, const glm::mat3 &mat) const;
+        void setMat4(UniformId id, const glm::mat4 &mat) const;
+
+        int getUniformLocation(UniformId id) const;
+        const ProgramReflection& getReflection() const { return reflection; }
+
+    private:
+        ProgramReflection reflection;
 };
 
-void checkCompileErrors(unsigned int shader, std::string type);
\ No newline at end of file
+// Prints the info log and returns false when the shader failed to compile or the program to link
+bool checkCompileErrors(unsigned int shader, std::string type);
\ No newline at end of file
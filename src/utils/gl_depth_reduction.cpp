@@ -0,0 +1,139 @@
+#include "gl_depth_reduction.h"
+#include "gl_shader_manager.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// Float bits of the largest finite float, positive floats order the same as their bits
+#define DEPTH_REDUCTION_EMPTY_MIN 0x7F7FFFFFu
+
+void DepthReduction::init() {
+    ShaderManager::get().load(reduceCompute, "shadows/depthReduce.comp");
+
+    int alignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    slotSize = std::max((size_t) alignment, 2 * sizeof(unsigned int));
+
+    GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    size_t size = slotSize * DEPTH_REDUCTION_FRAMES;
+    unsigned int buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, nullptr, flags);
+    results = (unsigned int*) glMapNamedBufferRange(buffer, 0, size, flags);
+    ResourceRegistry::get().trackBuffer(buffer, size, flags, "depth reduction");
+    resultBuffer = BufferHandle(buffer);
+
+    if (results == nullptr) {
+        std::cout << "ERROR::DEPTH_REDUCTION::BUFFER_NOT_MAPPED" << std::endl;
+    }
+}
+
+void DepthReduction::collect() {
+    for (int i = 0; i < DEPTH_REDUCTION_FRAMES; i++) {
+        int slot = (currentSlot + i) % DEPTH_REDUCTION_FRAMES;
+        if (fences[slot] == nullptr) continue;
+
+        // Slots finish in order, once one is still running the newer ones are as well
+        if (glClientWaitSync(fences[slot], 0, 0) == GL_TIMEOUT_EXPIRED) break;
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+
+        const unsigned int* result = results + slot * slotSize / sizeof(unsigned int);
+        hasRange = result[1] != 0;
+        if (hasRange) {
+            std::memcpy(&minDepth, &result[0], sizeof(float));
+            std::memcpy(&maxDepth, &result[1], sizeof(float));
+        }
+    }
+}
+
+void DepthReduction::reduce(unsigned int depthTexture, int width, int height, float zNear, float zFar) {
+    if (results == nullptr) return;
+
+    collect();
+    // The GPU is more than DEPTH_REDUCTION_FRAMES behind, skip a frame rather than wait on it
+    if (fences[currentSlot] != nullptr) return;
+
+    unsigned int* result = results + currentSlot * slotSize / sizeof(unsigned int);
+    result[0] = DEPTH_REDUCTION_EMPTY_MIN;
+    result[1] = 0;
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, DEPTH_REDUCTION_BINDING, resultBuffer, currentSlot * slotSize, 2 * sizeof(unsigned int));
+    GLState::get().bindTextureUnit(0, depthTexture);
+
+    reduceCompute.use();
+    reduceCompute.setFloat("zNear"_u, zNear);
+    reduceCompute.setFloat("zFar"_u, zFar);
+    glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+
+    // Atomics land in the mapped buffer before the fence signals
+    glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+    fences[currentSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    currentSlot = (currentSlot + 1) % DEPTH_REDUCTION_FRAMES;
+}
+
+// Sized format of the framebuffer's depth attachment, GL_NONE when it has none
+static GLenum getDepthFormat(unsigned int framebuffer) {
+    // The default framebuffer names its buffers instead of attachment points
+    GLenum depthAttachment = framebuffer == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+    GLenum stencilAttachment = framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+
+    int objectType = GL_NONE;
+    glGetNamedFramebufferAttachmentParameteriv(framebuffer, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &objectType);
+    if (objectType == GL_NONE) return GL_NONE;
+
+    int depthBits = 0, componentType = GL_NONE, stencilBits = 0;
+    glGetNamedFramebufferAttachmentParameteriv(framebuffer, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+    glGetNamedFramebufferAttachmentParameteriv(framebuffer, depthAttachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &componentType);
+    glGetNamedFramebufferAttachmentParameteriv(framebuffer, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &objectType);
+    if (objectType != GL_NONE) {
+        glGetNamedFramebufferAttachmentParameteriv(framebuffer, stencilAttachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+    }
+
+    if (componentType == GL_FLOAT) return stencilBits > 0 ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+    if (stencilBits > 0) return GL_DEPTH24_STENCIL8;
+    if (depthBits <= 16) return GL_DEPTH_COMPONENT16;
+    return depthBits <= 24 ? GL_DEPTH_COMPONENT24 : GL_DEPTH_COMPONENT32;
+}
+
+void DepthReduction::reduceFramebuffer(unsigned int framebuffer, int width, int height, float zNear, float zFar) {
+    // Blits between depth buffers only work when the formats match
+    GLenum format = getDepthFormat(framebuffer);
+    if (format == GL_NONE) {
+        std::cout << "ERROR::DEPTH_REDUCTION::NO_DEPTH_ATTACHMENT" << std::endl;
+        return;
+    }
+
+    if (width != copyWidth || height != copyHeight || format != copyFormat) {
+        copyWidth = width;
+        copyHeight = height;
+        copyFormat = format;
+
+        unsigned int texture;
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureStorage2D(texture, 1, format, width, height);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D, format, width, height, 1, 1, "depth reduction copy");
+        depthCopy = TextureHandle(texture);
+
+        bool hasStencil = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+        depthCopyFramebuffer = glutil::createFramebuffer("depth reduction copy");
+        glNamedFramebufferTexture(depthCopyFramebuffer, hasStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depthCopy, 0);
+        glNamedFramebufferDrawBuffer(depthCopyFramebuffer, GL_NONE);
+        glNamedFramebufferReadBuffer(depthCopyFramebuffer, GL_NONE);
+    }
+
+    glBlitNamedFramebuffer(framebuffer, depthCopyFramebuffer, 0, 0, width, height, 0, 0, width, height,
+        GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    reduce(depthCopy, width, height, zNear, zFar);
+}
+
+bool DepthReduction::getRange(float& nearDepth, float& farDepth) const {
+    if (!hasRange) return false;
+
+    nearDepth = minDepth;
+    farDepth = maxDepth;
+    return true;
+}
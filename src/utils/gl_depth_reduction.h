@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "utils/gl_compute.h"
+#include "utils/gl_resources.h"
+
+#define DEPTH_REDUCTION_BINDING 17
+// Results in flight, each slot is read back once its fence passed and before it's written again
+#define DEPTH_REDUCTION_FRAMES 3
+
+// Nearest and farthest visible linear depth on screen, for fitting shadow cascades to what is
+// actually seen. depthReduce.comp takes the min and max of each 16x16 tile in shared memory and
+// folds it into a slot of a persistently mapped buffer with one atomic per tile. Slots are only
+// read once their fence passed, never waited on, so the range lags the screen by a frame or two
+// and the last one is kept when the GPU falls behind.
+class DepthReduction {
+    public:
+        // Queues the shader on the ShaderManager, the caller finishes the batch
+        void init();
+
+        // depthTexture holds window depth of a perspective projection between zNear and zFar
+        void reduce(unsigned int depthTexture, int width, int height, float zNear, float zFar);
+        // Same for the depth of a framebuffer, copied out first. The default framebuffer can't be sampled.
+        void reduceFramebuffer(unsigned int framebuffer, int width, int height, float zNear, float zFar);
+
+        // False until the first result came back, or when nothing but background was on screen
+        bool getRange(float& nearDepth, float& farDepth) const;
+
+    private:
+        ComputeShader reduceCompute;
+        BufferHandle resultBuffer;
+        unsigned int* results = nullptr;
+        size_t slotSize = 0;
+        GLsync fences[DEPTH_REDUCTION_FRAMES] = {};
+        int currentSlot = 0;
+
+        TextureHandle depthCopy;
+        FramebufferHandle depthCopyFramebuffer;
+        int copyWidth = 0, copyHeight = 0;
+        GLenum copyFormat = GL_NONE;
+
+        float minDepth = 0.0f, maxDepth = 0.0f;
+        bool hasRange = false;
+
+        // Takes the results of every slot the GPU finished, oldest first
+        void collect();
+};
@@ -0,0 +1,113 @@
+#include "gl_frame_constants.h"
+#include "gl_resources.h"
+#include "gl_state.h"
+
+#include <cstring>
+#include <iostream>
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void FrameConstants::init() {
+    int alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    cameraOffset = 0;
+    lightOffset = alignUp(cameraOffset + sizeof(CameraConstants), alignment);
+    shadowOffset = alignUp(lightOffset + sizeof(LightConstants), alignment);
+    timeOffset = alignUp(shadowOffset + sizeof(ShadowConstants), alignment);
+    uploadSize = alignUp(timeOffset + sizeof(TimeConstants), alignment);
+    frameSize = uploadSize * maxUploads;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, frameSize * FRAME_CONSTANT_FRAMES, nullptr, flags);
+    mappedData = (unsigned char*) glMapNamedBufferRange(buffer, 0, frameSize * FRAME_CONSTANT_FRAMES, flags);
+    ResourceRegistry::get().trackBuffer(buffer, frameSize * FRAME_CONSTANT_FRAMES, flags, "frame constants");
+
+    if (mappedData == nullptr) {
+        std::cout << "ERROR::FRAME_CONSTANTS::BUFFER_NOT_MAPPED" << std::endl;
+    }
+}
+
+void FrameConstants::setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position,
+    float nearPlane, float farPlane, int width, int height) {
+    camera.view = view;
+    camera.projection = projection;
+    camera.viewProjection = projection * view;
+    camera.invView = glm::inverse(view);
+    camera.invProjection = glm::inverse(projection);
+    camera.viewPos = position;
+    camera.clipInfo = glm::vec4(nearPlane, farPlane, (float) width, (float) height);
+}
+
+void FrameConstants::upload() {
+    if (buffer == 0) init();
+    if (mappedData == nullptr) return;
+
+    if (uploadsThisFrame == maxUploads) {
+        grow();
+        if (mappedData == nullptr) return;
+    }
+
+    size_t base = currentFrame * frameSize + uploadsThisFrame * uploadSize;
+    std::memcpy(mappedData + base + cameraOffset, &camera, sizeof(CameraConstants));
+    std::memcpy(mappedData + base + lightOffset, &lights, sizeof(LightConstants));
+    std::memcpy(mappedData + base + shadowOffset, &shadows, sizeof(ShadowConstants));
+    std::memcpy(mappedData + base + timeOffset, &time, sizeof(TimeConstants));
+    GLState::get().recordUpload(sizeof(CameraConstants) + sizeof(LightConstants) + sizeof(ShadowConstants) + sizeof(TimeConstants));
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_CONSTANTS_BINDING, buffer, base + cameraOffset, sizeof(CameraConstants));
+    glBindBufferRange(GL_UNIFORM_BUFFER, LIGHT_CONSTANTS_BINDING, buffer, base + lightOffset, sizeof(LightConstants));
+    glBindBufferRange(GL_UNIFORM_BUFFER, SHADOW_CONSTANTS_BINDING, buffer, base + shadowOffset, sizeof(ShadowConstants));
+    glBindBufferRange(GL_UNIFORM_BUFFER, TIME_CONSTANTS_BINDING, buffer, base + timeOffset, sizeof(TimeConstants));
+
+    uploadsThisFrame++;
+}
+
+void FrameConstants::grow() {
+    // Draws recorded so far keep the old ranges bound, the registry deletes the buffer after this frame's fence
+    ResourceRegistry::get().release(RESOURCE_BUFFER, buffer);
+    for (GLsync& fence : fences) {
+        if (fence != nullptr) glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    maxUploads *= 2;
+    currentFrame = 0;
+    uploadsThisFrame = 0;
+    init();
+}
+
+void FrameConstants::nextFrame() {
+    if (buffer == 0) return;
+
+    if (uploadsThisFrame > 0) {
+        if (fences[currentFrame] != nullptr) glDeleteSync(fences[currentFrame]);
+        fences[currentFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    currentFrame = (currentFrame + 1) % FRAME_CONSTANT_FRAMES;
+    uploadsThisFrame = 0;
+
+    if (fences[currentFrame] != nullptr) {
+        waitForFence(fences[currentFrame]);
+        glDeleteSync(fences[currentFrame]);
+        fences[currentFrame] = nullptr;
+    }
+}
+
+void FrameConstants::waitForFence(GLsync fence) {
+    // 1ms per try, flushing on the first one so the fence is guaranteed to be submitted
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+        GLenum result = glClientWaitSync(fence, waitFlags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) return;
+        if (result == GL_WAIT_FAILED) {
+            std::cout << "ERROR::FRAME_CONSTANTS::FENCE_WAIT_FAILED" << std::endl;
+            return;
+        }
+        waitFlags = 0;
+    }
+}
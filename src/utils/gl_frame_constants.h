@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#define FRAME_CONSTANT_FRAMES 3
+// Uploads a frame has room for to start with, doubled whenever a frame needs more
+#define FRAME_CONSTANT_INITIAL_UPLOADS 4
+#define MAX_FRAME_POINT_LIGHTS 32
+#define MAX_SHADOW_CASCADES 16
+
+// Fixed uniform buffer binding points shared by every program.
+// The shadow block starts with the LightSpaceMatrices layout used by the cascade geometry shaders.
+enum FrameConstantBinding {
+    SHADOW_CONSTANTS_BINDING = 0,
+    CAMERA_CONSTANTS_BINDING = 1,
+    LIGHT_CONSTANTS_BINDING = 2,
+    TIME_CONSTANTS_BINDING = 3
+};
+
+// All structs below follow std140 layout, vec3s are padded out to 16 bytes
+struct CameraConstants {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 invView;
+    glm::mat4 invProjection;
+    glm::vec3 viewPos;
+    float pad0;
+    // near, far, width, height
+    glm::vec4 clipInfo;
+};
+
+struct FrameDirLight {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct FramePointLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 ambient;
+    float pad0;
+    glm::vec3 diffuse;
+    float pad1;
+    glm::vec3 specular;
+    float pad2;
+};
+
+struct LightConstants {
+    FrameDirLight dirLight;
+    FramePointLight pointLights[MAX_FRAME_POINT_LIGHTS];
+    int numPointLights;
+    float pad[3];
+};
+
+struct ShadowConstants {
+    glm::mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];
+    // float array in std140 has a 16 byte stride, only x is used
+    glm::vec4 cascadePlaneDistances[MAX_SHADOW_CASCADES];
+    int cascadeCount;
+    float cascadeFarPlane;
+    float pad[2];
+};
+
+struct TimeConstants {
+    float time;
+    float deltaTime;
+    unsigned int frameIndex;
+    float pad;
+};
+
+class FrameConstants {
+    public:
+        CameraConstants camera = {};
+        LightConstants lights = {};
+        ShadowConstants shadows = {};
+        TimeConstants time = {};
+
+        void setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& position,
+            float nearPlane, float farPlane, int width, int height);
+
+        // Copies every block into the next free range of the current ring slot and binds it.
+        // Can be called several times per frame if a pass needs different values, ranges are
+        // never reused within a frame since earlier draws still read them.
+        void upload();
+
+        // Fences the slot the GPU is about to read and moves to the next one, waiting if the
+        // GPU is still FRAME_CONSTANT_FRAMES frames behind
+        void nextFrame();
+
+    private:
+        unsigned int buffer = 0;
+        unsigned char* mappedData = nullptr;
+        GLsync fences[FRAME_CONSTANT_FRAMES] = { nullptr };
+
+        int currentFrame = 0;
+        int uploadsThisFrame = 0;
+        int maxUploads = FRAME_CONSTANT_INITIAL_UPLOADS;
+
+        size_t cameraOffset = 0, lightOffset = 0, shadowOffset = 0, timeOffset = 0;
+        size_t uploadSize = 0, frameSize = 0;
+
+        void init();
+        // Moves to a ring with twice the uploads per frame, the old buffer is freed once the GPU is done with it
+        void grow();
+        void waitForFence(GLsync fence);
+};
@@ -0,0 +1,281 @@
+#include "gl_frame_graph.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <iostream>
+
+bool isDepthFormat(GLenum format) {
+    return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 ||
+        format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+static bool hasStencil(GLenum format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+unsigned int RenderTargetPool::acquire(const RenderTargetDesc& desc) {
+    for (PooledTarget& target : targets) {
+        if (target.inUse || !(target.desc == desc)) continue;
+
+        target.inUse = true;
+        target.lastUsedFrame = frameIndex;
+        return target.texture;
+    }
+
+    unsigned int textureID;
+    glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+    glTextureStorage2D(textureID, 1, desc.format, desc.width, desc.height);
+
+    GLenum filter = isDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+    glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, filter);
+    glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, filter);
+    glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_2D, desc.format, desc.width, desc.height, 1, 1, "render target");
+
+    PooledTarget target;
+    target.desc = desc;
+    target.texture = TextureHandle(textureID);
+    target.size = ResourceRegistry::estimateTextureSize(GL_TEXTURE_2D, desc.format, desc.width, desc.height, 1, 1);
+    target.inUse = true;
+    target.lastUsedFrame = frameIndex;
+    targets.push_back(std::move(target));
+
+    return textureID;
+}
+
+void RenderTargetPool::release(unsigned int texture) {
+    for (PooledTarget& target : targets) {
+        if (target.texture == texture) {
+            target.inUse = false;
+            return;
+        }
+    }
+}
+
+bool RenderTargetPool::beginFrame() {
+    frameIndex++;
+
+    size_t previousCount = targets.size();
+    targets.erase(std::remove_if(targets.begin(), targets.end(), [&](const PooledTarget& target) {
+        return frameIndex - target.lastUsedFrame > RENDER_TARGET_UNUSED_FRAMES;
+    }), targets.end());
+
+    for (PooledTarget& target : targets) target.inUse = false;
+    return targets.size() != previousCount;
+}
+
+size_t RenderTargetPool::getAllocatedBytes() const {
+    size_t bytes = 0;
+    for (const PooledTarget& target : targets) bytes += target.size;
+    return bytes;
+}
+
+void FrameGraph::reset() {
+    resources.clear();
+    passes.clear();
+
+    // Deleted textures may still be attached to cached framebuffers
+    if (pool.beginFrame()) framebuffers.clear();
+}
+
+FrameGraphResource FrameGraph::create(const std::string& name, const RenderTargetDesc& desc) {
+    ResourceNode resource;
+    resource.name = name;
+    resource.desc = desc;
+    resources.push_back(resource);
+
+    return resources.size() - 1;
+}
+
+FrameGraphResource FrameGraph::import(const std::string& name, unsigned int texture, const RenderTargetDesc& desc) {
+    ImportedTarget& previous = imports[name];
+    if (previous.texture != texture || !(previous.desc == desc)) {
+        invalidate(previous.texture);
+        invalidate(texture);
+        previous.texture = texture;
+        previous.desc = desc;
+    }
+
+    ResourceNode resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.texture = texture;
+    resource.imported = true;
+    resources.push_back(resource);
+
+    return resources.size() - 1;
+}
+
+unsigned int FrameGraph::addPass(const std::string& name, const FrameGraphExecute& execute) {
+    PassNode pass;
+    pass.name = name;
+    pass.execute = execute;
+    passes.push_back(pass);
+
+    return passes.size() - 1;
+}
+
+void FrameGraph::read(unsigned int pass, FrameGraphResource resource) {
+    passes[pass].reads.push_back(resource);
+}
+
+void FrameGraph::write(unsigned int pass, FrameGraphResource resource) {
+    passes[pass].writes.push_back(resource);
+    if (resources[resource].imported) passes[pass].hasSideEffects = true;
+}
+
+void FrameGraph::compile() {
+    stats = FrameGraphStats();
+    stats.numPasses = passes.size();
+    stats.numResources = resources.size();
+
+    cullPasses();
+    assignTargets();
+
+    stats.allocatedBytes = pool.getAllocatedBytes();
+}
+
+void FrameGraph::cullPasses() {
+    for (PassNode& pass : passes) {
+        pass.refCount = pass.writes.size();
+        pass.culled = false;
+        for (FrameGraphResource resource : pass.reads) resources[resource].refCount++;
+    }
+
+    std::vector<FrameGraphResource> unreferenced;
+    for (FrameGraphResource i = 0; i < resources.size(); i++) {
+        if (resources[i].refCount == 0 && !resources[i].imported) unreferenced.push_back(i);
+    }
+
+    while (!unreferenced.empty()) {
+        FrameGraphResource resource = unreferenced.back();
+        unreferenced.pop_back();
+
+        for (PassNode& pass : passes) {
+            if (pass.culled || pass.hasSideEffects) continue;
+            if (std::find(pass.writes.begin(), pass.writes.end(), resource) == pass.writes.end()) continue;
+
+            if (--pass.refCount > 0) continue;
+            pass.culled = true;
+            stats.culledPasses++;
+
+            for (FrameGraphResource input : pass.reads) {
+                if (--resources[input].refCount == 0 && !resources[input].imported) unreferenced.push_back(input);
+            }
+        }
+    }
+}
+
+void FrameGraph::assignTargets() {
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (passes[i].culled) continue;
+        for (FrameGraphResource resource : passes[i].reads) resources[resource].lastUse = (int) i;
+        for (FrameGraphResource resource : passes[i].writes) resources[resource].lastUse = (int) i;
+    }
+
+    for (size_t i = 0; i < passes.size(); i++) {
+        PassNode& pass = passes[i];
+        if (pass.culled) continue;
+
+        auto acquire = [&](FrameGraphResource index) {
+            ResourceNode& resource = resources[index];
+            if (resource.imported || resource.texture != 0) return;
+
+            resource.texture = pool.acquire(resource.desc);
+            stats.requestedBytes += ResourceRegistry::estimateTextureSize(GL_TEXTURE_2D, resource.desc.format,
+                resource.desc.width, resource.desc.height, 1, 1);
+        };
+        for (FrameGraphResource resource : pass.writes) acquire(resource);
+        for (FrameGraphResource resource : pass.reads) {
+            if (resources[resource].texture == 0 && !resources[resource].imported) {
+                std::cout << "ERROR::FRAME_GRAPH::READ_BEFORE_WRITE " << resources[resource].name << " in " << pass.name << std::endl;
+            }
+            acquire(resource);
+        }
+
+        // Anything this pass touched for the last time can back a later resource
+        for (ResourceNode& resource : resources) {
+            if (!resource.imported && resource.lastUse == (int) i) pool.release(resource.texture);
+        }
+    }
+}
+
+void FrameGraph::execute() {
+    std::vector<unsigned int> boundAttachments;
+    bool isBound = false;
+
+    for (PassNode& pass : passes) {
+        if (pass.culled) continue;
+
+        std::vector<unsigned int> attachments;
+        for (FrameGraphResource resource : pass.writes) attachments.push_back(resources[resource].texture);
+
+        if (!isBound || attachments != boundAttachments) {
+            bindPassTargets(pass, attachments);
+            boundAttachments = attachments;
+            isBound = true;
+            stats.framebufferBinds++;
+        } else {
+            stats.mergedPasses++;
+        }
+
+        pass.execute(*this);
+    }
+
+    GLState::get().bindFramebuffer(0);
+}
+
+void FrameGraph::bindPassTargets(const PassNode& pass, const std::vector<unsigned int>& attachments) {
+    if (pass.writes.empty()) return;
+
+    bool writesBackbuffer = std::find(attachments.begin(), attachments.end(), 0u) != attachments.end();
+    GLState::get().bindFramebuffer(writesBackbuffer ? 0 : getFramebuffer(attachments));
+
+    const RenderTargetDesc& desc = resources[pass.writes[0]].desc;
+    GLState::get().viewport(0, 0, desc.width, desc.height);
+}
+
+unsigned int FrameGraph::getFramebuffer(const std::vector<unsigned int>& textures) {
+    auto it = framebuffers.find(textures);
+    if (it != framebuffers.end()) return it->second;
+
+    FramebufferHandle framebuffer = glutil::createFramebuffer("frame graph");
+
+    std::vector<GLenum> drawBuffers;
+    for (unsigned int texture : textures) {
+        const ResourceDesc* desc = ResourceRegistry::get().find(RESOURCE_TEXTURE, texture);
+        GLenum format = desc != nullptr ? desc->format : GL_RGBA8;
+
+        if (isDepthFormat(format)) {
+            GLenum attachment = hasStencil(format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            glNamedFramebufferTexture(framebuffer, attachment, texture, 0);
+        } else {
+            GLenum attachment = GL_COLOR_ATTACHMENT0 + drawBuffers.size();
+            glNamedFramebufferTexture(framebuffer, attachment, texture, 0);
+            drawBuffers.push_back(attachment);
+        }
+    }
+
+    if (drawBuffers.empty()) {
+        glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+        glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+    } else glNamedFramebufferDrawBuffers(framebuffer, drawBuffers.size(), drawBuffers.data());
+
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Framebuffer not complete! " << std::endl;
+    }
+
+    unsigned int framebufferID = framebuffer;
+    framebuffers[textures] = std::move(framebuffer);
+    return framebufferID;
+}
+
+void FrameGraph::invalidate(unsigned int texture) {
+    if (texture == 0) return;
+
+    for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+        if (std::find(it->first.begin(), it->first.end(), texture) != it->first.end()) it = framebuffers.erase(it);
+        else ++it;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "utils/gl_resources.h"
+
+// Frames a pooled target can sit unused before its texture is deleted
+#define RENDER_TARGET_UNUSED_FRAMES 8
+#define INVALID_FRAME_GRAPH_RESOURCE ((FrameGraphResource) -1)
+
+struct RenderTargetDesc {
+    int width = 0, height = 0;
+    GLenum format = GL_RGBA8;
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return width == other.width && height == other.height && format == other.format;
+    }
+};
+
+bool isDepthFormat(GLenum format);
+
+// Full screen textures handed out by size/format. A target released mid frame can be
+// acquired again by a later pass, which is how the frame graph aliases memory.
+class RenderTargetPool {
+    public:
+        unsigned int acquire(const RenderTargetDesc& desc);
+        void release(unsigned int texture);
+
+        // Returns every target to the pool and deletes the ones unused for a while.
+        // True when something was deleted, since framebuffers built on it are now stale.
+        bool beginFrame();
+
+        size_t getNumTargets() const { return targets.size(); }
+        size_t getAllocatedBytes() const;
+
+    private:
+        struct PooledTarget {
+            RenderTargetDesc desc;
+            TextureHandle texture;
+            size_t size = 0;
+            bool inUse = false;
+            unsigned int lastUsedFrame = 0;
+        };
+
+        std::vector<PooledTarget> targets;
+        unsigned int frameIndex = 0;
+};
+
+typedef unsigned int FrameGraphResource;
+
+class FrameGraph;
+typedef std::function<void(FrameGraph&)> FrameGraphExecute;
+
+struct FrameGraphStats {
+    unsigned int numPasses = 0, culledPasses = 0, mergedPasses = 0;
+    unsigned int numResources = 0, framebufferBinds = 0;
+
+    // What the transient resources would take without aliasing vs what the pool holds
+    size_t requestedBytes = 0, allocatedBytes = 0;
+};
+
+// Passes are declared every frame along with the targets they read and write. compile culls
+// passes whose outputs nobody reads, then walks the survivors in order acquiring each
+// transient target at its first use and releasing it after its last, so targets with
+// disjoint lifetimes share a texture. Writing an imported resource (history buffers, the
+// backbuffer) keeps a pass alive.
+class FrameGraph {
+    public:
+        void reset();
+
+        FrameGraphResource create(const std::string& name, const RenderTargetDesc& desc);
+        // Texture 0 is the default framebuffer
+        FrameGraphResource import(const std::string& name, unsigned int texture, const RenderTargetDesc& desc);
+
+        unsigned int addPass(const std::string& name, const FrameGraphExecute& execute);
+        void read(unsigned int pass, FrameGraphResource resource);
+        // Color attachments follow the order of the writes, depth formats go to the depth attachment
+        void write(unsigned int pass, FrameGraphResource resource);
+
+        void compile();
+        // Binds each pass's framebuffer and runs it. Consecutive passes writing the same
+        // targets share the bind.
+        void execute();
+
+        unsigned int getTexture(FrameGraphResource resource) const { return resources[resource].texture; }
+        // Cached framebuffer with the given textures attached
+        unsigned int getFramebuffer(const std::vector<unsigned int>& textures);
+        // Drops cached framebuffers that have the texture attached. Owners of imported
+        // textures call it before deleting them, since GL can hand the name out again.
+        void invalidate(unsigned int texture);
+
+        const FrameGraphStats& getStats() const { return stats; }
+
+    private:
+        struct ResourceNode {
+            std::string name;
+            RenderTargetDesc desc;
+            unsigned int texture = 0;
+            bool imported = false;
+
+            unsigned int refCount = 0;
+            int lastUse = -1;
+        };
+
+        struct PassNode {
+            std::string name;
+            FrameGraphExecute execute;
+            std::vector<FrameGraphResource> reads, writes;
+
+            unsigned int refCount = 0;
+            bool hasSideEffects = false;
+            bool culled = false;
+        };
+
+        std::vector<ResourceNode> resources;
+        std::vector<PassNode> passes;
+
+        struct ImportedTarget {
+            unsigned int texture = 0;
+            RenderTargetDesc desc;
+        };
+
+        // What each import looked like last frame, a change means it was recreated
+        std::map<std::string, ImportedTarget> imports;
+
+        RenderTargetPool pool;
+        std::map<std::vector<unsigned int>, FramebufferHandle> framebuffers;
+        FrameGraphStats stats;
+
+        void cullPasses();
+        void assignTargets();
+        void bindPassTargets(const PassNode& pass, const std::vector<unsigned int>& attachments);
+};
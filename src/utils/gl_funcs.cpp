@@ -1,4 +1,6 @@
 #include "gl_funcs.h"
+#include "gl_resources.h"
+#include "gl_state.h"
 #include "stb_image.h"
 
 #include <glad/glad.h>
@@ -175,6 +177,7 @@ namespace glutil {
         glTextureStorage3D(textureID, 6, storageFormat, width, height, depth);
         glTextureSubImage3D(textureID, 0, 0, 0, 0, width, height, depth, GL_RGBA, GL_FLOAT, &someBuffer[0]);
         glGenerateTextureMipmap(textureID);
+        ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_3D, storageFormat, width, height, depth, 6);
         
         return textureID;
     }
@@ -193,6 +196,7 @@ namespace glutil {
         glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
         glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
         glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_2D_ARRAY, storageFormat, width, height, size);
 
         return textureID;
     }
@@ -209,6 +213,7 @@ namespace glutil {
         glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         if (levels > 1) glGenerateTextureMipmap(textureID);
+        ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_2D, storageFormat, width, height, 1, levels);
 
         return textureID;
     }
@@ -242,6 +247,7 @@ namespace glutil {
         glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 
         if (levels > 1) glGenerateTextureMipmap(textureID);
+        ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_2D, storageFormat, width, height, 1, levels);
 
         return textureID;
     }
@@ -250,7 +256,7 @@ namespace glutil {
         unsigned int cubemapID;
         
         glGenTextures(1, &cubemapID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapID);
+        GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapID);
 
         if (nrComponents == 0) {
             format = GL_DEPTH_COMPONENT;
@@ -276,6 +282,7 @@ namespace glutil {
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); 
         }
+        ResourceRegistry::get().trackTexture(cubemapID, GL_TEXTURE_CUBE_MAP, storageFormat, width, height, 6);
 
         return cubemapID;
     }
@@ -284,12 +291,12 @@ namespace glutil {
         unsigned int textureID;
         
         glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        GLState::get().bindTexture(0, GL_TEXTURE_CUBE_MAP, textureID);
 
-        int width, height, nrChannels;
+        int width = 0, height = 0, nrChannels;
 
         GLenum format;
-        GLenum storageFormat;
+        GLenum storageFormat = GL_RGB8;
 
         for (int i = 0; i < 6; i++) {
             std::string facePath = path + faces[i];
@@ -322,6 +329,7 @@ namespace glutil {
                 stbi_image_free(data);
             }
         }
+        ResourceRegistry::get().trackTexture(textureID, GL_TEXTURE_CUBE_MAP, storageFormat, width, height, 6, 1, path);
 
         return textureID;
     }
@@ -333,8 +341,10 @@ namespace glutil {
 
         glCreateBuffers(1, &VBO);
         glNamedBufferStorage(VBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        ResourceRegistry::get().trackVertexArray(VAO);
+        ResourceRegistry::get().trackBuffer(VBO, sizeof(float) * vertices.size(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::get().bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
@@ -367,11 +377,14 @@ namespace glutil {
 
         glCreateBuffers(1, &VBO);
         glNamedBufferStorage(VBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        ResourceRegistry::get().trackVertexArray(VAO);
+        ResourceRegistry::get().trackBuffer(VBO, sizeof(float) * vertices.size(), GL_DYNAMIC_STORAGE_BIT);
 
         glCreateBuffers(1, &EBO);
         glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+        ResourceRegistry::get().trackBuffer(EBO, sizeof(unsigned int) * indices.size(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::get().bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
@@ -407,11 +420,14 @@ namespace glutil {
 
         glCreateBuffers(1, &VBO);
         glNamedBufferStorage(VBO, sizeof(Vertex) * vertices.size(), vertices.data(), GL_DYNAMIC_STORAGE_BIT);
+        ResourceRegistry::get().trackVertexArray(VAO);
+        ResourceRegistry::get().trackBuffer(VBO, sizeof(Vertex) * vertices.size(), GL_DYNAMIC_STORAGE_BIT);
 
         glCreateBuffers(1, &EBO);
         glNamedBufferStorage(EBO, sizeof(unsigned int) * indices.size(), indices.data(), GL_DYNAMIC_STORAGE_BIT);
+        ResourceRegistry::get().trackBuffer(EBO, sizeof(unsigned int) * indices.size(), GL_DYNAMIC_STORAGE_BIT);
 
-        glBindVertexArray(VAO);
+        GLState::get().bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
 
         int totalLength = 0;
@@ -443,5 +459,13 @@ namespace glutil {
 
         return newBuffer;
     }
-};
 
+    void destroyBuffer(AllocatedBuffer& buffer) {
+        ResourceRegistry& registry = ResourceRegistry::get();
+        registry.release(RESOURCE_VERTEX_ARRAY, buffer.VAO);
+        registry.release(RESOURCE_BUFFER, buffer.VBO);
+        registry.release(RESOURCE_BUFFER, buffer.EBO);
+
+        buffer = AllocatedBuffer();
+    }
+};
@@ -52,4 +52,7 @@ namespace glutil {
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<VertexType>& endpoints = basicEndpoints);
     AllocatedBuffer loadVertexBuffer(std::vector<float>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
     AllocatedBuffer loadVertexBuffer(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, std::vector<VertexType>& endpoints = basicEndpoints);
+
+    // Hands the VAO and its buffers to the resource registry for deferred deletion
+    void destroyBuffer(AllocatedBuffer& buffer);
 };
\ No newline at end of file
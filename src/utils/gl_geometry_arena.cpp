@@ -0,0 +1,247 @@
+#include "gl_geometry_arena.h"
+#include "gl_resources.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void RangeAllocator::init(size_t newCapacity) {
+    freeRanges.clear();
+    capacity = newCapacity;
+    used = 0;
+    if (capacity > 0) freeRanges[0] = capacity;
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    size_t oldCapacity = capacity;
+    capacity = newCapacity;
+    // Goes through free so a free range at the old end gets merged with the new space
+    used += newCapacity - oldCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+size_t RangeAllocator::allocate(size_t size) {
+    if (size == 0) return 0;
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); it++) {
+        if (it->second < size) continue;
+
+        size_t offset = it->first;
+        size_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0) freeRanges[offset + size] = remaining;
+
+        used += size;
+        return offset;
+    }
+
+    return INVALID_RANGE;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+    if (size == 0) return;
+    used -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+
+    freeRanges[offset] = size;
+}
+
+void GeometryArena::init(const std::vector<VertexType>& endpoints, size_t vertexCapacity, size_t indexCapacity) {
+    vertexStride = sizeof(Vertex);
+
+    glCreateVertexArrays(1, &VAO);
+
+    int currentOffset = 0;
+    for (unsigned int i = 0; i < endpoints.size(); i++) {
+        VertexType type = endpoints[i];
+
+        glEnableVertexArrayAttrib(VAO, i);
+        if (type == VERTEX_ID) {
+            glVertexArrayAttribIFormat(VAO, i, sizes[type], GL_UNSIGNED_INT, currentOffset * sizeof(float));
+        } else {
+            glVertexArrayAttribFormat(VAO, i, sizes[type], GL_FLOAT, GL_FALSE, currentOffset * sizeof(float));
+        }
+        glVertexArrayAttribBinding(VAO, i, 0);
+
+        currentOffset += sizes[type];
+    }
+
+    glCreateBuffers(1, &VBO);
+    glNamedBufferStorage(VBO, vertexCapacity * vertexStride, nullptr, 0);
+    glCreateBuffers(1, &EBO);
+    glNamedBufferStorage(EBO, indexCapacity * sizeof(unsigned int), nullptr, 0);
+
+    glVertexArrayVertexBuffer(VAO, 0, VBO, 0, vertexStride);
+    glVertexArrayElementBuffer(VAO, EBO);
+
+    ResourceRegistry& registry = ResourceRegistry::get();
+    registry.trackVertexArray(VAO, "geometry arena");
+    registry.trackBuffer(VBO, vertexCapacity * vertexStride, 0, "geometry arena vertices");
+    registry.trackBuffer(EBO, indexCapacity * sizeof(unsigned int), 0, "geometry arena indices");
+
+    vertexRanges.init(vertexCapacity);
+    indexRanges.init(indexCapacity);
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &stagingBuffer);
+    glNamedBufferStorage(stagingBuffer, GEOMETRY_STAGING_SIZE, nullptr, flags);
+    stagingData = (unsigned char*) glMapNamedBufferRange(stagingBuffer, 0, GEOMETRY_STAGING_SIZE, flags);
+    registry.trackBuffer(stagingBuffer, GEOMETRY_STAGING_SIZE, flags, "geometry staging");
+
+    if (stagingData == nullptr) {
+        std::cout << "ERROR::GEOMETRY_ARENA::STAGING_NOT_MAPPED" << std::endl;
+    }
+}
+
+GeometryAllocation GeometryArena::allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+    GeometryAllocation allocation;
+
+    size_t baseVertex = vertexRanges.allocate(vertices.size());
+    if (baseVertex == INVALID_RANGE) {
+        growVertices(vertexRanges.getCapacity() + vertices.size());
+        baseVertex = vertexRanges.allocate(vertices.size());
+    }
+
+    size_t firstIndex = indexRanges.allocate(indices.size());
+    if (firstIndex == INVALID_RANGE) {
+        growIndices(indexRanges.getCapacity() + indices.size());
+        firstIndex = indexRanges.allocate(indices.size());
+    }
+
+    allocation.baseVertex = baseVertex;
+    allocation.vertexCount = vertices.size();
+    allocation.firstIndex = firstIndex;
+    allocation.indexCount = indices.size();
+    allocation.isAllocated = true;
+
+    stage(STAGE_VERTICES, baseVertex * vertexStride, vertices.data(), vertices.size() * vertexStride);
+    stage(STAGE_INDICES, firstIndex * sizeof(unsigned int), indices.data(), indices.size() * sizeof(unsigned int));
+
+    return allocation;
+}
+
+void GeometryArena::free(GeometryAllocation& allocation) {
+    if (!allocation.isAllocated) return;
+
+    vertexRanges.free(allocation.baseVertex, allocation.vertexCount);
+    indexRanges.free(allocation.firstIndex, allocation.indexCount);
+    allocation = GeometryAllocation();
+}
+
+void GeometryArena::stage(StagingTarget target, size_t dstOffset, const void* data, size_t size) {
+    if (stagingData == nullptr) return;
+
+    const unsigned char* source = (const unsigned char*) data;
+    while (size > 0) {
+        if (stagingOffset == GEOMETRY_STAGING_SIZE) flushUploads();
+        if (stagingOffset == 0) waitForStaging();
+
+        size_t chunk = std::min(size, (size_t) GEOMETRY_STAGING_SIZE - stagingOffset);
+        std::memcpy(stagingData + stagingOffset, source, chunk);
+        GLState::get().recordUpload(chunk);
+
+        PendingCopy copy;
+        copy.target = target;
+        copy.srcOffset = stagingOffset;
+        copy.dstOffset = dstOffset;
+        copy.size = chunk;
+        pendingCopies.push_back(copy);
+
+        stagingOffset += chunk;
+        source += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+void GeometryArena::flushUploads() {
+    if (pendingCopies.empty()) return;
+
+    for (PendingCopy& copy : pendingCopies) {
+        unsigned int destination = copy.target == STAGE_VERTICES ? VBO : EBO;
+        glCopyNamedBufferSubData(stagingBuffer, destination, copy.srcOffset, copy.dstOffset, copy.size);
+    }
+    pendingCopies.clear();
+
+    // The staging memory can only be rewritten once these copies have executed
+    if (stagingFence != nullptr) glDeleteSync(stagingFence);
+    stagingFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stagingOffset = 0;
+}
+
+void GeometryArena::waitForStaging() {
+    if (stagingFence == nullptr) return;
+
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+        GLenum result = glClientWaitSync(stagingFence, waitFlags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+        if (result == GL_WAIT_FAILED) {
+            std::cout << "ERROR::GEOMETRY_ARENA::FENCE_WAIT_FAILED" << std::endl;
+            break;
+        }
+        waitFlags = 0;
+    }
+
+    glDeleteSync(stagingFence);
+    stagingFence = nullptr;
+}
+
+void GeometryArena::growVertices(size_t minCapacity) {
+    size_t oldCapacity = vertexRanges.getCapacity();
+    size_t newCapacity = std::max(minCapacity, oldCapacity * 2);
+
+    VBO = resizeBuffer(VBO, oldCapacity * vertexStride, newCapacity * vertexStride);
+    glVertexArrayVertexBuffer(VAO, 0, VBO, 0, vertexStride);
+    vertexRanges.grow(newCapacity);
+}
+
+void GeometryArena::growIndices(size_t minCapacity) {
+    size_t oldCapacity = indexRanges.getCapacity();
+    size_t newCapacity = std::max(minCapacity, oldCapacity * 2);
+
+    EBO = resizeBuffer(EBO, oldCapacity * sizeof(unsigned int), newCapacity * sizeof(unsigned int));
+    glVertexArrayElementBuffer(VAO, EBO);
+    indexRanges.grow(newCapacity);
+}
+
+// Pending staged copies resolve the buffer at flush time, so they land in the new one
+unsigned int GeometryArena::resizeBuffer(unsigned int buffer, size_t oldSize, size_t newSize) {
+    unsigned int newBuffer;
+    glCreateBuffers(1, &newBuffer);
+    glNamedBufferStorage(newBuffer, newSize, nullptr, 0);
+
+    if (oldSize > 0) glCopyNamedBufferSubData(buffer, newBuffer, 0, 0, oldSize);
+
+    ResourceRegistry& registry = ResourceRegistry::get();
+    registry.trackBuffer(newBuffer, newSize, 0, buffer == VBO ? "geometry arena vertices" : "geometry arena indices");
+    registry.release(RESOURCE_BUFFER, buffer);
+
+    return newBuffer;
+}
+
+GeometryArenaStats GeometryArena::getStats() const {
+    GeometryArenaStats stats;
+    stats.verticesUsed = vertexRanges.getUsed();
+    stats.vertexCapacity = vertexRanges.getCapacity();
+    stats.indicesUsed = indexRanges.getUsed();
+    stats.indexCapacity = indexRanges.getCapacity();
+    stats.freeRanges = vertexRanges.getNumFreeRanges() + indexRanges.getNumFreeRanges();
+    return stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <map>
+#include <vector>
+
+#include "utils/gl_types.h"
+#include "utils/gl_funcs.h"
+
+#define INVALID_RANGE ((size_t) -1)
+#define GEOMETRY_STAGING_SIZE (16 * 1024 * 1024)
+
+// First fit free list over [0, capacity), neighbours are merged on free
+class RangeAllocator {
+    public:
+        void init(size_t capacity);
+        void grow(size_t newCapacity);
+
+        size_t allocate(size_t size);
+        void free(size_t offset, size_t size);
+
+        size_t getCapacity() const { return capacity; }
+        size_t getUsed() const { return used; }
+        size_t getNumFreeRanges() const { return freeRanges.size(); }
+
+    private:
+        std::map<size_t, size_t> freeRanges;
+        size_t capacity = 0;
+        size_t used = 0;
+};
+
+struct GeometryArenaStats {
+    size_t verticesUsed = 0, vertexCapacity = 0;
+    size_t indicesUsed = 0, indexCapacity = 0;
+    size_t freeRanges = 0;
+};
+
+// One vertex buffer, one index buffer and one VAO shared by every mesh of a vertex format.
+// Meshes only keep their offsets, so any of them can be drawn (or multi-drawn) without a VAO switch.
+class GeometryArena {
+    public:
+        void init(const std::vector<VertexType>& endpoints, size_t vertexCapacity, size_t indexCapacity);
+
+        // Reserves space and stages the data, nothing reaches the GPU buffers until flushUploads
+        GeometryAllocation allocate(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+        void free(GeometryAllocation& allocation);
+
+        // Copies every staged range from the staging buffer into the arena buffers
+        void flushUploads();
+
+        unsigned int getVAO() const { return VAO; }
+        unsigned int getVertexBuffer() const { return VBO; }
+        unsigned int getIndexBuffer() const { return EBO; }
+        GeometryArenaStats getStats() const;
+
+    private:
+        enum StagingTarget { STAGE_VERTICES, STAGE_INDICES };
+        struct PendingCopy {
+            StagingTarget target;
+            size_t srcOffset, dstOffset, size;
+        };
+
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        size_t vertexStride = 0;
+        RangeAllocator vertexRanges, indexRanges;
+
+        unsigned int stagingBuffer = 0;
+        unsigned char* stagingData = nullptr;
+        size_t stagingOffset = 0;
+        GLsync stagingFence = nullptr;
+        std::vector<PendingCopy> pendingCopies;
+
+        void stage(StagingTarget target, size_t dstOffset, const void* data, size_t size);
+        void waitForStaging();
+        void growVertices(size_t minCapacity);
+        void growIndices(size_t minCapacity);
+        unsigned int resizeBuffer(unsigned int buffer, size_t oldSize, size_t newSize);
+};
@@ -0,0 +1,175 @@
+#include "gl_gpu_scene.h"
+#include "gl_state.h"
+#include "gl_shader_manager.h"
+
+#include <algorithm>
+#include <iterator>
+#include <glm/gtc/matrix_access.hpp>
+
+void GPUScene::init(GeometryArena* arena) {
+    geometryArena = arena;
+    // Linked by the owner's ShaderManager::finish
+    ShaderManager::get().load(cullCompute, "indirect/cull.comp");
+
+    countBuffer = glutil::createBuffer(sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY, "draw count");
+}
+
+void GPUScene::sync(std::vector<Model>& objs) {
+    stats.recordsUploaded = 0;
+    syncIndex++;
+
+    for (Model& model : objs) {
+        if (model.id == 0) continue;
+
+        auto it = sceneModels.find(model.id);
+        if (it == sceneModels.end()) {
+            addModel(model);
+        } else {
+            updateTransforms(model, it->second);
+            it->second.lastSync = syncIndex;
+        }
+    }
+
+    for (auto it = sceneModels.begin(); it != sceneModels.end();) {
+        if (it->second.lastSync == syncIndex) {
+            ++it;
+            continue;
+        }
+        retireModel(it->second);
+        it = sceneModels.erase(it);
+    }
+
+    // Free slots at the end come off, so the cull pass stops going over them
+    while (!freeRecords.empty() && *freeRecords.rbegin() == records.size() - 1) {
+        freeRecords.erase(std::prev(freeRecords.end()));
+        records.pop_back();
+    }
+
+    uploadRecords();
+    stats.numRecords = records.size();
+}
+
+unsigned int GPUScene::allocateRecord() {
+    if (freeRecords.empty()) {
+        records.push_back(GPUDrawRecord());
+        return records.size() - 1;
+    }
+
+    unsigned int record = *freeRecords.begin();
+    freeRecords.erase(freeRecords.begin());
+    return record;
+}
+
+void GPUScene::addModel(Model& model) {
+    SceneModel& sceneModel = sceneModels[model.id];
+    sceneModel.lastMatrix = model.model_matrix;
+    sceneModel.lastSync = syncIndex;
+
+    for (Mesh& mesh : model.meshes) {
+        unsigned int slot = allocateRecord();
+        GPUDrawRecord& record = records[slot];
+        record.modelMatrix = mesh.model_matrix * model.model_matrix;
+        record.boundsMin = mesh.aabb.minPoint;
+        record.boundsMax = mesh.aabb.maxPoint;
+        record.materialID = model.materials_loaded[mesh.materialIndex].materialID;
+        record.indexCount = mesh.geometry.indexCount;
+        record.firstIndex = mesh.geometry.firstIndex;
+        record.baseVertex = mesh.geometry.baseVertex;
+
+        sceneModel.records.push_back(slot);
+        markDirty(slot);
+    }
+}
+
+void GPUScene::retireModel(const SceneModel& sceneModel) {
+    for (unsigned int slot : sceneModel.records) {
+        records[slot].indexCount = 0;
+        freeRecords.insert(slot);
+        markDirty(slot);
+    }
+}
+
+void GPUScene::updateTransforms(Model& model, SceneModel& sceneModel) {
+    if (model.model_matrix == sceneModel.lastMatrix) return;
+
+    for (size_t i = 0; i < sceneModel.records.size(); i++) {
+        unsigned int slot = sceneModel.records[i];
+        records[slot].modelMatrix = model.meshes[i].model_matrix * model.model_matrix;
+        markDirty(slot);
+    }
+    sceneModel.lastMatrix = model.model_matrix;
+}
+
+void GPUScene::markDirty(unsigned int record) {
+    if (isDirty.size() <= record) isDirty.resize(record + 1, false);
+    if (isDirty[record]) return;
+
+    isDirty[record] = true;
+    dirtyRecords.push_back(record);
+}
+
+void GPUScene::uploadRecords() {
+    if (records.size() > recordCapacity) {
+        recordCapacity = std::max(records.size(), recordCapacity * 2);
+        recordBuffer = glutil::createBuffer(recordCapacity * sizeof(GPUDrawRecord), nullptr, GL_DYNAMIC_DRAW, "draw records");
+        commandBuffer = glutil::createBuffer(recordCapacity * sizeof(IndirectCommandData), nullptr, GL_DYNAMIC_COPY, "draw commands");
+
+        for (unsigned int i = 0; i < records.size(); i++) markDirty(i);
+    }
+
+    // One upload per run of neighbouring records, trimmed slots are skipped
+    std::sort(dirtyRecords.begin(), dirtyRecords.end());
+    for (size_t i = 0; i < dirtyRecords.size();) {
+        size_t begin = dirtyRecords[i];
+        size_t end = begin + 1;
+        for (i++; i < dirtyRecords.size() && dirtyRecords[i] == end; i++) end++;
+
+        end = std::min(end, records.size());
+        if (begin >= end) continue;
+
+        glNamedBufferSubData(recordBuffer, begin * sizeof(GPUDrawRecord), (end - begin) * sizeof(GPUDrawRecord), &records[begin]);
+        GLState::get().recordUpload((end - begin) * sizeof(GPUDrawRecord));
+        stats.recordsUploaded += end - begin;
+    }
+    for (unsigned int record : dirtyRecords) isDirty[record] = false;
+    dirtyRecords.clear();
+}
+
+void GPUScene::cull(const glm::mat4& viewProjection) {
+    if (records.empty()) return;
+
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) rows[i] = glm::row(viewProjection, i);
+
+    glm::vec4 planes[6] = {
+        rows[3] + rows[0], rows[3] - rows[0],
+        rows[3] + rows[1], rows[3] - rows[1],
+        rows[3] + rows[2], rows[3] - rows[2]
+    };
+
+    cullCompute.use();
+    cullCompute.setInt("numRecords"_u, records.size());
+    for (int i = 0; i < 6; i++) {
+        cullCompute.setVec4(uniformArray("frustumPlanes", i), planes[i] / glm::length(glm::vec3(planes[i])));
+    }
+
+    glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_RECORD_BINDING, recordBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_COMMAND_BINDING, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_COUNT_BINDING, countBuffer);
+
+    glDispatchCompute((records.size() + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GPUScene::draw() {
+    if (records.empty()) return;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_RECORD_BINDING, recordBuffer);
+    GLState::get().bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    GLState::get().bindBuffer(GL_PARAMETER_BUFFER, countBuffer);
+
+    GLState::get().bindVertexArray(geometryArena->getVAO());
+    glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, 0, 0, records.size(), sizeof(IndirectCommandData));
+    GLState::get().recordDraw();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/gl_compute.h"
+#include "utils/gl_model.h"
+#include "utils/gl_geometry_arena.h"
+#include "utils/gl_resources.h"
+
+#define DRAW_RECORD_BINDING 8
+#define DRAW_COMMAND_BINDING 9
+#define DRAW_COUNT_BINDING 10
+
+struct IndirectCommandData {
+    unsigned int indexCount;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance = 0;
+};
+
+// std430 record for every mesh in the scene, read by the cull pass and through gl_BaseInstance
+// in the vertex shader. Bounds are in mesh space.
+struct GPUDrawRecord {
+    glm::mat4 modelMatrix;
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    unsigned int materialID;
+    // Zero for removed models so the cull pass skips them
+    unsigned int indexCount;
+    unsigned int firstIndex;
+    int baseVertex;
+};
+static_assert(sizeof(GPUDrawRecord) == 112, "GPUDrawRecord must match the std430 DrawRecord struct");
+
+struct GPUSceneStats {
+    unsigned int numRecords = 0;
+    unsigned int recordsUploaded = 0;
+};
+
+// Keeps a per draw record for every mesh of every model, with the geometry itself living in the
+// engine's arena, so a frame is one cull dispatch plus one glMultiDrawElementsIndirectCount
+// no matter how many objects exist.
+class GPUScene {
+    public:
+        void init(GeometryArena* arena);
+
+        // Adds models that were imported since the last call, retires ones that are gone and
+        // re-uploads only the records whose transforms changed. Models are matched by Model::id,
+        // so removing one from the middle of objs leaves the others' records alone.
+        void sync(std::vector<Model>& objs);
+
+        // Frustum culls every record on the GPU and compacts the visible commands
+        void cull(const glm::mat4& viewProjection);
+        void draw();
+
+        const GPUSceneStats& getStats() const { return stats; }
+
+    private:
+        struct SceneModel {
+            // One record slot per mesh, wherever the free list had room
+            std::vector<unsigned int> records;
+            glm::mat4 lastMatrix;
+            unsigned int lastSync = 0;
+        };
+
+        std::unordered_map<unsigned int, SceneModel> sceneModels;
+        std::vector<GPUDrawRecord> records;
+        // Retired slots, lowest first so the live records stay packed at the front
+        std::set<unsigned int> freeRecords;
+        unsigned int syncIndex = 0;
+
+        GeometryArena* geometryArena = nullptr;
+
+        BufferHandle recordBuffer, commandBuffer, countBuffer;
+        size_t recordCapacity = 0;
+        std::vector<unsigned int> dirtyRecords;
+        std::vector<bool> isDirty;
+
+        ComputeShader cullCompute;
+        GPUSceneStats stats;
+
+        void addModel(Model& model);
+        void retireModel(const SceneModel& sceneModel);
+        void updateTransforms(Model& model, SceneModel& sceneModel);
+
+        unsigned int allocateRecord();
+        void uploadRecords();
+        void markDirty(unsigned int record);
+};
@@ -0,0 +1,31 @@
+#include "gl_gpu_timer.h"
+
+void GPUTimer::begin() {
+    if (queries[0][0] == 0) glCreateQueries(GL_TIMESTAMP, GPU_TIMER_FRAMES * 2, &queries[0][0]);
+
+    collect();
+    glQueryCounter(queries[current][0], GL_TIMESTAMP);
+}
+
+void GPUTimer::end() {
+    if (queries[0][0] == 0) return;
+
+    glQueryCounter(queries[current][1], GL_TIMESTAMP);
+    pending[current] = true;
+    current = (current + 1) % GPU_TIMER_FRAMES;
+}
+
+// The slot about to be reused is the oldest one, resolve it if the GPU got there
+void GPUTimer::collect() {
+    if (!pending[current]) return;
+
+    GLint available = 0;
+    glGetQueryObjectiv(queries[current][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available) {
+        GLuint64 start, stop;
+        glGetQueryObjectui64v(queries[current][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[current][1], GL_QUERY_RESULT, &stop);
+        milliseconds = (stop - start) / 1000000.0f;
+    }
+    pending[current] = false;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Enough frames in flight that reading the oldest pair never waits on the GPU
+#define GPU_TIMER_FRAMES 4
+
+// Measures the GPU time between begin and end with timestamp queries, so timers can be
+// nested or overlap. Results arrive a few frames late.
+class GPUTimer {
+    public:
+        void begin();
+        void end();
+
+        // Latest resolved measurement, zero until the first one is available
+        float getMilliseconds() const { return milliseconds; }
+
+    private:
+        unsigned int queries[GPU_TIMER_FRAMES][2] = {};
+        bool pending[GPU_TIMER_FRAMES] = {};
+        int current = 0;
+        float milliseconds = 0.0f;
+
+        void collect();
+};
@@ -0,0 +1,25 @@
+#include "gl_instancing.h"
+#include "gl_state.h"
+
+#include <algorithm>
+
+void InstanceBuffer::upload(const InstanceData* instances, size_t numInstances) {
+    count = numInstances;
+    if (count == 0) return;
+
+    if (count > capacity) {
+        capacity = std::max(count, capacity * 2);
+        buffer = glutil::createBuffer(capacity * sizeof(InstanceData), nullptr, GL_STREAM_DRAW, "instances");
+    } else {
+        // Lets the driver hand out new storage instead of waiting on draws still reading the old data
+        glInvalidateBufferData(buffer);
+    }
+
+    glNamedBufferSubData(buffer, 0, count * sizeof(InstanceData), instances);
+    GLState::get().recordUpload(count * sizeof(InstanceData));
+    bind();
+}
+
+void InstanceBuffer::bind() {
+    if (buffer != 0) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BUFFER_BINDING, buffer);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "utils/gl_resources.h"
+
+#define INSTANCE_BUFFER_BINDING 11
+
+// std430 layout of the InstanceBlock shaders read with gl_InstanceID
+struct InstanceData {
+    glm::mat4 modelMatrix;
+    glm::vec4 color;
+};
+
+class InstanceBuffer {
+    public:
+        // Replaces the contents and binds the buffer at INSTANCE_BUFFER_BINDING, growing it when needed
+        void upload(const std::vector<InstanceData>& instances) { upload(instances.data(), instances.size()); }
+        void upload(const InstanceData* instances, size_t numInstances);
+        void bind();
+
+        size_t size() const { return count; }
+
+    private:
+        BufferHandle buffer;
+        size_t capacity = 0;
+        size_t count = 0;
+};
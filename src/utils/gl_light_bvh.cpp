@@ -0,0 +1,193 @@
+#include "gl_light_bvh.h"
+#include "gl_shader_manager.h"
+#include "gl_state.h"
+
+#include <algorithm>
+
+#define SORT_LOCAL 0
+#define SORT_GLOBAL_STEP 1
+#define SORT_LOCAL_MERGE 2
+
+void LightBVH::init(unsigned int clusterCount) {
+    numClusters = clusterCount;
+
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(keysCompute, "clustered/lightKeys.comp");
+    shaders.load(sortCompute, "clustered/bitonicSort.comp");
+    shaders.load(buildCompute, "clustered/lightBVH.comp");
+    shaders.load(markCompute, "clustered/markClusters.comp");
+    shaders.load(compactCompute, "clustered/compactClusters.comp");
+    shaders.load(cullCompute, "clustered/bvhCull.comp");
+
+    activeClusterBuffer = glutil::createBuffer(numClusters * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY, "active clusters");
+    glClearNamedBufferData(activeClusterBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    // Indirect dispatch and active count in front of the list
+    activeClusterListBuffer = glutil::createBuffer((4 + numClusters) * sizeof(unsigned int), nullptr, GL_DYNAMIC_COPY, "active cluster list");
+
+    reserve(LIGHT_SORT_BLOCK_SIZE);
+}
+
+void LightBVH::reserve(unsigned int numLights) {
+    if (numLights <= capacity) return;
+
+    // The sort needs a power of two and at least one full block
+    unsigned int newCapacity = LIGHT_SORT_BLOCK_SIZE;
+    while (newCapacity < numLights) newCapacity *= 2;
+    capacity = newCapacity;
+
+    // Leaves plus every level above them, each a BVH_BRANCHING-th of the one below
+    unsigned int maxNodes = (capacity / LIGHT_BVH_BRANCHING) * 2 + LIGHT_BVH_MAX_LEVELS;
+
+    keyBuffer = glutil::createBuffer(capacity * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_COPY, "light keys");
+    sphereBuffer = glutil::createBuffer(capacity * sizeof(glm::vec4), nullptr, GL_DYNAMIC_COPY, "light spheres");
+    nodeBuffer = glutil::createBuffer(maxNodes * 2 * sizeof(glm::vec4), nullptr, GL_DYNAMIC_COPY, "light BVH");
+    stats.lightCapacity = capacity;
+}
+
+void LightBVH::bindBuffers() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_KEY_BINDING, keyBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_SPHERE_BINDING, sphereBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BVH_BINDING, nodeBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_CLUSTER_BINDING, activeClusterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ACTIVE_CLUSTER_LIST_BINDING, activeClusterListBuffer);
+}
+
+void LightBVH::build(unsigned int numLights, const glm::mat4& view, const glm::mat4& inverseProjection, float zFar) {
+    reserve(numLights);
+    bindBuffers();
+
+    unsigned int numKeys = LIGHT_SORT_BLOCK_SIZE;
+    while (numKeys < numLights) numKeys *= 2;
+
+    stats.numLights = numLights;
+    stats.numKeys = numKeys;
+    stats.numLevels = 0;
+    stats.numNodes = 0;
+    stats.sortDispatches = 0;
+    if (numLights == 0) return;
+
+    // View space box around the frustum out to zFar, lights outside it share codes with its faces
+    glm::vec3 boundsMin(0.0f), boundsMax(0.0f);
+    for (int i = 0; i < 4; i++) {
+        glm::vec4 corner = inverseProjection * glm::vec4(i % 2 == 0 ? -1.0f : 1.0f, i < 2 ? -1.0f : 1.0f, 1.0f, 1.0f);
+        glm::vec3 farCorner = glm::vec3(corner / corner.w);
+        farCorner *= zFar / -farCorner.z;
+
+        boundsMin = glm::min(boundsMin, farCorner);
+        boundsMax = glm::max(boundsMax, farCorner);
+    }
+
+    keysCompute.use();
+    keysCompute.setMat4("view"_u, view);
+    keysCompute.setInt("numLights"_u, numLights);
+    keysCompute.setInt("numKeys"_u, numKeys);
+    keysCompute.setVec3("boundsMin"_u, boundsMin);
+    keysCompute.setVec3("boundsMax"_u, boundsMax);
+    glDispatchCompute((numKeys + 255) / 256, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    sortKeys(numKeys);
+
+    unsigned int count = (numLights + LIGHT_BVH_BRANCHING - 1) / LIGHT_BVH_BRANCHING;
+    unsigned int offset = 0;
+    unsigned int numLevels = 0;
+    while (true) {
+        levelOffsets[numLevels] = offset;
+        levelCounts[numLevels] = count;
+        offset += count;
+        numLevels++;
+
+        // The top level is tested whole by every cluster, so it has to fit in one mask
+        if (count <= LIGHT_BVH_BRANCHING || numLevels == LIGHT_BVH_MAX_LEVELS) break;
+        count = (count + LIGHT_BVH_BRANCHING - 1) / LIGHT_BVH_BRANCHING;
+    }
+    stats.numLevels = numLevels;
+    stats.numNodes = offset;
+
+    buildCompute.use();
+    buildCompute.setInt("numLights"_u, numLights);
+    for (unsigned int level = 0; level < numLevels; level++) {
+        buildCompute.setInt("level"_u, level);
+        buildCompute.setInt("nodeOffset"_u, levelOffsets[level]);
+        buildCompute.setInt("nodeCount"_u, levelCounts[level]);
+        buildCompute.setInt("childOffset"_u, level > 0 ? levelOffsets[level - 1] : 0);
+        buildCompute.setInt("childCount"_u, level > 0 ? levelCounts[level - 1] : 0);
+        glDispatchCompute((levelCounts[level] + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+}
+
+// Bitonic sort, blocks of LIGHT_SORT_BLOCK_SIZE sort and finish merging in shared memory and
+// only strides of a block or more go through global memory
+void LightBVH::sortKeys(unsigned int numKeys) {
+    unsigned int numBlocks = numKeys / LIGHT_SORT_BLOCK_SIZE;
+    unsigned int numPairGroups = numKeys / 2 / (LIGHT_SORT_BLOCK_SIZE / 2);
+
+    sortCompute.use();
+    sortCompute.setInt("mode"_u, SORT_LOCAL);
+    glDispatchCompute(numBlocks, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    stats.sortDispatches++;
+
+    for (unsigned int mergeSize = LIGHT_SORT_BLOCK_SIZE * 2; mergeSize <= numKeys; mergeSize *= 2) {
+        sortCompute.setInt("mergeSize"_u, mergeSize);
+
+        sortCompute.setInt("mode"_u, SORT_GLOBAL_STEP);
+        for (unsigned int stride = mergeSize / 2; stride >= LIGHT_SORT_BLOCK_SIZE; stride /= 2) {
+            sortCompute.setInt("stride"_u, stride);
+            glDispatchCompute(numPairGroups, 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            stats.sortDispatches++;
+        }
+
+        sortCompute.setInt("mode"_u, SORT_LOCAL_MERGE);
+        glDispatchCompute(numBlocks, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        stats.sortDispatches++;
+    }
+}
+
+void LightBVH::markClusters(unsigned int depthTexture, int width, int height, float zNear, float zFar, float scale, float bias) {
+    bindBuffers();
+    GLState::get().bindTextureUnit(0, depthTexture);
+
+    markCompute.use();
+    markCompute.setFloat("zNear"_u, zNear);
+    markCompute.setFloat("zFar"_u, zFar);
+    markCompute.setFloat("scale"_u, scale);
+    markCompute.setFloat("bias"_u, bias);
+    glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightBVH::markAllClusters() {
+    unsigned int active = 1;
+    glClearNamedBufferData(activeClusterBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &active);
+}
+
+void LightBVH::cull() {
+    bindBuffers();
+
+    // dispatchX grows as compaction appends clusters
+    unsigned int header[4] = { 0, 1, 1, 0 };
+    glNamedBufferSubData(activeClusterListBuffer, 0, sizeof(header), header);
+    GLState::get().recordUpload(sizeof(header));
+
+    compactCompute.use();
+    compactCompute.setInt("numClusters"_u, numClusters);
+    glDispatchCompute((numClusters + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    cullCompute.use();
+    cullCompute.setInt("numLights"_u, stats.numLights);
+    cullCompute.setInt("numLevels"_u, stats.numLevels);
+    for (unsigned int level = 0; level < stats.numLevels; level++) {
+        cullCompute.setInt(uniformArray("levelOffsets", level), levelOffsets[level]);
+        cullCompute.setInt(uniformArray("levelCounts", level), levelCounts[level]);
+    }
+
+    GLState::get().bindBuffer(GL_DISPATCH_INDIRECT_BUFFER, activeClusterListBuffer);
+    glDispatchComputeIndirect(0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
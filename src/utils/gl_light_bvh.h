@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "utils/gl_compute.h"
+#include "utils/gl_resources.h"
+
+#define LIGHT_KEY_BINDING 12
+#define LIGHT_SPHERE_BINDING 13
+#define LIGHT_BVH_BINDING 14
+#define ACTIVE_CLUSTER_BINDING 15
+#define ACTIVE_CLUSTER_LIST_BINDING 16
+
+// Must match include/light_culling.glsl and bitonicSort.comp
+#define LIGHT_BVH_BRANCHING 32
+#define LIGHT_BVH_MAX_LEVELS 6
+#define LIGHT_CULL_GROUP_SIZE 64
+#define LIGHT_SORT_BLOCK_SIZE 1024
+
+struct LightBVHStats {
+    unsigned int numLights = 0;
+    unsigned int numKeys = 0;
+    unsigned int numLevels = 0;
+    unsigned int numNodes = 0;
+    unsigned int lightCapacity = 0;
+    unsigned int sortDispatches = 0;
+};
+
+// GPU light culling for the clustered engine that scales past a few thousand lights. Each frame
+// the lights get Morton codes from their view space position and are bitonic sorted, then a
+// BVH with LIGHT_BVH_BRANCHING children per node is built bottom up over the sorted order.
+// Clusters marked from a depth pre-pass are compacted into a list and only those traverse the
+// BVH, through an indirect dispatch, writing the same lightGrid/globalLightIndexList as
+// clusterLights.comp. The cluster AABBs from tileCreate.comp have to be current.
+class LightBVH {
+    public:
+        // Queues the shaders on the ShaderManager, the caller finishes the batch
+        void init(unsigned int numClusters);
+
+        // Grows the per light buffers to the next power of two that fits
+        void reserve(unsigned int numLights);
+
+        // Lights are read from the clustered light SSBO at binding 3
+        void build(unsigned int numLights, const glm::mat4& view, const glm::mat4& inverseProjection, float zFar);
+
+        // Flags every cluster a depth texture pixel falls into, same lookup as clustered/pbr.fs
+        void markClusters(unsigned int depthTexture, int width, int height, float zNear, float zFar, float scale, float bias);
+        // Without a depth pre-pass every cluster is culled
+        void markAllClusters();
+
+        // Compacts the marked clusters and traverses the BVH for each of them
+        void cull();
+
+        unsigned int getActiveClusterListBuffer() const { return activeClusterListBuffer; }
+        const LightBVHStats& getStats() const { return stats; }
+
+    private:
+        ComputeShader keysCompute, sortCompute, buildCompute;
+        ComputeShader markCompute, compactCompute, cullCompute;
+
+        BufferHandle keyBuffer, sphereBuffer, nodeBuffer;
+        BufferHandle activeClusterBuffer, activeClusterListBuffer;
+
+        unsigned int numClusters = 0;
+        unsigned int capacity = 0;
+        unsigned int levelOffsets[LIGHT_BVH_MAX_LEVELS] = {};
+        unsigned int levelCounts[LIGHT_BVH_MAX_LEVELS] = {};
+        LightBVHStats stats;
+
+        void sortKeys(unsigned int numKeys);
+        void bindBuffers();
+};
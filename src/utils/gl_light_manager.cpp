@@ -0,0 +1,249 @@
+#include "gl_light_manager.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#define INVALID_SLOT ((unsigned int) -1)
+
+float computeLightRadius(float brightness, const LightAttenuation& attenuation, float cutoff) {
+    if (cutoff <= 0.0f) return MAX_LIGHT_RADIUS;
+
+    // brightness / (constant + linear * d + quadratic * d^2) = cutoff, solved for d
+    float target = brightness / cutoff - attenuation.constant;
+    if (target <= 0.0f) return 0.0f;
+
+    float radius = MAX_LIGHT_RADIUS;
+    if (attenuation.quadratic > 0.0f) {
+        float discriminant = attenuation.linear * attenuation.linear + 4.0f * attenuation.quadratic * target;
+        radius = (-attenuation.linear + std::sqrt(discriminant)) / (2.0f * attenuation.quadratic);
+    } else if (attenuation.linear > 0.0f) {
+        radius = target / attenuation.linear;
+    }
+    return std::min(radius, MAX_LIGHT_RADIUS);
+}
+
+void LightManager::init(unsigned int lightBinding, unsigned int initialCapacity) {
+    binding = lightBinding;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    size_t stagingSize = (size_t) LIGHT_STAGING_SIZE * LIGHT_STAGING_FRAMES;
+    unsigned int buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, stagingSize, nullptr, flags);
+    stagingData = (unsigned char*) glMapNamedBufferRange(buffer, 0, stagingSize, flags);
+    ResourceRegistry::get().trackBuffer(buffer, stagingSize, flags, "light staging");
+    stagingBuffer = BufferHandle(buffer);
+
+    if (stagingData == nullptr) {
+        std::cout << "ERROR::LIGHT_MANAGER::STAGING_NOT_MAPPED" << std::endl;
+    }
+
+    grow(std::max(initialCapacity, 1u));
+}
+
+void LightManager::grow(unsigned int minCapacity) {
+    unsigned int newCapacity = std::max(capacity, 64u);
+    while (newCapacity < minCapacity) newCapacity *= 2;
+
+    // clusterLights.comp walks the whole buffer, so slots without a light have to read as disabled
+    BufferHandle newBuffer = glutil::createBuffer(newCapacity * sizeof(ClusteredLight), nullptr, GL_DYNAMIC_DRAW, "lights");
+    glClearNamedBufferData(newBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    if (lightBuffer != 0 && uploadedCount > 0) {
+        glCopyNamedBufferSubData(lightBuffer, newBuffer, 0, 0, uploadedCount * sizeof(ClusteredLight));
+    }
+
+    lightBuffer = std::move(newBuffer);
+    capacity = newCapacity;
+    isDirty.resize(capacity, false);
+    bind();
+}
+
+void LightManager::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, lightBuffer);
+}
+
+void LightManager::updateRadius(ClusteredLight& light) const {
+    float brightness = std::max(std::max(light.color.r, light.color.g), light.color.b) * light.intensity;
+    light.range = computeLightRadius(brightness, attenuation, cutoff);
+}
+
+void LightManager::markDirty(unsigned int slot) {
+    if (isDirty[slot]) return;
+
+    isDirty[slot] = true;
+    dirtySlots.push_back(slot);
+}
+
+LightID LightManager::addLight(const glm::vec3& position, const glm::vec3& color, float intensity) {
+    if (lights.size() == capacity) grow(capacity + 1);
+
+    LightID id;
+    if (!freeIDs.empty()) {
+        id = freeIDs.back();
+        freeIDs.pop_back();
+    } else {
+        id = slots.size();
+        slots.push_back(INVALID_SLOT);
+    }
+
+    unsigned int slot = lights.size();
+    slots[id] = slot;
+    ids.push_back(id);
+
+    ClusteredLight light = {};
+    light.position = glm::vec4(position, 1.0f);
+    light.color = glm::vec4(color, 1.0f);
+    light.enabled = 1;
+    light.intensity = intensity;
+    updateRadius(light);
+    lights.push_back(light);
+
+    markDirty(slot);
+    return id;
+}
+
+void LightManager::removeLight(LightID id) {
+    if (id >= slots.size() || slots[id] == INVALID_SLOT) return;
+
+    // The last light fills the hole so the buffer stays packed
+    unsigned int slot = slots[id];
+    unsigned int last = lights.size() - 1;
+    if (slot != last) {
+        lights[slot] = lights[last];
+        ids[slot] = ids[last];
+        slots[ids[slot]] = slot;
+        markDirty(slot);
+    }
+
+    lights.pop_back();
+    ids.pop_back();
+    slots[id] = INVALID_SLOT;
+    freeIDs.push_back(id);
+}
+
+void LightManager::moveLight(LightID id, const glm::vec3& position) {
+    unsigned int slot = slots[id];
+    lights[slot].position = glm::vec4(position, 1.0f);
+    markDirty(slot);
+}
+
+void LightManager::setColor(LightID id, const glm::vec3& color, float intensity) {
+    unsigned int slot = slots[id];
+    lights[slot].color = glm::vec4(color, 1.0f);
+    lights[slot].intensity = intensity;
+    updateRadius(lights[slot]);
+    markDirty(slot);
+}
+
+void LightManager::setEnabled(LightID id, bool enabled) {
+    unsigned int slot = slots[id];
+    lights[slot].enabled = enabled ? 1 : 0;
+    markDirty(slot);
+}
+
+void LightManager::clear() {
+    lights.clear();
+    ids.clear();
+    slots.clear();
+    freeIDs.clear();
+}
+
+void LightManager::setAttenuation(const LightAttenuation& newAttenuation, float newCutoff) {
+    attenuation = newAttenuation;
+    cutoff = newCutoff;
+
+    for (unsigned int slot = 0; slot < lights.size(); slot++) {
+        updateRadius(lights[slot]);
+        markDirty(slot);
+    }
+}
+
+bool LightManager::update() {
+    unsigned int count = lights.size();
+    stats.lights = count;
+    stats.capacity = capacity;
+    stats.dirtyLights = 0;
+    stats.uploadRanges = 0;
+    stats.uploadedBytes = 0;
+
+    bool removed = uploadedCount > count;
+    if (dirtySlots.empty() && !removed) return false;
+
+    if (removed) {
+        glClearNamedBufferSubData(lightBuffer, GL_R32UI, count * sizeof(ClusteredLight),
+            (uploadedCount - count) * sizeof(ClusteredLight), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+    uploadedCount = count;
+
+    // Nearby dirty lights go up as one range, slots removed since they were marked are skipped
+    std::sort(dirtySlots.begin(), dirtySlots.end());
+    size_t stagingOffset = 0;
+    size_t i = 0;
+    while (i < dirtySlots.size()) {
+        unsigned int first = dirtySlots[i];
+        unsigned int last = first;
+        isDirty[first] = false;
+
+        while (++i < dirtySlots.size() && dirtySlots[i] <= last + LIGHT_DIRTY_MERGE_GAP + 1) {
+            last = dirtySlots[i];
+            isDirty[last] = false;
+        }
+
+        if (first >= count) continue;
+        last = std::min(last, count - 1);
+        upload(first, last - first + 1, stagingOffset);
+    }
+    stats.dirtyLights = dirtySlots.size();
+    dirtySlots.clear();
+
+    if (stagingOffset > 0) {
+        if (stagingFences[stagingFrame] != nullptr) glDeleteSync(stagingFences[stagingFrame]);
+        stagingFences[stagingFrame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stagingFrame = (stagingFrame + 1) % LIGHT_STAGING_FRAMES;
+    }
+
+    GLState::get().recordUpload(stats.uploadedBytes);
+    return true;
+}
+
+void LightManager::upload(unsigned int first, unsigned int count, size_t& stagingOffset) {
+    size_t size = count * sizeof(ClusteredLight);
+    size_t dstOffset = first * sizeof(ClusteredLight);
+    stats.uploadRanges++;
+    stats.uploadedBytes += size;
+
+    // Regenerating every light can outgrow the ring, those go straight through the driver
+    if (stagingData == nullptr || stagingOffset + size > LIGHT_STAGING_SIZE) {
+        glNamedBufferSubData(lightBuffer, dstOffset, size, &lights[first]);
+        return;
+    }
+
+    if (stagingOffset == 0) waitForStaging(stagingFrame);
+
+    size_t srcOffset = (size_t) stagingFrame * LIGHT_STAGING_SIZE + stagingOffset;
+    std::memcpy(stagingData + srcOffset, &lights[first], size);
+    glCopyNamedBufferSubData(stagingBuffer, lightBuffer, srcOffset, dstOffset, size);
+    stagingOffset += size;
+}
+
+void LightManager::waitForStaging(int frame) {
+    GLsync fence = stagingFences[frame];
+    if (fence == nullptr) return;
+
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true) {
+        GLenum result = glClientWaitSync(fence, waitFlags, 1000000);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+        if (result == GL_WAIT_FAILED) {
+            std::cout << "ERROR::LIGHT_MANAGER::FENCE_WAIT_FAILED" << std::endl;
+            break;
+        }
+        waitFlags = 0;
+    }
+
+    glDeleteSync(fence);
+    stagingFences[frame] = nullptr;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "utils/cluster_culling.h"
+#include "utils/gl_resources.h"
+
+#define INVALID_LIGHT ((LightID) -1)
+// Staging ring split per frame in flight, each part fenced like the geometry arena's staging
+#define LIGHT_STAGING_FRAMES 3
+#define LIGHT_STAGING_SIZE (1024 * 1024)
+// Clean lights between two dirty ones that still get uploaded to save a copy
+#define LIGHT_DIRTY_MERGE_GAP 8
+// Radius used when the attenuation never falls off
+#define MAX_LIGHT_RADIUS 1000.0f
+
+typedef unsigned int LightID;
+
+// Falloff 1 / (constant + linear * d + quadratic * d^2), the shaders reading the manager's
+// buffer get it as a uniform
+struct LightAttenuation {
+    float constant = 1.0f;
+    float linear = 0.0f;
+    float quadratic = 1.0f;
+};
+
+// Distance at which brightness * attenuation falls to cutoff
+float computeLightRadius(float brightness, const LightAttenuation& attenuation, float cutoff);
+
+struct LightManagerStats {
+    unsigned int lights = 0;
+    unsigned int capacity = 0;
+    // Last update
+    unsigned int dirtyLights = 0;
+    unsigned int uploadRanges = 0;
+    size_t uploadedBytes = 0;
+};
+
+// Owns the point lights of an engine and the SSBO they live in. Lights stay packed at the
+// front of the buffer, removing one moves the last into its slot, so IDs are handed out to
+// stay valid across removals. Changes only mark lights dirty, update copies the dirty ranges
+// through a persistently mapped staging buffer, and the range of every light is derived from
+// its brightness and the shared attenuation so culling and shading agree on it.
+class LightManager {
+    public:
+        void init(unsigned int binding, unsigned int initialCapacity = 1024);
+
+        LightID addLight(const glm::vec3& position, const glm::vec3& color, float intensity = 1.0f);
+        void removeLight(LightID id);
+        void moveLight(LightID id, const glm::vec3& position);
+        void setColor(LightID id, const glm::vec3& color, float intensity);
+        void setEnabled(LightID id, bool enabled);
+        void clear();
+
+        // Recomputes every radius, cutoff is the brightness a light stops contributing at
+        void setAttenuation(const LightAttenuation& attenuation, float cutoff);
+        const LightAttenuation& getAttenuation() const { return attenuation; }
+        float getCutoff() const { return cutoff; }
+
+        // Uploads what changed since the last call, true if anything did
+        bool update();
+        // Other passes can take the binding over, so users rebind before reading the lights
+        void bind() const;
+
+        const ClusteredLight& getLight(LightID id) const { return lights[slots[id]]; }
+        const ClusteredLight* data() const { return lights.data(); }
+        unsigned int size() const { return lights.size(); }
+        unsigned int getCapacity() const { return capacity; }
+        unsigned int getBuffer() const { return lightBuffer; }
+        const LightManagerStats& getStats() const { return stats; }
+
+    private:
+        unsigned int binding = 0;
+        unsigned int capacity = 0;
+
+        std::vector<ClusteredLight> lights;
+        // Slot of each ID and ID of each slot
+        std::vector<unsigned int> slots;
+        std::vector<LightID> ids;
+        std::vector<LightID> freeIDs;
+
+        LightAttenuation attenuation;
+        float cutoff = 5.0f / 256.0f;
+
+        // Lights in the GPU buffer as of the last update, slots past size() up to it get cleared
+        unsigned int uploadedCount = 0;
+        std::vector<unsigned int> dirtySlots;
+        std::vector<bool> isDirty;
+
+        BufferHandle lightBuffer;
+        BufferHandle stagingBuffer;
+        unsigned char* stagingData = nullptr;
+        GLsync stagingFences[LIGHT_STAGING_FRAMES] = {};
+        int stagingFrame = 0;
+
+        LightManagerStats stats;
+
+        void markDirty(unsigned int slot);
+        void updateRadius(ClusteredLight& light) const;
+        void grow(unsigned int minCapacity);
+        // Copies count lights from slot first, through the staging ring while it has room
+        void upload(unsigned int first, unsigned int count, size_t& stagingOffset);
+        void waitForStaging(int frame);
+};
@@ -0,0 +1,181 @@
+#include "gl_material_buffer.h"
+#include "gl_state.h"
+
+#include <algorithm>
+
+void MaterialBuffer::compile(std::vector<Material>& materials) {
+	for (Material& material : materials) {
+		if (material.materialID != INVALID_MATERIAL_ID) continue;
+
+		material.updateTextureMask();
+
+		GPUMaterial gpuMaterial = {};
+		gpuMaterial.params = material.params;
+
+		for (Texture& texture : material.textures) {
+			int slot = getMaterialTextureSlot(texture.type);
+			if (slot == -1 || gpuMaterial.textureHandles[slot] != 0) continue;
+
+			gpuMaterial.textureHandles[slot] = acquireTexture(texture);
+		}
+
+		if (!freeMaterials.empty()) {
+			material.materialID = freeMaterials.back();
+			freeMaterials.pop_back();
+			gpuMaterials[material.materialID] = gpuMaterial;
+		} else {
+			material.materialID = gpuMaterials.size();
+			gpuMaterials.push_back(gpuMaterial);
+		}
+		markDirty(material.materialID);
+	}
+}
+
+void MaterialBuffer::release(std::vector<Material>& materials) {
+	for (Material& material : materials) {
+		if (material.materialID == INVALID_MATERIAL_ID || material.materialID >= gpuMaterials.size()) continue;
+
+		// Same slots compile filled, each texture was acquired once per slot
+		GPUMaterial& gpuMaterial = gpuMaterials[material.materialID];
+		for (Texture& texture : material.textures) {
+			int slot = getMaterialTextureSlot(texture.type);
+			if (slot == -1 || gpuMaterial.textureHandles[slot] == 0) continue;
+
+			releaseTexture(texture.id);
+			gpuMaterial.textureHandles[slot] = 0;
+		}
+
+		freeMaterials.push_back(material.materialID);
+		material.materialID = INVALID_MATERIAL_ID;
+	}
+}
+
+GLuint64 MaterialBuffer::acquireTexture(const Texture& texture) {
+	TextureRef& ref = textureRefs[texture.id];
+	if (ref.users++ > 0) return ref.handle;
+
+	if (GLAD_GL_ARB_bindless_texture) {
+		ref.handle = glGetTextureHandleARB(texture.id);
+		if (!glIsTextureHandleResidentARB(ref.handle)) glMakeTextureHandleResidentARB(ref.handle);
+	} else {
+		unsigned int slice = allocateSlice();
+		copyToSlice(texture, slice);
+		ref.handle = slice;
+	}
+	return ref.handle;
+}
+
+void MaterialBuffer::releaseTexture(unsigned int textureID) {
+	auto it = textureRefs.find(textureID);
+	if (it == textureRefs.end() || --it->second.users > 0) return;
+
+	if (GLAD_GL_ARB_bindless_texture) {
+		if (glIsTextureHandleResidentARB(it->second.handle)) glMakeTextureHandleNonResidentARB(it->second.handle);
+	} else {
+		freeSlices.push_back((unsigned int) it->second.handle);
+	}
+	textureRefs.erase(it);
+}
+
+unsigned int MaterialBuffer::allocateSlice() {
+	if (!freeSlices.empty()) {
+		unsigned int slice = freeSlices.back();
+		freeSlices.pop_back();
+		return slice;
+	}
+
+	unsigned int slice = nextSlice++;
+	if (slice < arrayLayers) return slice;
+
+	// Grows by doubling, the slices already filled are copied over with all their levels
+	unsigned int newLayers = std::max(arrayLayers * 2, 16u);
+	unsigned int texture;
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+	glTextureStorage3D(texture, MATERIAL_TEXTURE_ARRAY_LEVELS, GL_RGBA8, MATERIAL_TEXTURE_ARRAY_SIZE, MATERIAL_TEXTURE_ARRAY_SIZE, newLayers);
+	glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D_ARRAY, GL_RGBA8, MATERIAL_TEXTURE_ARRAY_SIZE, MATERIAL_TEXTURE_ARRAY_SIZE,
+		newLayers, MATERIAL_TEXTURE_ARRAY_LEVELS, "material textures");
+
+	if (arrayLayers > 0) {
+		for (int level = 0; level < MATERIAL_TEXTURE_ARRAY_LEVELS; level++) {
+			int size = MATERIAL_TEXTURE_ARRAY_SIZE >> level;
+			glCopyImageSubData(textureArray, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+				texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, size, size, arrayLayers);
+		}
+	} else {
+		readFramebuffer = glutil::createFramebuffer("material texture source");
+		drawFramebuffer = glutil::createFramebuffer("material texture slice");
+	}
+
+	textureArray = TextureHandle(texture);
+	arrayLayers = newLayers;
+	return slice;
+}
+
+void MaterialBuffer::copyToSlice(const Texture& texture, unsigned int slice) {
+	// Resampled to the array's size by the blit, the mip chain is rebuilt once before the next upload
+	glNamedFramebufferTexture(readFramebuffer, GL_COLOR_ATTACHMENT0, texture.id, 0);
+	glNamedFramebufferReadBuffer(readFramebuffer, GL_COLOR_ATTACHMENT0);
+	glNamedFramebufferTextureLayer(drawFramebuffer, GL_COLOR_ATTACHMENT0, textureArray, 0, slice);
+	glNamedFramebufferDrawBuffer(drawFramebuffer, GL_COLOR_ATTACHMENT0);
+
+	glBlitNamedFramebuffer(readFramebuffer, drawFramebuffer, 0, 0, texture.width, texture.height,
+		0, 0, MATERIAL_TEXTURE_ARRAY_SIZE, MATERIAL_TEXTURE_ARRAY_SIZE, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	arrayNeedsMipmaps = true;
+}
+
+void MaterialBuffer::update(const Material& material) {
+	if (material.materialID == INVALID_MATERIAL_ID || material.materialID >= gpuMaterials.size()) return;
+
+	gpuMaterials[material.materialID].params = material.params;
+	markDirty(material.materialID);
+}
+
+void MaterialBuffer::markDirty(size_t index) {
+	if (isDirty.size() <= index) isDirty.resize(index + 1, false);
+	if (isDirty[index]) return;
+
+	isDirty[index] = true;
+	dirtyEntries.push_back(index);
+}
+
+void MaterialBuffer::upload() {
+	lastUploadSize = 0;
+	if (gpuMaterials.empty()) return;
+
+	if (gpuMaterials.size() > capacity) {
+		capacity = std::max(gpuMaterials.size(), capacity * 2);
+		buffer = glutil::createBuffer(capacity * sizeof(GPUMaterial), nullptr, GL_DYNAMIC_DRAW, "materials");
+
+		// The new buffer starts empty, everything goes up
+		for (size_t i = 0; i < gpuMaterials.size(); i++) markDirty(i);
+	}
+
+	// Edits far apart go up as separate ranges instead of everything between them
+	std::sort(dirtyEntries.begin(), dirtyEntries.end());
+	for (size_t i = 0; i < dirtyEntries.size();) {
+		size_t begin = dirtyEntries[i];
+		size_t end = begin + 1;
+		for (i++; i < dirtyEntries.size() && dirtyEntries[i] == end; i++) end++;
+
+		size_t size = (end - begin) * sizeof(GPUMaterial);
+		glNamedBufferSubData(buffer, begin * sizeof(GPUMaterial), size, &gpuMaterials[begin]);
+		GLState::get().recordUpload(size);
+		lastUploadSize += size;
+	}
+	for (size_t index : dirtyEntries) isDirty[index] = false;
+	dirtyEntries.clear();
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, buffer);
+
+	if (textureArray != 0) {
+		if (arrayNeedsMipmaps) {
+			glGenerateTextureMipmap(textureArray);
+			arrayNeedsMipmaps = false;
+		}
+		GLState::get().bindTexture(MATERIAL_TEXTURE_ARRAY_UNIT, GL_TEXTURE_2D_ARRAY, textureArray);
+	}
+}
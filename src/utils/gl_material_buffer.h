@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include "utils/material.h"
+#include "utils/gl_resources.h"
+
+#define MATERIAL_BUFFER_BINDING 7
+
+// Without bindless textures, material maps are resampled into slices of one array texture
+// bound at this unit, must match include/material.glsl
+#define MATERIAL_TEXTURE_ARRAY_UNIT 15
+#define MATERIAL_TEXTURE_ARRAY_SIZE 1024
+#define MATERIAL_TEXTURE_ARRAY_LEVELS 11
+
+// std430 layout of one entry in the shared material buffer. With bindless textures each slot
+// holds a resident handle, without them the slice of the material texture array, 0 when missing.
+struct GPUMaterial {
+	GLuint64 textureHandles[MAX_MATERIAL_TEXTURES];
+	MaterialParameters params;
+};
+static_assert(sizeof(GPUMaterial) == 112, "GPUMaterial must match the std430 Material struct");
+
+class MaterialBuffer {
+	public:
+		// Packs every material that doesn't have an ID yet into the buffer and assigns its ID,
+		// reusing the IDs of released materials. Textures must already be created on the GPU.
+		void compile(std::vector<Material>& materials);
+		// Frees the materials' entries and drops their textures, call before deleting the textures
+		void release(std::vector<Material>& materials);
+
+		// Copies edited parameters and marks that entry for the next upload
+		void update(const Material& material);
+
+		// Sends the dirty entries, one range per run of neighbours, and binds the buffer at
+		// MATERIAL_BUFFER_BINDING and the texture array when there is one
+		void upload();
+
+		unsigned int getMaterialCount() const { return gpuMaterials.size() - freeMaterials.size(); }
+		unsigned int getLastUploadSize() const { return lastUploadSize; }
+
+	private:
+		// Materials using a texture, it stays resident or keeps its slice until the last one goes
+		struct TextureRef {
+			GLuint64 handle = 0;
+			unsigned int users = 0;
+		};
+
+		std::vector<GPUMaterial> gpuMaterials;
+		std::vector<unsigned int> freeMaterials;
+		std::unordered_map<unsigned int, TextureRef> textureRefs;
+
+		BufferHandle buffer;
+		size_t capacity = 0;
+
+		std::vector<size_t> dirtyEntries;
+		std::vector<bool> isDirty;
+		unsigned int lastUploadSize = 0;
+
+		TextureHandle textureArray;
+		FramebufferHandle readFramebuffer, drawFramebuffer;
+		unsigned int arrayLayers = 0;
+		// Slice 0 is never handed out, so 0 still means no texture
+		unsigned int nextSlice = 1;
+		std::vector<unsigned int> freeSlices;
+		bool arrayNeedsMipmaps = false;
+
+		void markDirty(size_t index);
+		GLuint64 acquireTexture(const Texture& texture);
+		void releaseTexture(unsigned int textureID);
+		unsigned int allocateSlice();
+		void copyToSlice(const Texture& texture, unsigned int slice);
+};
@@ -34,8 +34,8 @@ struct Mesh {
     glm::mat4 model_matrix;
     BoundingBox aabb;
 
-    AllocatedBuffer buffer;
-    unsigned int SSBO;
+    GeometryAllocation geometry;
+    unsigned int SSBO = 0;
 
     void getBoneTransforms(float time, const aiScene* scene, std::vector<NodeData>& nodeData, int animationIndex = 0);
     const aiNodeAnim* findNodeAnim(const aiAnimation* animation, const std::string nodeName);
@@ -67,6 +67,8 @@ class Model {
         BoundingBox aabb;
         bool shouldDraw = true;
         int numAnimations = 0;
+        // Unique per loaded model and kept by copies, assigned by GLEngine::loadModelData, 0 before that
+        unsigned int id = 0;
 
         const aiScene* scene;
 
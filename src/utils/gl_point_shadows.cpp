@@ -0,0 +1,296 @@
+#include "gl_point_shadows.h"
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Same order and orientation as the faces of a cube map
+static const glm::vec3 faceDirections[POINT_SHADOW_FACES] = {
+    glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+    glm::vec3( 0.0f, 1.0f, 0.0f), glm::vec3( 0.0f,-1.0f, 0.0f),
+    glm::vec3( 0.0f, 0.0f, 1.0f), glm::vec3( 0.0f, 0.0f,-1.0f)
+};
+
+static const glm::vec3 faceUps[POINT_SHADOW_FACES] = {
+    glm::vec3(0.0f,-1.0f, 0.0f), glm::vec3(0.0f,-1.0f, 0.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f,-1.0f),
+    glm::vec3(0.0f,-1.0f, 0.0f), glm::vec3(0.0f,-1.0f, 0.0f)
+};
+
+static TextureHandle createAtlas(const std::string& name) {
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_DEPTH_COMPONENT32F, POINT_SHADOW_ATLAS_SIZE, POINT_SHADOW_ATLAS_SIZE);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    float farDepth = 1.0f;
+    glClearTexImage(texture, 0, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+    ResourceRegistry::get().trackTexture(texture, GL_TEXTURE_2D, GL_DEPTH_COMPONENT32F,
+        POINT_SHADOW_ATLAS_SIZE, POINT_SHADOW_ATLAS_SIZE, 1, 1, name);
+    return TextureHandle(texture);
+}
+
+static FramebufferHandle createAtlasFramebuffer(unsigned int texture, const std::string& name) {
+    FramebufferHandle framebuffer = glutil::createFramebuffer(name);
+    glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, texture, 0);
+    glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+    glNamedFramebufferReadBuffer(framebuffer, GL_NONE);
+    return framebuffer;
+}
+
+// Full resolution once the range is four times the distance, halved per halving after that.
+// margin scales the thresholds.
+static unsigned int getResolution(float priority, float margin) {
+    unsigned int resolution = POINT_SHADOW_MAX_RESOLUTION;
+    float threshold = 4.0f * margin;
+    while (resolution > POINT_SHADOW_MIN_RESOLUTION && priority < threshold) {
+        resolution /= 2;
+        threshold /= 2.0f;
+    }
+    return resolution;
+}
+
+void PointShadowCache::init(unsigned int numLights) {
+    lights.assign(numLights, PointShadowLight());
+    allocator.init(POINT_SHADOW_ATLAS_SIZE, POINT_SHADOW_MIN_RESOLUTION);
+
+    atlas = createAtlas("point shadow atlas");
+    staticAtlas = createAtlas("point shadow static atlas");
+    framebuffer = createAtlasFramebuffer(atlas, "point shadow atlas");
+    staticFramebuffer = createAtlasFramebuffer(staticAtlas, "point shadow static atlas");
+}
+
+void PointShadowCache::invalidate() {
+    for (PointShadowLight& light : lights) {
+        for (PointShadowFace& face : light.faces) {
+            face.staticDirty = true;
+            face.dynamicDirty = true;
+        }
+    }
+}
+
+void PointShadowCache::update(const glm::vec3* positions, std::vector<Model>& models, Camera& camera) {
+    stats = PointShadowStats();
+
+    // The static atlas wasn't kept up while caching was off
+    if (useCache != wasCaching) invalidate();
+    wasCaching = useCache;
+
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        updateLight(lights[i], positions[i], camera);
+    }
+    updateCasters(models);
+    schedule();
+
+    stats.atlasUsedArea = allocator.getUsedArea();
+    stats.atlasArea = (size_t) POINT_SHADOW_ATLAS_SIZE * POINT_SHADOW_ATLAS_SIZE;
+}
+
+void PointShadowCache::updateLight(PointShadowLight& light, const glm::vec3& position, Camera& camera) {
+    if (!light.hasPosition || position != light.position) {
+        light.position = position;
+        light.hasPosition = true;
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+        for (int i = 0; i < POINT_SHADOW_FACES; i++) {
+            PointShadowFace& face = light.faces[i];
+            face.viewProjection = projection * glm::lookAt(position, position + faceDirections[i], faceUps[i]);
+            face.volume = ShadowVolume::fromMatrix(face.viewProjection);
+            face.staticDirty = true;
+        }
+    }
+
+    // How big the light's range is on screen, lights whose range is out of view matter less
+    float distance = glm::length(position - camera.Position);
+    light.priority = farPlane / std::max(distance, nearPlane);
+
+    glm::vec4 rangeMax = glm::vec4(position + glm::vec3(farPlane), 1.0f);
+    glm::vec4 rangeMin = glm::vec4(position - glm::vec3(farPlane), 1.0f);
+    if (!camera.isInsideFrustum(rangeMax, rangeMin)) light.priority *= 0.25f;
+
+    unsigned int resolution = light.requestedResolution;
+    if (resolution == 0) resolution = getResolution(light.priority, 1.0f);
+    else {
+        unsigned int grown = getResolution(light.priority, POINT_SHADOW_GROW_MARGIN);
+        unsigned int shrunk = getResolution(light.priority, POINT_SHADOW_SHRINK_MARGIN);
+        if (grown > resolution) resolution = grown;
+        else if (shrunk < resolution) resolution = shrunk;
+    }
+
+    if (resolution != light.requestedResolution) {
+        light.requestedResolution = resolution;
+        allocate(light, resolution);
+    }
+}
+
+// The old tiles stay allocated and sampled until each face draws into its new one
+void PointShadowCache::allocate(PointShadowLight& light, unsigned int resolution) {
+    for (PointShadowFace& face : light.faces) {
+        // A face that never got drawn since the last reallocation still shows the tile before it
+        if (face.rendered || !face.previousRegion.isValid()) {
+            freePrevious(face);
+            face.previousRegion = face.region;
+        } else {
+            allocator.free(face.region);
+        }
+        face.region = ShadowAtlasRegion();
+    }
+    light.resolution = 0;
+
+    // With the old tiles taking up room the atlas may be too full, they go first before settling for no shadow
+    if (!allocateFaces(light, resolution)) {
+        for (PointShadowFace& face : light.faces) freePrevious(face);
+        allocateFaces(light, resolution);
+    }
+
+    // The tiles held another light's depth, far depth reads as unshadowed until they're drawn
+    float farDepth = 1.0f;
+    for (PointShadowFace& face : light.faces) {
+        face.staticDirty = true;
+        face.dynamicDirty = true;
+        face.rendered = false;
+        if (!face.region.isValid()) continue;
+
+        const ShadowAtlasRegion& region = face.region;
+        glClearTexSubImage(atlas, 0, region.x, region.y, 0, region.size, region.size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+        glClearTexSubImage(staticAtlas, 0, region.x, region.y, 0, region.size, region.size, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &farDepth);
+    }
+}
+
+// Settles for less when the atlas is full, false when even the smallest tiles don't fit
+bool PointShadowCache::allocateFaces(PointShadowLight& light, unsigned int resolution) {
+    for (; resolution >= POINT_SHADOW_MIN_RESOLUTION; resolution /= 2) {
+        int allocated = 0;
+        for (; allocated < POINT_SHADOW_FACES; allocated++) {
+            light.faces[allocated].region = allocator.allocate(resolution);
+            if (!light.faces[allocated].region.isValid()) break;
+        }
+        if (allocated == POINT_SHADOW_FACES) {
+            light.resolution = resolution;
+            return true;
+        }
+
+        for (int i = 0; i < allocated; i++) {
+            allocator.free(light.faces[i].region);
+            light.faces[i].region = ShadowAtlasRegion();
+        }
+    }
+    return false;
+}
+
+void PointShadowCache::freePrevious(PointShadowFace& face) {
+    if (face.previousRegion.isValid()) allocator.free(face.previousRegion);
+    face.previousRegion = ShadowAtlasRegion();
+}
+
+void PointShadowCache::updateCasters(std::vector<Model>& models) {
+    if (casters.size() != models.size()) {
+        casters.assign(models.size(), CasterState());
+        for (size_t i = 0; i < models.size(); i++) {
+            Model& model = models[i];
+            CasterState& caster = casters[i];
+            caster.lastMatrix = model.model_matrix;
+            caster.isDynamic = model.scene != nullptr && model.scene->mNumAnimations > 0;
+            transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, caster.boundsMin, caster.boundsMax);
+        }
+        invalidate();
+    }
+
+    for (size_t i = 0; i < models.size(); i++) {
+        Model& model = models[i];
+        CasterState& caster = casters[i];
+
+        bool isAnimated = model.scene != nullptr && model.scene->mNumAnimations > 0;
+        bool moved = isAnimated || model.model_matrix != caster.lastMatrix;
+        if (moved) {
+            // Leaves the static tiles it was baked into
+            if (!caster.isDynamic) markFaces(caster.boundsMin, caster.boundsMax, true);
+            caster.isDynamic = true;
+
+            markFaces(caster.boundsMin, caster.boundsMax, false);
+            caster.lastMatrix = model.model_matrix;
+            transformBounds(model.model_matrix, model.aabb.minPoint, model.aabb.maxPoint, caster.boundsMin, caster.boundsMax);
+            markFaces(caster.boundsMin, caster.boundsMax, false);
+        }
+
+        if (caster.isDynamic) stats.dynamicCasters++;
+    }
+}
+
+void PointShadowCache::markFaces(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool staticCasters) {
+    for (PointShadowLight& light : lights) {
+        for (PointShadowFace& face : light.faces) {
+            if (!face.volume.intersects(boundsMin, boundsMax)) continue;
+
+            if (staticCasters) face.staticDirty = true;
+            else face.dynamicDirty = true;
+        }
+    }
+}
+
+void PointShadowCache::schedule() {
+    struct Candidate {
+        unsigned int light;
+        int face;
+        float priority;
+    };
+
+    std::vector<Candidate> candidates;
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        PointShadowLight& light = lights[i];
+        light.updateMask = 0;
+        light.staticMask = 0;
+
+        for (int j = 0; j < POINT_SHADOW_FACES; j++) {
+            PointShadowFace& face = light.faces[j];
+            if (!face.region.isValid()) continue;
+            if (useCache && !face.staticDirty && !face.dynamicDirty) continue;
+
+            float priority = light.priority + face.age * POINT_SHADOW_AGE_PRIORITY;
+            if (!face.rendered) priority += POINT_SHADOW_NEW_PRIORITY;
+            candidates.push_back({ i, j, priority });
+        }
+    }
+
+    size_t budget = candidates.size();
+    if (useCache) {
+        budget = std::min(budget, (size_t) std::max(faceBudget, 0));
+        std::partial_sort(candidates.begin(), candidates.begin() + budget, candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+    }
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        PointShadowLight& light = lights[candidates[i].light];
+        PointShadowFace& face = light.faces[candidates[i].face];
+        if (i >= budget) {
+            face.age++;
+            stats.pendingFaces++;
+            continue;
+        }
+
+        uint32_t bit = 1u << candidates[i].face;
+        light.updateMask |= bit;
+        if (useCache && face.staticDirty) {
+            light.staticMask |= bit;
+            stats.staticUpdates++;
+        }
+        stats.faceUpdates++;
+
+        face.staticDirty = false;
+        face.dynamicDirty = false;
+        face.rendered = true;
+        face.age = 0;
+        // Recorded this frame ahead of the passes that sample it, the tile it replaces can go
+        freePrevious(face);
+    }
+}
+
+glm::vec4 PointShadowCache::getRect(unsigned int light, int face) const {
+    const PointShadowFace& shadowFace = lights[light].faces[face];
+    const ShadowAtlasRegion& region = !shadowFace.rendered && shadowFace.previousRegion.isValid() ? shadowFace.previousRegion : shadowFace.region;
+    if (!region.isValid()) return glm::vec4(0.0f);
+
+    return glm::vec4(region.x, region.y, region.size, region.size) / (float) POINT_SHADOW_ATLAS_SIZE;
+}
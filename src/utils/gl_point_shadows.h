@@ -0,0 +1,127 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "utils/camera.h"
+#include "utils/gl_model.h"
+#include "utils/gl_resources.h"
+#include "utils/shadow_atlas.h"
+#include "utils/shadow_culling.h"
+
+#define POINT_SHADOW_FACES 6
+#define POINT_SHADOW_ATLAS_SIZE 4096
+#define POINT_SHADOW_MAX_RESOLUTION 1024
+#define POINT_SHADOW_MIN_RESOLUTION 128
+// Added to a face's priority for every frame it waits, so far lights still get their turn
+#define POINT_SHADOW_AGE_PRIORITY 0.5f
+// Faces with nothing in their tile yet go before any other update
+#define POINT_SHADOW_NEW_PRIORITY 1000.0f
+// How far past a step's priority threshold a light has to get before its tiles grow or shrink,
+// so turning the camera or resting near a threshold doesn't reallocate every frame
+#define POINT_SHADOW_GROW_MARGIN 1.25f
+#define POINT_SHADOW_SHRINK_MARGIN 0.75f
+
+struct PointShadowFace {
+    ShadowAtlasRegion region;
+    // The tile from before a reallocation, still sampled until the new one has been drawn
+    ShadowAtlasRegion previousRegion;
+    glm::mat4 viewProjection;
+    ShadowVolume volume;
+
+    // The static casters have to be drawn again, implies compositing
+    bool staticDirty = true;
+    // The static tile has to be copied and the dynamic casters drawn over it
+    bool dynamicDirty = true;
+    bool rendered = false;
+    // Frames the face has waited dirty
+    unsigned int age = 0;
+};
+
+struct PointShadowLight {
+    glm::vec3 position = glm::vec3(0.0f);
+    bool hasPosition = false;
+    // What the priority asks for and what the atlas had room for
+    unsigned int requestedResolution = 0;
+    unsigned int resolution = 0;
+    float priority = 0.0f;
+    PointShadowFace faces[POINT_SHADOW_FACES];
+
+    // Faces to record this frame, and the ones of those that redraw their static casters first
+    uint32_t updateMask = 0;
+    uint32_t staticMask = 0;
+};
+
+struct PointShadowStats {
+    unsigned int faceUpdates = 0;
+    unsigned int staticUpdates = 0;
+    // Dirty faces left for later frames by the budget
+    unsigned int pendingFaces = 0;
+    unsigned int dynamicCasters = 0;
+    size_t atlasUsedArea = 0;
+    size_t atlasArea = 0;
+};
+
+// Point light shadows kept in two depth atlases with the same layout. Every light gets six tiles,
+// one per cube face, sized by how large the light's range is on screen. The static atlas holds
+// what casters that never moved throw, drawn once and again only when the light moves. The atlas
+// the shaders read is that tile copied over with the dynamic casters drawn on top, redone when a
+// dynamic caster in the face moves. Dirty faces are handed out by priority, at most faceBudget a
+// frame, the rest keep last frame's shadow until their turn.
+class PointShadowCache {
+    public:
+        void init(unsigned int numLights);
+
+        // Decides what gets recorded this frame, call on the GL thread before recording.
+        // Models that move or animate become dynamic casters for good.
+        void update(const glm::vec3* positions, std::vector<Model>& models, Camera& camera);
+        // Everything goes stale, for changes update can't see
+        void invalidate();
+
+        const PointShadowLight& getLight(unsigned int light) const { return lights[light]; }
+        unsigned int getNumLights() const { return lights.size(); }
+        bool isDynamic(size_t model) const { return model < casters.size() && casters[model].isDynamic; }
+        // Tile as offset and scale in texture coordinates, zero for lights the atlas had no room for
+        glm::vec4 getRect(unsigned int light, int face) const;
+
+        unsigned int getAtlas() const { return atlas; }
+        unsigned int getStaticAtlas() const { return staticAtlas; }
+        unsigned int getFramebuffer() const { return framebuffer; }
+        unsigned int getStaticFramebuffer() const { return staticFramebuffer; }
+        const PointShadowStats& getStats() const { return stats; }
+
+        float nearPlane = 1.0f;
+        float farPlane = 25.0f;
+        // Without caching every face redraws every caster each frame
+        bool useCache = true;
+        int faceBudget = 8;
+
+    private:
+        struct CasterState {
+            glm::mat4 lastMatrix;
+            glm::vec3 boundsMin, boundsMax;
+            bool isDynamic = false;
+        };
+
+        std::vector<PointShadowLight> lights;
+        std::vector<CasterState> casters;
+        bool wasCaching = true;
+
+        ShadowAtlas allocator;
+        TextureHandle atlas, staticAtlas;
+        FramebufferHandle framebuffer, staticFramebuffer;
+
+        PointShadowStats stats;
+
+        void updateCasters(std::vector<Model>& models);
+        void updateLight(PointShadowLight& light, const glm::vec3& position, Camera& camera);
+        void allocate(PointShadowLight& light, unsigned int resolution);
+        bool allocateFaces(PointShadowLight& light, unsigned int resolution);
+        void freePrevious(PointShadowFace& face);
+        // Flags every face whose volume the box touches
+        void markFaces(const glm::vec3& boundsMin, const glm::vec3& boundsMax, bool staticCasters);
+        void schedule();
+};
@@ -0,0 +1,250 @@
+#include "gl_program_cache.h"
+#include "gl_compute.h"
+#include "gl_state.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+struct ProgramBinaryHeader {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t hash;
+    uint32_t length;
+};
+
+static uint64_t hashBytes(const void* data, size_t length, uint64_t hash) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static const char* getStageName(GLenum type) {
+    switch (type) {
+        case GL_VERTEX_SHADER: return "VERTEX";
+        case GL_FRAGMENT_SHADER: return "FRAGMENT";
+        case GL_GEOMETRY_SHADER: return "GEOMETRY";
+        case GL_COMPUTE_SHADER: return "COMPUTE";
+        default: return "UNKNOWN";
+    }
+}
+
+ProgramCache& ProgramCache::get() {
+    static ProgramCache cache;
+    return cache;
+}
+
+void ProgramCache::init() {
+    initialized = true;
+
+    const char* vendor = (const char*) glGetString(GL_VENDOR);
+    const char* renderer = (const char*) glGetString(GL_RENDERER);
+    const char* version = (const char*) glGetString(GL_VERSION);
+    driverString = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+
+    int numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    binariesSupported = numFormats > 0;
+
+    int numExtensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (int i = 0; i < numExtensions; i++) {
+        const char* extension = (const char*) glGetStringi(GL_EXTENSIONS, i);
+        if (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0) {
+            parallelCompileSupported = true;
+        }
+    }
+
+    if (binariesSupported) {
+        std::error_code error;
+        std::filesystem::create_directories(PROGRAM_CACHE_PATH, error);
+        if (error) {
+            std::cout << "WARNING::PROGRAM_CACHE::CANNOT_CREATE_DIRECTORY " << error.message() << std::endl;
+            binariesSupported = false;
+        }
+    }
+}
+
+// The driver is part of the key so a binary from another GPU or driver version is never tried
+uint64_t ProgramCache::hashSources(const std::vector<ShaderStageSource>& stages) const {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashBytes(driverString.data(), driverString.size(), hash);
+    for (const ShaderStageSource& stage : stages) {
+        hash = hashBytes(&stage.type, sizeof(GLenum), hash);
+        hash = hashBytes(stage.source.data(), stage.source.size(), hash);
+    }
+    return hash;
+}
+
+std::string ProgramCache::getBinaryPath(uint64_t hash) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) hash);
+    return std::string(PROGRAM_CACHE_PATH) + name;
+}
+
+unsigned int ProgramCache::getProgram(const std::vector<ShaderStageSource>& stages) {
+    unsigned int program = findProgram(stages);
+    if (program != 0) return program;
+
+    PendingProgram pending = beginCompile(stages);
+    return finishCompile(pending);
+}
+
+unsigned int ProgramCache::findProgram(const std::vector<ShaderStageSource>& stages) {
+    if (!initialized) init();
+
+    uint64_t hash = hashSources(stages);
+    auto it = programs.find(hash);
+    if (it != programs.end()) {
+        stats.shared++;
+        entries[it->second].references++;
+        return it->second;
+    }
+
+    unsigned int program = binariesSupported ? loadBinary(hash) : 0;
+    if (program != 0) {
+        stats.loadedFromDisk++;
+        addProgram(hash, program);
+    }
+    return program;
+}
+
+PendingProgram ProgramCache::beginCompile(const std::vector<ShaderStageSource>& stages) {
+    if (!initialized) init();
+
+    PendingProgram pending;
+    pending.hash = hashSources(stages);
+    pending.program = glCreateProgram();
+    glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    for (const ShaderStageSource& stage : stages) {
+        const char* code = stage.source.c_str();
+        unsigned int shader = glCreateShader(stage.type);
+        glShaderSource(shader, 1, &code, nullptr);
+        glCompileShader(shader);
+        glAttachShader(pending.program, shader);
+
+        pending.shaders.push_back(shader);
+        pending.names.push_back(std::string(getStageName(stage.type)) + " " + stage.name);
+    }
+
+    glLinkProgram(pending.program);
+    return pending;
+}
+
+bool ProgramCache::isComplete(const PendingProgram& pending) const {
+    if (!parallelCompileSupported) return true;
+
+    int complete = GL_FALSE;
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+unsigned int ProgramCache::finishCompile(PendingProgram& pending) {
+    bool success = true;
+    for (size_t i = 0; i < pending.shaders.size(); i++) {
+        success &= checkCompileErrors(pending.shaders[i], pending.names[i]);
+    }
+    success &= checkCompileErrors(pending.program, "PROGRAM");
+
+    for (unsigned int shader : pending.shaders) {
+        glDetachShader(pending.program, shader);
+        glDeleteShader(shader);
+    }
+    pending.shaders.clear();
+
+    unsigned int program = pending.program;
+    pending.program = 0;
+    if (!success) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    stats.compiled++;
+    if (binariesSupported) saveBinary(pending.hash, program);
+
+    // The same sources may have finished compiling for someone else in the meantime
+    auto it = programs.find(pending.hash);
+    if (it != programs.end()) {
+        glDeleteProgram(program);
+        stats.shared++;
+        entries[it->second].references++;
+        return it->second;
+    }
+
+    addProgram(pending.hash, program);
+    return program;
+}
+
+void ProgramCache::addProgram(uint64_t hash, unsigned int program) {
+    programs[hash] = program;
+    entries[program] = { hash, 1 };
+}
+
+void ProgramCache::release(unsigned int program) {
+    auto it = entries.find(program);
+    if (it == entries.end() || --it->second.references > 0) return;
+
+    programs.erase(it->second.hash);
+    entries.erase(it);
+    glDeleteProgram(program);
+    GLState::get().forgetProgram(program);
+}
+
+unsigned int ProgramCache::loadBinary(uint64_t hash) {
+    std::string path = getBinaryPath(hash);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    ProgramBinaryHeader header;
+    file.read((char*) &header, sizeof(header));
+    if (!file || header.magic != PROGRAM_CACHE_MAGIC || header.hash != hash) return 0;
+
+    std::vector<char> binary(header.length);
+    file.read(binary.data(), header.length);
+    if (!file) return 0;
+    file.close();
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.format, binary.data(), header.length);
+
+    int success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(program);
+        std::remove(path.c_str());
+        stats.rejected++;
+        return 0;
+    }
+    return program;
+}
+
+void ProgramCache::saveBinary(uint64_t hash, unsigned int program) {
+    int success = 0, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (!success || length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = GL_NONE;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    ProgramBinaryHeader header;
+    header.magic = PROGRAM_CACHE_MAGIC;
+    header.format = format;
+    header.hash = hash;
+    header.length = length;
+
+    std::ofstream file(getBinaryPath(hash), std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "WARNING::PROGRAM_CACHE::CANNOT_WRITE " << getBinaryPath(hash) << std::endl;
+        return;
+    }
+    file.write((const char*) &header, sizeof(header));
+    file.write(binary.data(), length);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define PROGRAM_CACHE_PATH "../../shader_cache/"
+#define PROGRAM_CACHE_MAGIC 0x42505247u
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile, glad isn't generated with either
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+struct ShaderStageSource {
+    GLenum type;
+    // Used in compile errors
+    std::string name;
+    std::string source;
+};
+
+// A program whose stages and link have been issued but not checked. With parallel compile the
+// driver works on it in the background until isComplete says otherwise.
+struct PendingProgram {
+    uint64_t hash = 0;
+    unsigned int program = 0;
+    std::vector<unsigned int> shaders;
+    // Stage type and path of each shader, for compile errors
+    std::vector<std::string> names;
+};
+
+struct ProgramCacheStats {
+    unsigned int shared = 0;
+    unsigned int loadedFromDisk = 0;
+    unsigned int compiled = 0;
+    unsigned int rejected = 0;
+};
+
+// Linked programs keyed by a hash of their stage sources and the driver that built them.
+// A program requested twice is linked once and shared, and linked binaries are written to
+// PROGRAM_CACHE_PATH so later runs can skip compiling. A binary the driver refuses (driver
+// update, different GPU) is deleted from disk and the program is compiled from source.
+// Every program handed out holds a reference, release drops it and deletes the program
+// once nobody uses it.
+class ProgramCache {
+    public:
+        static ProgramCache& get();
+
+        // Compiles and links on the spot when the program isn't cached
+        unsigned int getProgram(const std::vector<ShaderStageSource>& stages);
+
+        // Shared or loaded from disk, 0 when it has to be compiled
+        unsigned int findProgram(const std::vector<ShaderStageSource>& stages);
+        // Issues the compiles and the link without querying any status, so the driver is free to
+        // work on them in parallel
+        PendingProgram beginCompile(const std::vector<ShaderStageSource>& stages);
+        // Always true without parallel compile, the status check in finishCompile blocks instead
+        bool isComplete(const PendingProgram& pending) const;
+        // Reports errors and caches the program. 0 when a stage failed to compile or link.
+        unsigned int finishCompile(PendingProgram& pending);
+
+        void release(unsigned int program);
+
+        bool supportsParallelCompile() const { return parallelCompileSupported; }
+        const ProgramCacheStats& getStats() const { return stats; }
+
+    private:
+        struct ProgramEntry {
+            uint64_t hash;
+            unsigned int references;
+        };
+
+        std::unordered_map<uint64_t, unsigned int> programs;
+        std::unordered_map<unsigned int, ProgramEntry> entries;
+        std::string driverString;
+        bool binariesSupported = false;
+        bool parallelCompileSupported = false;
+        bool initialized = false;
+        ProgramCacheStats stats;
+
+        void init();
+        uint64_t hashSources(const std::vector<ShaderStageSource>& stages) const;
+        std::string getBinaryPath(uint64_t hash) const;
+
+        unsigned int loadBinary(uint64_t hash);
+        void saveBinary(uint64_t hash, unsigned int program);
+        void addProgram(uint64_t hash, unsigned int program);
+};
@@ -0,0 +1,128 @@
+#include "gl_reflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+UniformId uniformArray(const char* base, int index, const char* member) {
+    uint32_t hash = hashUniformName(base, std::strlen(base));
+    hash = hashUniformName("[", 1, hash);
+
+    char digits[12];
+    int numDigits = 0;
+    unsigned int value = index < 0 ? 0 : (unsigned int) index;
+    do {
+        digits[numDigits++] = '0' + (value % 10);
+        value /= 10;
+    } while (value > 0);
+    for (int i = numDigits - 1; i >= 0; i--) {
+        hash = hashUniformName(&digits[i], 1, hash);
+    }
+
+    hash = hashUniformName("]", 1, hash);
+    if (member != nullptr) {
+        hash = hashUniformName(".", 1, hash);
+        hash = hashUniformName(member, std::strlen(member), hash);
+    }
+
+    return UniformId(hash);
+}
+
+void ProgramReflection::reflect(unsigned int program) {
+    uniforms.clear();
+    blocks.clear();
+
+    int numUniforms = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+
+    const GLenum uniformProps[4] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+    char nameBuffer[256];
+    for (int i = 0; i < numUniforms; i++) {
+        int values[4];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 4, uniformProps, 4, nullptr, values);
+        // Members of uniform blocks have no location
+        if (values[3] != -1 || values[0] == -1) continue;
+
+        glGetProgramResourceName(program, GL_UNIFORM, i, sizeof(nameBuffer), nullptr, nameBuffer);
+        std::string name(nameBuffer);
+        int location = values[0];
+        GLenum type = values[1];
+        int arraySize = values[2];
+
+        // Arrays of basic types are reported once as "name[0]", so expand every element
+        size_t arraySuffix = name.rfind("[0]");
+        if (arraySuffix != std::string::npos && arraySuffix + 3 == name.size()) {
+            std::string baseName = name.substr(0, arraySuffix);
+            addUniform(baseName, location, type, arraySize);
+            for (int element = 0; element < arraySize; element++) {
+                addUniform(baseName + "[" + std::to_string(element) + "]", location + element, type, 1, true);
+            }
+        } else {
+            addUniform(name, location, type);
+        }
+    }
+
+    const GLenum blockInterfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+    const GLenum blockProps[2] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+    for (GLenum blockInterface : blockInterfaces) {
+        int numBlocks = 0;
+        glGetProgramInterfaceiv(program, blockInterface, GL_ACTIVE_RESOURCES, &numBlocks);
+
+        for (int i = 0; i < numBlocks; i++) {
+            int values[2];
+            glGetProgramResourceiv(program, blockInterface, i, 2, blockProps, 2, nullptr, values);
+            glGetProgramResourceName(program, blockInterface, i, sizeof(nameBuffer), nullptr, nameBuffer);
+
+            BlockInfo block;
+            block.name = nameBuffer;
+            block.interface = blockInterface;
+            block.binding = values[0];
+            block.dataSize = values[1];
+            blocks.push_back(block);
+        }
+    }
+    instanced = findBlock("InstanceBlock") != nullptr;
+
+    std::sort(uniforms.begin(), uniforms.end(), [](const UniformInfo& a, const UniformInfo& b) {
+        return a.hash < b.hash;
+    });
+
+    for (size_t i = 1; i < uniforms.size(); i++) {
+        if (uniforms[i].hash == uniforms[i - 1].hash && uniforms[i].name != uniforms[i - 1].name) {
+            std::cout << "WARNING::REFLECTION::UNIFORM_HASH_COLLISION " << uniforms[i].name
+                << " and " << uniforms[i - 1].name << std::endl;
+        }
+    }
+}
+
+void ProgramReflection::addUniform(const std::string& name, int location, GLenum type, int size, bool isElement) {
+    UniformInfo info;
+    info.hash = hashUniformName(name.c_str(), name.size());
+    info.location = location;
+    info.type = type;
+    info.name = name;
+    info.size = size;
+    info.isElement = isElement;
+
+    uniforms.push_back(info);
+}
+
+const UniformInfo* ProgramReflection::findUniform(UniformId id) const {
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), id.hash,
+        [](const UniformInfo& info, uint32_t hash) { return info.hash < hash; });
+
+    if (it == uniforms.end() || it->hash != id.hash) return nullptr;
+    return &(*it);
+}
+
+int ProgramReflection::getLocation(UniformId id) const {
+    const UniformInfo* info = findUniform(id);
+    return info != nullptr ? info->location : -1;
+}
+
+const BlockInfo* ProgramReflection::findBlock(const std::string& name) const {
+    for (const BlockInfo& block : blocks) {
+        if (block.name == name) return &block;
+    }
+    return nullptr;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// FNV-1a, split into steps so array element names can be hashed without building strings
+constexpr uint32_t UNIFORM_HASH_SEED = 2166136261u;
+
+constexpr uint32_t hashUniformName(const char* str, size_t length, uint32_t hash = UNIFORM_HASH_SEED) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint32_t) (unsigned char) str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+struct UniformId {
+    uint32_t hash = 0;
+
+    constexpr UniformId() = default;
+    constexpr explicit UniformId(uint32_t hash) : hash(hash) {}
+    explicit UniformId(const std::string& name) : hash(hashUniformName(name.c_str(), name.size())) {}
+
+    bool operator==(const UniformId& other) const { return hash == other.hash; }
+};
+
+// "view"_u is hashed at compile time
+constexpr UniformId operator""_u(const char* str, size_t length) {
+    return UniformId(hashUniformName(str, length));
+}
+
+// Hashes "base[index]" or "base[index].member" without allocating
+UniformId uniformArray(const char* base, int index, const char* member = nullptr);
+
+struct UniformInfo {
+    uint32_t hash;
+    int location;
+    GLenum type;
+    std::string name;
+    // Elements of an array, the entry for its base name also carries one per element
+    int size = 1;
+    bool isElement = false;
+};
+
+struct BlockInfo {
+    std::string name;
+    GLenum interface;
+    int binding;
+    int dataSize;
+};
+
+class ProgramReflection {
+    public:
+        // Enumerates active uniforms and blocks of a linked program into a flat table sorted by hash
+        void reflect(unsigned int program);
+
+        int getLocation(UniformId id) const;
+        const UniformInfo* findUniform(UniformId id) const;
+        const BlockInfo* findBlock(const std::string& name) const;
+
+        // Set once by reflect, the render queue asks for every item it records
+        bool hasInstanceBlock() const { return instanced; }
+
+        const std::vector<UniformInfo>& getUniforms() const { return uniforms; }
+        const std::vector<BlockInfo>& getBlocks() const { return blocks; }
+
+    private:
+        std::vector<UniformInfo> uniforms;
+        std::vector<BlockInfo> blocks;
+        bool instanced = false;
+
+        void addUniform(const std::string& name, int location, GLenum type, int size = 1, bool isElement = false);
+};
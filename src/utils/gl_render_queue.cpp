@@ -0,0 +1,281 @@
+#include "gl_render_queue.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "utils/gl_model.h"
+
+uint64_t RenderQueue::createSortKey(RenderPassType pass, unsigned int program, unsigned int materialID,
+    unsigned int geometry, float normalizedDepth) {
+    uint64_t depth = (uint64_t) (glm::clamp(normalizedDepth, 0.0f, 1.0f) * 65535.0f);
+
+    uint64_t key = 0;
+    key |= ((uint64_t) pass & 0xF) << 60;
+    key |= ((uint64_t) program & 0xFFF) << 48;
+    key |= ((uint64_t) materialID & 0xFFFF) << 32;
+    key |= ((uint64_t) geometry & 0xFFFF) << 16;
+    key |= depth & 0xFFFF;
+
+    return key;
+}
+
+void RenderQueue::submit(const DrawItem& item) {
+    items.push_back(item);
+}
+
+void RenderQueue::sort() {
+    sortedIndices.resize(items.size());
+    for (uint32_t i = 0; i < items.size(); i++) sortedIndices[i] = i;
+
+    radixSort();
+}
+
+// LSD radix sort on the 64 bit keys, 8 bits per pass. Passes where every key
+// shares the same byte are skipped, which is the common case for the pass and program bytes.
+void RenderQueue::radixSort() {
+    size_t count = sortedIndices.size();
+    if (count < 2) return;
+
+    scratchIndices.resize(count);
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        uint32_t histogram[256] = { 0 };
+        for (size_t i = 0; i < count; i++) {
+            histogram[(items[sortedIndices[i]].sortKey >> shift) & 0xFF]++;
+        }
+
+        uint8_t firstByte = (items[sortedIndices[0]].sortKey >> shift) & 0xFF;
+        if (histogram[firstByte] == count) continue;
+
+        uint32_t offsets[256];
+        uint32_t total = 0;
+        for (int i = 0; i < 256; i++) {
+            offsets[i] = total;
+            total += histogram[i];
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uint32_t index = sortedIndices[i];
+            uint8_t byte = (items[index].sortKey >> shift) & 0xFF;
+            scratchIndices[offsets[byte]++] = index;
+        }
+
+        std::swap(sortedIndices, scratchIndices);
+    }
+}
+
+void RenderQueue::record(CommandBuffer& commands, const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw) {
+    if (sortedIndices.size() != items.size()) sort();
+
+    // Bindings carry over through the state cache, but uniforms set between recordings don't go through it
+    commands.forgetSamplers();
+    currentProgram = 0;
+    currentVAO = 0;
+    currentMaterial = nullptr;
+    std::fill(std::begin(boundTextures), std::end(boundTextures), 0u);
+
+    uploadInstanceData(commands);
+
+    size_t position = 0;
+    while (position < sortedIndices.size()) {
+        const DrawItem& item = items[sortedIndices[position]];
+
+        if (item.program != currentProgram) {
+            commands.useProgram(item.program);
+            currentProgram = item.program;
+            // Material uniforms live in the program, so they have to be resent
+            currentMaterial = nullptr;
+            frameStats.programBinds++;
+        } else {
+            frameStats.programBindsSaved++;
+        }
+
+        if (item.material != nullptr) {
+            if (item.material != currentMaterial) {
+                bindMaterial(commands, item);
+                currentMaterial = item.material;
+                frameStats.materialChanges++;
+            } else {
+                frameStats.materialChangesSaved++;
+            }
+        }
+
+        if (perDraw) perDraw(item, commands);
+
+        if (item.VAO != currentVAO) {
+            commands.bindVertexArray(item.VAO);
+            currentVAO = item.VAO;
+            frameStats.vaoBinds++;
+        } else {
+            frameStats.vaoBindsSaved++;
+        }
+
+        size_t batchEnd = position + 1;
+        if (supportsInstancing(item)) {
+            while (batchEnd < sortedIndices.size() && canBatch(item, items[sortedIndices[batchEnd]])) batchEnd++;
+
+            unsigned int instanceCount = batchEnd - position;
+            commands.setUint(item.program, getLocation(item, "instanceOffset"_u), position);
+            commands.setInt(item.program, getLocation(item, "useInstances"_u), 1);
+            commands.drawElements(GL_TRIANGLES, item.indexCount, item.firstIndex, item.baseVertex, instanceCount);
+
+            frameStats.instancedBatches++;
+            frameStats.instancesMerged += instanceCount - 1;
+        } else {
+            // Shaders that can read the instance block take the model uniform here
+            commands.setInt(item.program, getLocation(item, "useInstances"_u), 0);
+            commands.drawElements(GL_TRIANGLES, item.indexCount, item.firstIndex, item.baseVertex);
+        }
+        frameStats.drawCalls++;
+
+        position = batchEnd;
+    }
+}
+
+void RenderQueue::recordDepthOnly(CommandBuffer& commands, unsigned int program, const ProgramReflection* reflection,
+    const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw) {
+    if (sortedIndices.size() != items.size()) sort();
+
+    commands.useProgram(program);
+    currentProgram = program;
+    currentVAO = 0;
+    currentMaterial = nullptr;
+    frameStats.programBinds++;
+
+    // The pass after this one tests GL_EQUAL, so an item has to take the same path to gl_Position in
+    // both. Batches follow the items' own programs, which is how record will split them.
+    bool instanced = reflection != nullptr && reflection->hasInstanceBlock();
+    if (instanced) uploadInstanceData(commands);
+
+    size_t position = 0;
+    while (position < sortedIndices.size()) {
+        const DrawItem& source = items[sortedIndices[position]];
+        DrawItem item = source;
+        item.program = program;
+        item.reflection = reflection;
+        item.material = nullptr;
+
+        if (perDraw) perDraw(item, commands);
+
+        if (item.VAO != currentVAO) {
+            commands.bindVertexArray(item.VAO);
+            currentVAO = item.VAO;
+            frameStats.vaoBinds++;
+        } else {
+            frameStats.vaoBindsSaved++;
+        }
+
+        size_t batchEnd = position + 1;
+        if (instanced && supportsInstancing(source)) {
+            while (batchEnd < sortedIndices.size() && canBatch(source, items[sortedIndices[batchEnd]])) batchEnd++;
+
+            unsigned int instanceCount = batchEnd - position;
+            commands.setUint(program, getLocation(item, "instanceOffset"_u), position);
+            commands.setInt(program, getLocation(item, "useInstances"_u), 1);
+            commands.drawElements(GL_TRIANGLES, item.indexCount, item.firstIndex, item.baseVertex, instanceCount);
+
+            frameStats.instancedBatches++;
+            frameStats.instancesMerged += instanceCount - 1;
+        } else {
+            commands.setInt(program, getLocation(item, "useInstances"_u), 0);
+            commands.drawElements(GL_TRIANGLES, item.indexCount, item.firstIndex, item.baseVertex);
+        }
+        frameStats.drawCalls++;
+
+        position = batchEnd;
+    }
+}
+
+// Instance data follows the sorted order so a batch is a contiguous range starting at its index
+void RenderQueue::uploadInstanceData(CommandBuffer& commands) {
+    bool anyInstanced = false;
+    for (uint32_t index : sortedIndices) {
+        if (supportsInstancing(items[index])) {
+            anyInstanced = true;
+            break;
+        }
+    }
+    if (!anyInstanced) return;
+
+    instanceData.resize(sortedIndices.size());
+    for (size_t i = 0; i < sortedIndices.size(); i++) {
+        const DrawItem& item = items[sortedIndices[i]];
+        instanceData[i].modelMatrix = item.modelMatrix;
+        instanceData[i].color = item.color;
+    }
+    commands.uploadInstances(instanceData);
+}
+
+void RenderQueue::flush(const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw) {
+    commands.reset();
+    record(commands, perDraw);
+    commands.execute();
+}
+
+bool RenderQueue::supportsInstancing(const DrawItem& item) {
+    return item.reflection != nullptr && item.reflection->hasInstanceBlock();
+}
+
+int RenderQueue::getLocation(const DrawItem& item, UniformId id) {
+    return item.reflection != nullptr ? item.reflection->getLocation(id) : -1;
+}
+
+// Skinned meshes upload their bones per draw, so they always stay separate
+bool RenderQueue::canBatch(const DrawItem& first, const DrawItem& other) {
+    if (other.program != first.program || other.VAO != first.VAO || other.indexCount != first.indexCount) return false;
+    if (other.firstIndex != first.firstIndex || other.baseVertex != first.baseVertex) return false;
+    if (other.layerMask != first.layerMask) return false;
+    if (first.mesh != nullptr && !first.mesh->bone_data.empty()) return false;
+
+    if (first.material == nullptr || other.material == nullptr) return first.material == other.material;
+    return first.material->materialID == other.material->materialID;
+}
+
+void RenderQueue::bindMaterial(CommandBuffer& commands, const DrawItem& item) {
+    // Parameters live in the shared material buffer, which maps are present is baked into the program variant
+    const Material* material = item.material;
+    commands.setUint(item.program, getLocation(item, "materialIndex"_u), material->materialID);
+
+    for (unsigned int i = 0; i < material->textures.size() && i < MAX_QUEUE_TEXTURE_UNITS; i++) {
+        const Texture& texture = material->textures[i];
+        commands.setSampler(item.program, getLocation(item, UniformId(texture.type)), i);
+
+        if (boundTextures[i] != texture.id) {
+            commands.bindTexture(i, texture.id);
+            boundTextures[i] = texture.id;
+            frameStats.textureBinds++;
+        } else {
+            frameStats.textureBindsSaved++;
+        }
+    }
+}
+
+void RenderQueue::clear() {
+    items.clear();
+    sortedIndices.clear();
+}
+
+void RenderQueue::beginFrame() {
+    lastFrameStats = frameStats;
+    frameStats = RenderQueueStats();
+}
+
+void RenderQueue::addFrameStats(const RenderQueueStats& stats) {
+    frameStats.drawCalls += stats.drawCalls;
+    frameStats.programBinds += stats.programBinds;
+    frameStats.programBindsSaved += stats.programBindsSaved;
+    frameStats.vaoBinds += stats.vaoBinds;
+    frameStats.vaoBindsSaved += stats.vaoBindsSaved;
+    frameStats.textureBinds += stats.textureBinds;
+    frameStats.textureBindsSaved += stats.textureBindsSaved;
+    frameStats.materialChanges += stats.materialChanges;
+    frameStats.materialChangesSaved += stats.materialChangesSaved;
+    frameStats.instancedBatches += stats.instancedBatches;
+    frameStats.instancesMerged += stats.instancesMerged;
+}
+
+RenderQueueStats RenderQueue::takeFrameStats() {
+    RenderQueueStats stats = frameStats;
+    frameStats = RenderQueueStats();
+    return stats;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "utils/material.h"
+#include "utils/gl_instancing.h"
+#include "utils/gl_reflection.h"
+#include "utils/gl_command_buffer.h"
+#include "utils/shadow_culling.h"
+
+#define MAX_QUEUE_TEXTURE_UNITS 16
+
+class Model;
+struct Mesh;
+
+// Sort key layout, most significant first:
+// | pass (4) | program (12) | material (16) | geometry (16) | depth (16) |
+// Meshes in the geometry arena share a VAO, so the geometry bits come from the mesh's first index.
+enum RenderPassType {
+    PASS_SHADOW = 0,
+    PASS_DEPTH,
+    PASS_OPAQUE,
+    PASS_TRANSPARENT,
+    PASS_OVERLAY
+};
+
+struct DrawItem {
+    uint64_t sortKey;
+
+    unsigned int program;
+    // Locations and blocks of program, looked up while recording so no GL queries are needed
+    const ProgramReflection* reflection = nullptr;
+    unsigned int VAO;
+    unsigned int indexCount;
+    unsigned int firstIndex = 0;
+    int baseVertex = 0;
+
+    // Null when the pass doesn't need textures (shadow/depth passes)
+    const Material* material = nullptr;
+
+    glm::mat4 modelMatrix;
+    glm::vec4 color = glm::vec4(1.0f);
+    // Cascades or cube faces the item can cast into, layered shadow passes skip the rest
+    uint32_t layerMask = ALL_SHADOW_LAYERS;
+    Model* model = nullptr;
+    Mesh* mesh = nullptr;
+};
+
+struct RenderQueueStats {
+    unsigned int drawCalls = 0;
+
+    unsigned int programBinds = 0, programBindsSaved = 0;
+    unsigned int vaoBinds = 0, vaoBindsSaved = 0;
+    unsigned int textureBinds = 0, textureBindsSaved = 0;
+    unsigned int materialChanges = 0, materialChangesSaved = 0;
+    unsigned int instancedBatches = 0, instancesMerged = 0;
+};
+
+class RenderQueue {
+    public:
+        static uint64_t createSortKey(RenderPassType pass, unsigned int program, unsigned int materialID,
+            unsigned int geometry, float normalizedDepth);
+
+        void submit(const DrawItem& item);
+        void sort();
+
+        // Walks the sorted items and records only the state that differs from the previous item.
+        // perDraw runs right before each draw for uniforms that always change (model matrix, bones).
+        // Programs that declare an InstanceBlock get runs of items sharing VAO, material and mesh
+        // merged into one instanced draw, with perDraw called once for the first item.
+        // Makes no GL calls, so queues on different threads can record at the same time.
+        void record(CommandBuffer& commands, const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw = nullptr);
+        // Records the same items again through one program with no materials, for a depth pre-pass
+        // that reuses the culling and sorting of the pass after it. perDraw sees the items with
+        // program and reflection swapped. When program reads the InstanceBlock, items record batches
+        // in the same instanced draws so both passes compute the same gl_Position.
+        void recordDepthOnly(CommandBuffer& commands, unsigned int program, const ProgramReflection* reflection,
+            const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw = nullptr);
+        // Records into the queue's own command buffer and replays it right away
+        void flush(const std::function<void(const DrawItem&, CommandBuffer&)>& perDraw = nullptr);
+        void clear();
+
+        // Publishes the counters of the frame that just finished and starts a new one
+        void beginFrame();
+        // Folds in what a queue recorded on another thread, hand it takeFrameStats() from that queue
+        void addFrameStats(const RenderQueueStats& stats);
+        RenderQueueStats takeFrameStats();
+
+        size_t size() const { return items.size(); }
+        const RenderQueueStats& getLastFrameStats() const { return lastFrameStats; }
+
+    private:
+        std::vector<DrawItem> items;
+        std::vector<uint32_t> sortedIndices;
+        std::vector<uint32_t> scratchIndices;
+
+        RenderQueueStats frameStats;
+        RenderQueueStats lastFrameStats;
+
+        unsigned int currentProgram = 0;
+        unsigned int currentVAO = 0;
+        const Material* currentMaterial = nullptr;
+        unsigned int boundTextures[MAX_QUEUE_TEXTURE_UNITS];
+
+        CommandBuffer commands;
+        std::vector<InstanceData> instanceData;
+
+        void bindMaterial(CommandBuffer& commands, const DrawItem& item);
+        void uploadInstanceData(CommandBuffer& commands);
+        static bool supportsInstancing(const DrawItem& item);
+        static int getLocation(const DrawItem& item, UniformId id);
+        static bool canBatch(const DrawItem& first, const DrawItem& other);
+        void radixSort();
+};
@@ -0,0 +1,61 @@
+#include "gl_render_resolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+void RenderResolution::setWindowSize(int width, int height) {
+    // Minimized windows report zero, keep the last usable size
+    if (width <= 0 || height <= 0) return;
+    if (width == windowWidth && height == windowHeight) return;
+
+    windowWidth = width;
+    windowHeight = height;
+    updateRenderSize();
+}
+
+void RenderResolution::setScalingSupported(bool supported) {
+    scalingSupported = supported;
+    updateRenderSize();
+}
+
+void RenderResolution::setScale(float newScale) {
+    newScale = std::round(newScale / RESOLUTION_SCALE_STEP) * RESOLUTION_SCALE_STEP;
+    scale = std::clamp(newScale, minScale, maxScale);
+    framesSinceChange = 0;
+    updateRenderSize();
+}
+
+bool RenderResolution::update(float gpuMilliseconds) {
+    if (gpuMilliseconds > 0.0f) {
+        smoothedTime = smoothedTime == 0.0f ? gpuMilliseconds : smoothedTime * 0.9f + gpuMilliseconds * 0.1f;
+    }
+    framesSinceChange++;
+
+    if (isDynamic && scalingSupported && smoothedTime > 0.0f && framesSinceChange > RESOLUTION_COOLDOWN_FRAMES) {
+        // GPU time scales roughly with pixel count, which is the square of the scale
+        float targetScale = scale * std::sqrt(frameBudget / smoothedTime);
+
+        if (smoothedTime > frameBudget) {
+            setScale(std::min(targetScale, scale - RESOLUTION_SCALE_STEP));
+        } else if (smoothedTime < frameBudget * 0.85f && scale < maxScale) {
+            // Only one step up at a time, overshooting back over budget causes flicker
+            setScale(scale + RESOLUTION_SCALE_STEP);
+        }
+    }
+
+    bool changed = sizeChanged;
+    sizeChanged = false;
+    return changed;
+}
+
+void RenderResolution::updateRenderSize() {
+    float appliedScale = scalingSupported ? scale : 1.0f;
+    int width = std::max(1, (int) (windowWidth * appliedScale));
+    int height = std::max(1, (int) (windowHeight * appliedScale));
+
+    if (width != renderWidth || height != renderHeight) {
+        renderWidth = width;
+        renderHeight = height;
+        sizeChanged = true;
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#define DEFAULT_FRAME_BUDGET_MS 16.6f
+#define RESOLUTION_SCALE_STEP 0.05f
+// Frames to wait after a change before the scale can move again, targets get recreated each time
+#define RESOLUTION_COOLDOWN_FRAMES 30
+
+// Tracks the window size and the internal size engines render at. With dynamic scaling on,
+// the internal size follows the measured GPU frame time toward the frame budget and the
+// engine upscales to the window when compositing.
+class RenderResolution {
+    public:
+        void setWindowSize(int width, int height);
+
+        // Feeds the last GPU frame time to the scale controller.
+        // True when the render size changed and size dependent targets need recreating.
+        bool update(float gpuMilliseconds);
+
+        // Engines that don't composite to the window always render at scale 1
+        void setScalingSupported(bool supported);
+        void setDynamic(bool dynamic) { isDynamic = dynamic; }
+        void setScale(float newScale);
+
+        int getWindowWidth() const { return windowWidth; }
+        int getWindowHeight() const { return windowHeight; }
+        int getRenderWidth() const { return renderWidth; }
+        int getRenderHeight() const { return renderHeight; }
+        float getScale() const { return scale; }
+        float getSmoothedFrameTime() const { return smoothedTime; }
+        bool getDynamic() const { return isDynamic; }
+        bool getScalingSupported() const { return scalingSupported; }
+
+        float frameBudget = DEFAULT_FRAME_BUDGET_MS;
+        float minScale = 0.5f, maxScale = 1.0f;
+
+    private:
+        int windowWidth = 1920, windowHeight = 1080;
+        int renderWidth = 1920, renderHeight = 1080;
+
+        float scale = 1.0f;
+        bool isDynamic = false;
+        bool scalingSupported = false;
+        bool sizeChanged = false;
+
+        float smoothedTime = 0.0f;
+        unsigned int framesSinceChange = 0;
+
+        void updateRenderSize();
+};
@@ -0,0 +1,228 @@
+#include "gl_resources.h"
+#include "gl_state.h"
+
+#include <algorithm>
+#include <iostream>
+
+static const char* categoryNames[RESOURCE_CATEGORY_COUNT] = {
+    "Textures", "Buffers", "Framebuffers", "Renderbuffers", "Vertex Arrays"
+};
+
+const char* getResourceCategoryName(ResourceCategory category) {
+    return categoryNames[category];
+}
+
+// Unsized and three component formats get the padded size drivers usually allocate
+static size_t getBytesPerTexel(GLenum format) {
+    switch (format) {
+        case GL_R8: return 1;
+        case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+        case GL_RGB8: case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RG16F: case GL_RG16:
+        case GL_R32F: case GL_R32UI: case GL_R11F_G11F_B10F: case GL_RGB10_A2:
+        case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8: return 4;
+        case GL_RGB16F: case GL_RGBA16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+        case GL_RGB32F: case GL_RGBA32F: return 16;
+        default: return 4;
+    }
+}
+
+ResourceRegistry& ResourceRegistry::get() {
+    static ResourceRegistry registry;
+    return registry;
+}
+
+size_t ResourceRegistry::estimateTextureSize(GLenum target, GLenum format, int width, int height, int depth, int levels) {
+    size_t texelSize = getBytesPerTexel(format);
+    bool isVolume = target == GL_TEXTURE_3D;
+
+    size_t size = 0;
+    for (int level = 0; level < std::max(levels, 1); level++) {
+        size_t levelWidth = std::max(width >> level, 1);
+        size_t levelHeight = std::max(height >> level, 1);
+        size_t levelDepth = isVolume ? std::max(depth >> level, 1) : std::max(depth, 1);
+        size += levelWidth * levelHeight * levelDepth * texelSize;
+    }
+    return size;
+}
+
+void ResourceRegistry::trackTexture(unsigned int id, GLenum target, GLenum format, int width, int height,
+    int depth, int levels, const std::string& name) {
+    ResourceDesc desc;
+    desc.category = RESOURCE_TEXTURE;
+    desc.name = name;
+    desc.target = target;
+    desc.format = format;
+    desc.width = width;
+    desc.height = height;
+    desc.depth = depth;
+    desc.levels = levels;
+    desc.size = estimateTextureSize(target, format, width, height, depth, levels);
+    track(id, desc);
+}
+
+void ResourceRegistry::trackBuffer(unsigned int id, size_t size, unsigned int usage, const std::string& name) {
+    ResourceDesc desc;
+    desc.category = RESOURCE_BUFFER;
+    desc.name = name;
+    desc.size = size;
+    desc.usage = usage;
+    track(id, desc);
+}
+
+void ResourceRegistry::trackRenderbuffer(unsigned int id, GLenum format, int width, int height, const std::string& name) {
+    ResourceDesc desc;
+    desc.category = RESOURCE_RENDERBUFFER;
+    desc.name = name;
+    desc.format = format;
+    desc.width = width;
+    desc.height = height;
+    desc.size = (size_t) width * height * getBytesPerTexel(format);
+    track(id, desc);
+}
+
+void ResourceRegistry::trackFramebuffer(unsigned int id, const std::string& name) {
+    ResourceDesc desc;
+    desc.category = RESOURCE_FRAMEBUFFER;
+    desc.name = name;
+    track(id, desc);
+}
+
+void ResourceRegistry::trackVertexArray(unsigned int id, const std::string& name) {
+    ResourceDesc desc;
+    desc.category = RESOURCE_VERTEX_ARRAY;
+    desc.name = name;
+    track(id, desc);
+}
+
+void ResourceRegistry::track(unsigned int id, const ResourceDesc& desc) {
+    if (id == 0) return;
+
+    uint64_t key = makeKey(desc.category, id);
+    auto it = resources.find(key);
+    if (it != resources.end()) {
+        // Same name tracked again (storage recreated in place), replace the old entry
+        totals[desc.category].count--;
+        totals[desc.category].bytes -= it->second.size;
+        totalBytes -= it->second.size;
+    }
+
+    resources[key] = desc;
+    totals[desc.category].count++;
+    totals[desc.category].bytes += desc.size;
+    totalBytes += desc.size;
+
+    if (budget != 0 && totalBytes > budget && desc.size > 0) {
+        std::cout << "WARNING::RESOURCES::OVER_BUDGET " << getResourceCategoryName(desc.category) << " "
+            << (desc.name.empty() ? std::to_string(id) : desc.name) << " (" << desc.size / 1024 << " KB) brings total to "
+            << totalBytes / (1024 * 1024) << " MB of " << budget / (1024 * 1024) << " MB" << std::endl;
+    }
+}
+
+void ResourceRegistry::release(ResourceCategory category, unsigned int id) {
+    if (id == 0) return;
+
+    PendingDelete resource;
+    resource.category = category;
+    resource.id = id;
+    releasedThisFrame.push_back(resource);
+}
+
+void ResourceRegistry::flush() {
+    collect();
+    glFinish();
+    collect();
+}
+
+void ResourceRegistry::collect() {
+    if (!releasedThisFrame.empty()) {
+        Retirement retirement;
+        retirement.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        retirement.resources.swap(releasedThisFrame);
+        retirements.push_back(std::move(retirement));
+    }
+
+    // Fences signal in order, so stop at the first one that hasn't
+    while (!retirements.empty()) {
+        Retirement& retirement = retirements.front();
+        GLenum result = glClientWaitSync(retirement.fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) break;
+
+        for (const PendingDelete& resource : retirement.resources) destroy(resource);
+        glDeleteSync(retirement.fence);
+        retirements.pop_front();
+    }
+}
+
+void ResourceRegistry::destroy(const PendingDelete& resource) {
+    // GL unbinds deleted objects behind the state cache's back
+    GLState& state = GLState::get();
+    switch (resource.category) {
+        case RESOURCE_TEXTURE: glDeleteTextures(1, &resource.id); state.forgetTexture(resource.id); break;
+        case RESOURCE_BUFFER: glDeleteBuffers(1, &resource.id); state.forgetBuffer(resource.id); break;
+        case RESOURCE_FRAMEBUFFER: glDeleteFramebuffers(1, &resource.id); state.forgetFramebuffer(resource.id); break;
+        case RESOURCE_RENDERBUFFER: glDeleteRenderbuffers(1, &resource.id); break;
+        case RESOURCE_VERTEX_ARRAY: glDeleteVertexArrays(1, &resource.id); state.forgetVertexArray(resource.id); break;
+        default: break;
+    }
+
+    auto it = resources.find(makeKey(resource.category, resource.id));
+    if (it == resources.end()) return;
+
+    totals[resource.category].count--;
+    totals[resource.category].bytes -= it->second.size;
+    totalBytes -= it->second.size;
+    resources.erase(it);
+}
+
+const ResourceDesc* ResourceRegistry::find(ResourceCategory category, unsigned int id) const {
+    auto it = resources.find(makeKey(category, id));
+    return it != resources.end() ? &it->second : nullptr;
+}
+
+ResourceStats ResourceRegistry::getStats() const {
+    ResourceStats stats;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) stats.categories[i] = totals[i];
+    stats.totalBytes = totalBytes;
+    stats.budget = budget;
+
+    auto countPending = [&](const std::vector<PendingDelete>& pending) {
+        for (const PendingDelete& resource : pending) {
+            stats.pendingDeletes++;
+            const ResourceDesc* desc = find(resource.category, resource.id);
+            if (desc != nullptr) stats.pendingBytes += desc->size;
+        }
+    };
+    countPending(releasedThisFrame);
+    for (const Retirement& retirement : retirements) countPending(retirement.resources);
+
+    return stats;
+}
+
+namespace glutil {
+    BufferHandle createBuffer(size_t size, const void* data, GLenum usage, const std::string& name) {
+        unsigned int buffer;
+        glCreateBuffers(1, &buffer);
+        glNamedBufferData(buffer, size, data, usage);
+        ResourceRegistry::get().trackBuffer(buffer, size, usage, name);
+
+        return BufferHandle(buffer);
+    }
+
+    FramebufferHandle createFramebuffer(const std::string& name) {
+        unsigned int framebuffer;
+        glCreateFramebuffers(1, &framebuffer);
+        ResourceRegistry::get().trackFramebuffer(framebuffer, name);
+
+        return FramebufferHandle(framebuffer);
+    }
+
+    RenderbufferHandle createRenderbuffer(GLenum format, int width, int height, const std::string& name) {
+        unsigned int renderbuffer;
+        glCreateRenderbuffers(1, &renderbuffer);
+        glNamedRenderbufferStorage(renderbuffer, format, width, height);
+        ResourceRegistry::get().trackRenderbuffer(renderbuffer, format, width, height, name);
+
+        return RenderbufferHandle(renderbuffer);
+    }
+};
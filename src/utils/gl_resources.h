@@ -0,0 +1,160 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define DEFAULT_RESOURCE_BUDGET ((size_t) 2048 * 1024 * 1024)
+
+enum ResourceCategory {
+    RESOURCE_TEXTURE = 0,
+    RESOURCE_BUFFER,
+    RESOURCE_FRAMEBUFFER,
+    RESOURCE_RENDERBUFFER,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_CATEGORY_COUNT
+};
+
+const char* getResourceCategoryName(ResourceCategory category);
+
+struct ResourceDesc {
+    ResourceCategory category = RESOURCE_BUFFER;
+    std::string name;
+
+    // Estimated from the format for textures and renderbuffers, zero for FBOs and VAOs
+    size_t size = 0;
+    // Internal format for textures/renderbuffers, texture target in target
+    GLenum format = GL_NONE;
+    GLenum target = GL_NONE;
+    // Buffer usage hint (glNamedBufferData) or storage flags (glNamedBufferStorage)
+    unsigned int usage = 0;
+    int width = 0, height = 0, depth = 0, levels = 0;
+};
+
+struct ResourceCategoryStats {
+    unsigned int count = 0;
+    size_t bytes = 0;
+};
+
+struct ResourceStats {
+    ResourceCategoryStats categories[RESOURCE_CATEGORY_COUNT];
+    size_t totalBytes = 0;
+    size_t budget = 0;
+
+    unsigned int pendingDeletes = 0;
+    size_t pendingBytes = 0;
+};
+
+// Every GL object the engines create is recorded here with its size so VRAM use can be
+// reported per category. Deleting goes through release, which holds the object until a
+// fence placed after its last frame of use has signalled, since draws in flight and
+// resident bindless handles can still reference it.
+class ResourceRegistry {
+    public:
+        static ResourceRegistry& get();
+
+        void trackTexture(unsigned int id, GLenum target, GLenum format, int width, int height,
+            int depth = 1, int levels = 1, const std::string& name = "");
+        void trackBuffer(unsigned int id, size_t size, unsigned int usage, const std::string& name = "");
+        void trackRenderbuffer(unsigned int id, GLenum format, int width, int height, const std::string& name = "");
+        void trackFramebuffer(unsigned int id, const std::string& name = "");
+        void trackVertexArray(unsigned int id, const std::string& name = "");
+
+        // Queues the object for deletion, it stays counted until it is actually deleted
+        void release(ResourceCategory category, unsigned int id);
+
+        // Called once per frame, fences this frame's releases and deletes the ones that are done
+        void collect();
+        // Waits for the GPU and deletes everything released so far, for shutdown
+        void flush();
+
+        void setBudget(size_t bytes) { budget = bytes; }
+        size_t getBudget() const { return budget; }
+
+        const ResourceDesc* find(ResourceCategory category, unsigned int id) const;
+        ResourceStats getStats() const;
+
+        static size_t estimateTextureSize(GLenum target, GLenum format, int width, int height, int depth, int levels);
+
+    private:
+        struct PendingDelete {
+            ResourceCategory category;
+            unsigned int id;
+        };
+        struct Retirement {
+            GLsync fence;
+            std::vector<PendingDelete> resources;
+        };
+
+        std::unordered_map<uint64_t, ResourceDesc> resources;
+        std::vector<PendingDelete> releasedThisFrame;
+        std::deque<Retirement> retirements;
+
+        ResourceCategoryStats totals[RESOURCE_CATEGORY_COUNT];
+        size_t totalBytes = 0;
+        size_t budget = DEFAULT_RESOURCE_BUDGET;
+
+        void track(unsigned int id, const ResourceDesc& desc);
+        void destroy(const PendingDelete& resource);
+
+        static uint64_t makeKey(ResourceCategory category, unsigned int id) {
+            return ((uint64_t) category << 32) | id;
+        }
+};
+
+// Move only owner of a single GL object, handing it to the registry when it goes out of scope.
+// Converts to the raw name so it can be passed straight to GL calls.
+template <ResourceCategory Category>
+class GLHandle {
+    public:
+        GLHandle() {}
+        explicit GLHandle(unsigned int id) : id(id) {}
+        ~GLHandle() { reset(); }
+
+        GLHandle(const GLHandle&) = delete;
+        GLHandle& operator=(const GLHandle&) = delete;
+
+        GLHandle(GLHandle&& other) noexcept : id(other.id) { other.id = 0; }
+        GLHandle& operator=(GLHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                id = other.id;
+                other.id = 0;
+            }
+            return *this;
+        }
+
+        void reset(unsigned int newID = 0) {
+            if (id != 0) ResourceRegistry::get().release(Category, id);
+            id = newID;
+        }
+
+        // Gives up ownership without deleting anything
+        unsigned int detach() {
+            unsigned int detached = id;
+            id = 0;
+            return detached;
+        }
+
+        unsigned int get() const { return id; }
+        operator unsigned int() const { return id; }
+
+    private:
+        unsigned int id = 0;
+};
+
+using TextureHandle = GLHandle<RESOURCE_TEXTURE>;
+using BufferHandle = GLHandle<RESOURCE_BUFFER>;
+using FramebufferHandle = GLHandle<RESOURCE_FRAMEBUFFER>;
+using RenderbufferHandle = GLHandle<RESOURCE_RENDERBUFFER>;
+using VertexArrayHandle = GLHandle<RESOURCE_VERTEX_ARRAY>;
+
+namespace glutil {
+    BufferHandle createBuffer(size_t size, const void* data, GLenum usage, const std::string& name = "");
+    FramebufferHandle createFramebuffer(const std::string& name = "");
+    RenderbufferHandle createRenderbuffer(GLenum format, int width, int height, const std::string& name = "");
+};
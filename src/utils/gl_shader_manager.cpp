@@ -0,0 +1,240 @@
+#include "gl_shader_manager.h"
+#include "gl_compute.h"
+#include "shader.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+
+ShaderManager& ShaderManager::get() {
+    static ShaderManager manager;
+    return manager;
+}
+
+void ShaderManager::load(Shader& target, const char* vertexPath, const char* fragmentPath,
+    const char* geoPath, ShaderFeatures features) {
+    target.ID = 0;
+    target.features = features;
+
+    ProgramEntry entry;
+    entry.stages.push_back({ GL_VERTEX_SHADER, vertexPath });
+    entry.stages.push_back({ GL_FRAGMENT_SHADER, fragmentPath });
+    if (geoPath != nullptr) entry.stages.push_back({ GL_GEOMETRY_SHADER, geoPath });
+    entry.features = features;
+    entry.assign = [&target](unsigned int program) { target.setProgram(program); };
+    add(std::move(entry));
+}
+
+void ShaderManager::load(ComputeShader& target, const std::string& computePath) {
+    target.ID = 0;
+
+    ProgramEntry entry;
+    entry.stages.push_back({ GL_COMPUTE_SHADER, computePath });
+    entry.assign = [&target](unsigned int program) { target.setProgram(program); };
+    add(std::move(entry));
+}
+
+void ShaderManager::add(ProgramEntry entry) {
+    if (batchSize == 0) batchStart = std::chrono::steady_clock::now();
+    batchSize++;
+
+    entries.push_back(std::move(entry));
+    stats.programs = entries.size();
+    build(entries.size() - 1);
+}
+
+void ShaderManager::build(size_t entry) {
+    entries[entry].building = true;
+
+    jobs.emplace_back();
+    BuildJob& job = jobs.back();
+    job.entry = entry;
+
+    // The entry can move when more are added, so the worker gets its own copy of the paths
+    std::vector<StagePath> stages = entries[entry].stages;
+    ShaderFeatures features = entries[entry].features;
+    job.preprocessed = ThreadPool::get().submit([&job, stages, features]() {
+        preprocess(job, stages, features);
+    });
+}
+
+void ShaderManager::preprocess(BuildJob& job, const std::vector<StagePath>& stages, ShaderFeatures features) {
+    ShaderPreprocessor preprocessor;
+    job.succeeded = true;
+
+    for (const StagePath& stage : stages) {
+        std::string source;
+        job.succeeded &= preprocessor.process(stage.path, features, source);
+        job.sources.push_back({ stage.type, stage.path, std::move(source) });
+        for (const std::string& file : preprocessor.getFiles()) job.files.push_back(file);
+    }
+
+    job.lastWrite = std::filesystem::file_time_type::min();
+    for (const std::string& file : job.files) {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(file, error);
+        if (!error && time > job.lastWrite) job.lastWrite = time;
+    }
+}
+
+void ShaderManager::finish() {
+    advance(true);
+
+    if (batchSize > 0) {
+        std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - batchStart;
+        stats.lastBatchSize = batchSize;
+        stats.lastBatchMilliseconds = elapsed.count();
+        batchSize = 0;
+    }
+}
+
+void ShaderManager::update() {
+    advance(false);
+
+    if (hotReload && ++framesSinceWatch >= SHADER_WATCH_INTERVAL_FRAMES) {
+        framesSinceWatch = 0;
+        checkFiles();
+    }
+}
+
+void ShaderManager::advance(bool blocking) {
+    ProgramCache& cache = ProgramCache::get();
+
+    // Every compile is issued before any is waited on, otherwise the driver only ever has one to work on
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        BuildJob& job = *it;
+        if (job.compiling) {
+            it++;
+            continue;
+        }
+
+        if (!blocking && job.preprocessed.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            it++;
+            continue;
+        }
+        job.preprocessed.get();
+
+        unsigned int program = job.succeeded ? cache.findProgram(job.sources) : 0;
+        if (program != 0 || !job.succeeded) {
+            complete(job, program);
+            it = jobs.erase(it);
+            continue;
+        }
+
+        job.pending = cache.beginCompile(job.sources);
+        job.compiling = true;
+        it++;
+    }
+
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        BuildJob& job = *it;
+        if (!job.compiling || (!blocking && !cache.isComplete(job.pending))) {
+            it++;
+            continue;
+        }
+
+        unsigned int program = cache.finishCompile(job.pending);
+        complete(job, program);
+        it = jobs.erase(it);
+    }
+
+    stats.pending = jobs.size();
+}
+
+void ShaderManager::complete(const BuildJob& job, unsigned int program) {
+    ProgramEntry& entry = entries[job.entry];
+    entry.building = false;
+    entry.files = job.files;
+    entry.lastWrite = job.lastWrite;
+
+    if (program == 0) {
+        // A broken edit leaves the last good program in place
+        if (entry.program != 0) {
+            std::cout << "WARNING::SHADER_MANAGER::RELOAD_FAILED keeping the previous " << entry.stages.back().path << std::endl;
+            stats.failedReloads++;
+        }
+        return;
+    }
+
+    unsigned int previous = entry.program;
+    if (program == previous) {
+        // Touched without changing anything that ends up in the sources
+        ProgramCache::get().release(program);
+        return;
+    }
+
+    if (previous != 0) {
+        copyUniforms(previous, program);
+        stats.reloads++;
+    }
+
+    entry.program = program;
+    entry.assign(program);
+    if (previous != 0) ProgramCache::get().release(previous);
+}
+
+void ShaderManager::checkFiles() {
+    // Programs share includes, so each file is only looked at once per check
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        ProgramEntry& entry = entries[i];
+        if (entry.building) continue;
+
+        bool changed = false;
+        for (const std::string& file : entry.files) {
+            auto it = writeTimes.find(file);
+            if (it == writeTimes.end()) {
+                std::error_code error;
+                std::filesystem::file_time_type time = std::filesystem::last_write_time(file, error);
+                it = writeTimes.emplace(file, error ? std::filesystem::file_time_type::min() : time).first;
+            }
+            changed |= it->second > entry.lastWrite;
+        }
+
+        if (changed) build(i);
+    }
+}
+
+// Values set once at init (sampler units, constants) would otherwise be lost on reload
+void ShaderManager::copyUniforms(unsigned int from, unsigned int to) {
+    ProgramReflection previous, next;
+    previous.reflect(from);
+    next.reflect(to);
+
+    for (const UniformInfo& uniform : next.getUniforms()) {
+        // The base name of an array already copies every element
+        if (uniform.isElement) continue;
+
+        const UniformInfo* source = previous.findUniform(UniformId(uniform.hash));
+        if (source == nullptr || source->type != uniform.type) continue;
+
+        float floats[16];
+        int ints[4];
+        unsigned int uints[4];
+        int count = std::min(uniform.size, source->size);
+        // Array elements have consecutive locations
+        for (int element = 0; element < count; element++) {
+            int fromLocation = source->location + element, toLocation = uniform.location + element;
+            switch (uniform.type) {
+                case GL_FLOAT: glGetUniformfv(from, fromLocation, floats); glProgramUniform1fv(to, toLocation, 1, floats); break;
+                case GL_FLOAT_VEC2: glGetUniformfv(from, fromLocation, floats); glProgramUniform2fv(to, toLocation, 1, floats); break;
+                case GL_FLOAT_VEC3: glGetUniformfv(from, fromLocation, floats); glProgramUniform3fv(to, toLocation, 1, floats); break;
+                case GL_FLOAT_VEC4: glGetUniformfv(from, fromLocation, floats); glProgramUniform4fv(to, toLocation, 1, floats); break;
+                case GL_FLOAT_MAT2: glGetUniformfv(from, fromLocation, floats); glProgramUniformMatrix2fv(to, toLocation, 1, GL_FALSE, floats); break;
+                case GL_FLOAT_MAT3: glGetUniformfv(from, fromLocation, floats); glProgramUniformMatrix3fv(to, toLocation, 1, GL_FALSE, floats); break;
+                case GL_FLOAT_MAT4: glGetUniformfv(from, fromLocation, floats); glProgramUniformMatrix4fv(to, toLocation, 1, GL_FALSE, floats); break;
+                case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, fromLocation, ints); glProgramUniform2iv(to, toLocation, 1, ints); break;
+                case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, fromLocation, ints); glProgramUniform3iv(to, toLocation, 1, ints); break;
+                case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, fromLocation, ints); glProgramUniform4iv(to, toLocation, 1, ints); break;
+                case GL_UNSIGNED_INT: glGetUniformuiv(from, fromLocation, uints); glProgramUniform1uiv(to, toLocation, 1, uints); break;
+                case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, fromLocation, uints); glProgramUniform2uiv(to, toLocation, 1, uints); break;
+                case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, fromLocation, uints); glProgramUniform3uiv(to, toLocation, 1, uints); break;
+                case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, fromLocation, uints); glProgramUniform4uiv(to, toLocation, 1, uints); break;
+                // Ints, bools, samplers and images
+                default: glGetUniformiv(from, fromLocation, ints); glProgramUniform1iv(to, toLocation, 1, ints); break;
+            }
+        }
+    }
+}
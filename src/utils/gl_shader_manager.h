@@ -0,0 +1,108 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "gl_program_cache.h"
+#include "gl_shader_preprocessor.h"
+
+// How often update looks at the watched files' modification times
+#define SHADER_WATCH_INTERVAL_FRAMES 30
+
+class Shader;
+class ComputeShader;
+
+struct ShaderManagerStats {
+    unsigned int programs = 0;
+    unsigned int pending = 0;
+    unsigned int reloads = 0;
+    unsigned int failedReloads = 0;
+
+    // Programs loaded since the previous finish and the wall time until they were all linked
+    unsigned int lastBatchSize = 0;
+    float lastBatchMilliseconds = 0.0f;
+};
+
+// Owns building every program an engine loads. load only queues the work: reading and
+// preprocessing the files runs on the ThreadPool, and the compiles are issued as soon as the
+// sources are ready so a driver with parallel compile builds them all at once. finish blocks
+// until the batch is linked and assigned to its targets.
+//
+// Once a frame update polls the files each program was built from. A change rebuilds the
+// program in the background and only swaps it in once it linked, so a typo in a shader keeps
+// the old program running. Default block uniform values are carried over to the new program.
+class ShaderManager {
+    public:
+        static ShaderManager& get();
+
+        // Paths are relative to SHADER_ROOT_PATH. The target has to outlive the manager's use of it,
+        // which engine members and ShaderVariants entries do.
+        void load(Shader& target, const char* vertexPath, const char* fragmentPath,
+            const char* geoPath = nullptr, ShaderFeatures features = 0);
+        void load(ComputeShader& target, const std::string& computePath);
+
+        void finish();
+        // Called once per frame on the GL thread
+        void update();
+
+        bool hotReload = true;
+
+        const ShaderManagerStats& getStats() const { return stats; }
+
+    private:
+        struct StagePath {
+            GLenum type;
+            std::string path;
+        };
+
+        struct ProgramEntry {
+            std::vector<StagePath> stages;
+            ShaderFeatures features = 0;
+            std::function<void(unsigned int)> assign;
+
+            unsigned int program = 0;
+            bool building = false;
+
+            // Every file the last build read, includes too, and the newest write time among them
+            std::vector<std::string> files;
+            std::filesystem::file_time_type lastWrite;
+        };
+
+        // Filled on a worker, read on the GL thread once preprocessed is ready
+        struct BuildJob {
+            size_t entry;
+            std::future<void> preprocessed;
+            bool succeeded = false;
+            std::vector<ShaderStageSource> sources;
+            std::vector<std::string> files;
+            std::filesystem::file_time_type lastWrite;
+
+            bool compiling = false;
+            PendingProgram pending;
+        };
+
+        std::vector<ProgramEntry> entries;
+        std::list<BuildJob> jobs;
+        unsigned int framesSinceWatch = 0;
+
+        unsigned int batchSize = 0;
+        std::chrono::steady_clock::time_point batchStart;
+        ShaderManagerStats stats;
+
+        void add(ProgramEntry entry);
+        void build(size_t entry);
+        // Starts compiles for preprocessed jobs and completes linked ones. Blocking waits for all of them.
+        void advance(bool blocking);
+        void complete(const BuildJob& job, unsigned int program);
+        void checkFiles();
+
+        static void preprocess(BuildJob& job, const std::vector<StagePath>& stages, ShaderFeatures features);
+        static void copyUniforms(unsigned int from, unsigned int to);
+};
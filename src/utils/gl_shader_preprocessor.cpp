@@ -0,0 +1,93 @@
+#include "gl_shader_preprocessor.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static const char* featureDefines[NUM_SHADER_FEATURES] = {
+    "HAS_NORMAL_MAP", "HAS_METALLIC_MAP", "FRAG_NORMAL_FUNCTION"
+};
+
+const char* getShaderFeatureDefine(unsigned int featureIndex) {
+    return featureDefines[featureIndex];
+}
+
+bool ShaderPreprocessor::process(const std::string& path, ShaderFeatures shaderFeatures, std::string& source) {
+    files.clear();
+    included.clear();
+    features = shaderFeatures;
+
+    source.clear();
+    return expand(std::filesystem::path(SHADER_ROOT_PATH + path).lexically_normal().string(), source, true);
+}
+
+bool ShaderPreprocessor::readFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+bool ShaderPreprocessor::expand(const std::string& path, std::string& source, bool isRoot) {
+    if (included.count(path) != 0) return true;
+    included.insert(path);
+
+    std::string contents;
+    if (!readFile(path, contents)) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << std::endl;
+        return false;
+    }
+
+    int fileIndex = files.size();
+    files.push_back(path);
+    if (!isRoot) source += "#line 1 " + std::to_string(fileIndex) + "\n";
+
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    std::istringstream lines(contents);
+    std::string line;
+    int lineNumber = 0;
+    bool ok = true;
+
+    while (std::getline(lines, line)) {
+        lineNumber++;
+
+        size_t start = line.find_first_not_of(" \t");
+        std::string trimmed = start == std::string::npos ? "" : line.substr(start);
+
+        if (trimmed.compare(0, 8, "#include") == 0) {
+            size_t open = trimmed.find('"');
+            size_t close = open == std::string::npos ? open : trimmed.find('"', open + 1);
+            if (close == std::string::npos) {
+                std::cout << "ERROR::SHADER::MALFORMED_INCLUDE " << path << ":" << lineNumber << std::endl;
+                ok = false;
+                continue;
+            }
+
+            std::string name = trimmed.substr(open + 1, close - open - 1);
+            std::filesystem::path includePath = (directory / name).lexically_normal();
+            if (!std::filesystem::exists(includePath)) {
+                includePath = std::filesystem::path(SHADER_ROOT_PATH + name).lexically_normal();
+            }
+
+            ok &= expand(includePath.string(), source, false);
+            source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+            continue;
+        }
+
+        source += line + "\n";
+
+        // Defines have to come after #version, which must be the first statement
+        if (isRoot && trimmed.compare(0, 8, "#version") == 0) {
+            for (unsigned int i = 0; i < NUM_SHADER_FEATURES; i++) {
+                if (features & (1u << i)) source += std::string("#define ") + featureDefines[i] + "\n";
+            }
+            source += "#line " + std::to_string(lineNumber + 1) + " 0\n";
+        }
+    }
+
+    return ok;
+}
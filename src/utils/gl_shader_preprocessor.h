@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#define SHADER_ROOT_PATH "../../shaders/"
+
+// Each set bit picks a specialized variant of a program, compiled with the matching #define
+enum ShaderFeature : unsigned int {
+    SHADER_FEATURE_NORMAL_MAP = (1u << 0),
+    SHADER_FEATURE_METALLIC_MAP = (1u << 1),
+    SHADER_FEATURE_FRAG_NORMALS = (1u << 2),
+    NUM_SHADER_FEATURES = 3
+};
+typedef unsigned int ShaderFeatures;
+
+// HAS_NORMAL_MAP, HAS_METALLIC_MAP, FRAG_NORMAL_FUNCTION
+const char* getShaderFeatureDefine(unsigned int featureIndex);
+
+// Expands #include "file" (relative to the including file, then to SHADER_ROOT_PATH) and adds a
+// #define after #version for every feature bit. Every file is pasted at most once per stage, so
+// includes don't need guards. #line directives keep compile errors pointing at the right line,
+// with the source string number being the file's position in getFiles().
+class ShaderPreprocessor {
+    public:
+        // path is relative to SHADER_ROOT_PATH. False when it or one of its includes can't be read.
+        bool process(const std::string& path, ShaderFeatures features, std::string& source);
+
+        const std::vector<std::string>& getFiles() const { return files; }
+
+    private:
+        std::vector<std::string> files;
+        std::unordered_set<std::string> included;
+        ShaderFeatures features = 0;
+
+        bool expand(const std::string& path, std::string& source, bool isRoot);
+        static bool readFile(const std::string& path, std::string& contents);
+};
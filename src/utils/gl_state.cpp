@@ -0,0 +1,243 @@
+#include "gl_state.h"
+
+#include <algorithm>
+#include <iterator>
+
+static const char* stateCallNames[STATE_CALL_COUNT] = {
+    "Programs", "Vertex Arrays", "Textures", "Framebuffers", "Viewports",
+    "Enable/Disable", "Blend", "Depth", "Cull", "Samplers", "Buffers"
+};
+
+const char* getStateCallName(StateCallType type) {
+    return stateCallNames[type];
+}
+
+GLState& GLState::get() {
+    static GLState state;
+    return state;
+}
+
+bool GLState::useProgram(unsigned int newProgram) {
+    if (!count(STATE_PROGRAM, newProgram != program)) return false;
+
+    glUseProgram(newProgram);
+    program = newProgram;
+    return true;
+}
+
+bool GLState::bindVertexArray(unsigned int newVAO) {
+    if (!count(STATE_VERTEX_ARRAY, newVAO != VAO)) return false;
+
+    glBindVertexArray(newVAO);
+    VAO = newVAO;
+    return true;
+}
+
+bool GLState::bindTextureUnit(unsigned int unit, unsigned int texture) {
+    if (unit >= MAX_STATE_TEXTURE_UNITS) {
+        count(STATE_TEXTURE, true);
+        glBindTextureUnit(unit, texture);
+        return true;
+    }
+
+    // Unbinding through the unit clears every target, so it's only redundant after another unit unbind
+    TextureBinding& binding = textures[unit];
+    bool redundant = binding.texture == texture && (texture != 0 || binding.target == GL_NONE);
+    if (!count(STATE_TEXTURE, !redundant)) return false;
+
+    glBindTextureUnit(unit, texture);
+    binding.texture = texture;
+    binding.target = GL_NONE;
+    return true;
+}
+
+bool GLState::bindTexture(unsigned int unit, GLenum target, unsigned int texture) {
+    if (unit < MAX_STATE_TEXTURE_UNITS) {
+        const TextureBinding& binding = textures[unit];
+        bool redundant = binding.texture == texture && (binding.target == target || (texture != 0 && binding.target == GL_NONE));
+        if (!count(STATE_TEXTURE, !redundant)) return false;
+    } else {
+        count(STATE_TEXTURE, true);
+    }
+
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(target, texture);
+
+    if (unit < MAX_STATE_TEXTURE_UNITS) {
+        textures[unit].texture = texture;
+        textures[unit].target = target;
+    }
+    return true;
+}
+
+bool GLState::bindFramebuffer(unsigned int newFramebuffer) {
+    if (!count(STATE_FRAMEBUFFER, newFramebuffer != framebuffer)) return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, newFramebuffer);
+    framebuffer = newFramebuffer;
+    return true;
+}
+
+bool GLState::viewport(int x, int y, int width, int height) {
+    bool changed = viewportRect[0] != x || viewportRect[1] != y || viewportRect[2] != width || viewportRect[3] != height;
+    if (!count(STATE_VIEWPORT, changed)) return false;
+
+    glViewport(x, y, width, height);
+    viewportRect[0] = x;
+    viewportRect[1] = y;
+    viewportRect[2] = width;
+    viewportRect[3] = height;
+    return true;
+}
+
+int GLState::getBufferTargetIndex(GLenum target) {
+    switch (target) {
+        case GL_DRAW_INDIRECT_BUFFER: return BUFFER_DRAW_INDIRECT;
+        case GL_DISPATCH_INDIRECT_BUFFER: return BUFFER_DISPATCH_INDIRECT;
+        case GL_PARAMETER_BUFFER: return BUFFER_PARAMETER;
+        default: return -1;
+    }
+}
+
+bool GLState::bindBuffer(GLenum target, unsigned int buffer) {
+    int index = getBufferTargetIndex(target);
+    if (index >= 0) {
+        if (!count(STATE_BUFFER, buffers[index] != buffer)) return false;
+        buffers[index] = buffer;
+    } else {
+        count(STATE_BUFFER, true);
+    }
+
+    glBindBuffer(target, buffer);
+    return true;
+}
+
+int GLState::getCapabilityIndex(GLenum capability) {
+    switch (capability) {
+        case GL_BLEND: return CAPABILITY_BLEND;
+        case GL_DEPTH_TEST: return CAPABILITY_DEPTH_TEST;
+        case GL_CULL_FACE: return CAPABILITY_CULL_FACE;
+        case GL_STENCIL_TEST: return CAPABILITY_STENCIL_TEST;
+        case GL_DEPTH_CLAMP: return CAPABILITY_DEPTH_CLAMP;
+        default: return -1;
+    }
+}
+
+bool GLState::setCapability(GLenum capability, bool enabled) {
+    int index = getCapabilityIndex(capability);
+    if (index >= 0) {
+        if (!count(STATE_CAPABILITY, capabilities[index] != (int) enabled)) return false;
+        capabilities[index] = enabled;
+    } else {
+        count(STATE_CAPABILITY, true);
+    }
+
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    return true;
+}
+
+bool GLState::blendFunc(GLenum source, GLenum destination) {
+    if (!count(STATE_BLEND, source != blendSource || destination != blendDestination)) return false;
+
+    glBlendFunc(source, destination);
+    blendSource = source;
+    blendDestination = destination;
+    return true;
+}
+
+bool GLState::depthFunc(GLenum func) {
+    if (!count(STATE_DEPTH, func != depthFunction)) return false;
+
+    glDepthFunc(func);
+    depthFunction = func;
+    return true;
+}
+
+bool GLState::depthMask(bool write) {
+    if (!count(STATE_DEPTH, depthWrite != (int) write)) return false;
+
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+    depthWrite = write;
+    return true;
+}
+
+bool GLState::cullFace(GLenum mode) {
+    if (!count(STATE_CULL, mode != cullMode)) return false;
+
+    glCullFace(mode);
+    cullMode = mode;
+    return true;
+}
+
+bool GLState::setSampler(unsigned int samplerProgram, int location, int unit) {
+    if (location < 0) return false;
+
+    SamplerBinding& binding = samplers[(samplerProgram * 31u + (unsigned int) location) & 255u];
+    bool redundant = binding.program == samplerProgram && binding.location == location && binding.unit == unit;
+    if (!count(STATE_SAMPLER, !redundant)) return false;
+
+    glProgramUniform1i(samplerProgram, location, unit);
+    binding.program = samplerProgram;
+    binding.location = location;
+    binding.unit = unit;
+    return true;
+}
+
+void GLState::invalidate() {
+    program = UNKNOWN;
+    VAO = UNKNOWN;
+    framebuffer = UNKNOWN;
+    activeUnit = UNKNOWN;
+    std::fill(std::begin(textures), std::end(textures), TextureBinding());
+    std::fill(std::begin(buffers), std::end(buffers), UNKNOWN);
+    std::fill(std::begin(viewportRect), std::end(viewportRect), -1);
+
+    std::fill(std::begin(capabilities), std::end(capabilities), -1);
+    blendSource = blendDestination = GL_NONE;
+    depthFunction = GL_NONE;
+    depthWrite = -1;
+    cullMode = GL_NONE;
+    forgetSamplers();
+}
+
+void GLState::forgetSamplers() {
+    std::fill(std::begin(samplers), std::end(samplers), SamplerBinding());
+}
+
+void GLState::forgetTexture(unsigned int texture) {
+    for (TextureBinding& binding : textures) {
+        if (binding.texture == texture) binding = TextureBinding();
+    }
+}
+
+void GLState::forgetVertexArray(unsigned int deletedVAO) {
+    if (VAO == deletedVAO) VAO = UNKNOWN;
+}
+
+void GLState::forgetFramebuffer(unsigned int deletedFramebuffer) {
+    if (framebuffer == deletedFramebuffer) framebuffer = UNKNOWN;
+}
+
+void GLState::forgetBuffer(unsigned int deletedBuffer) {
+    for (unsigned int& buffer : buffers) {
+        if (buffer == deletedBuffer) buffer = UNKNOWN;
+    }
+}
+
+// Uniform values die with the program, a new program reusing the name starts from zero
+void GLState::forgetProgram(unsigned int deletedProgram) {
+    if (program == deletedProgram) program = UNKNOWN;
+    for (SamplerBinding& binding : samplers) {
+        if (binding.program == deletedProgram) binding = SamplerBinding();
+    }
+}
+
+void GLState::beginFrame() {
+    lastFrameStats = frameStats;
+    frameStats = GLStateStats();
+    invalidate();
+}
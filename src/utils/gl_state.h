@@ -0,0 +1,148 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+#define MAX_STATE_TEXTURE_UNITS 32
+
+enum StateCallType {
+    STATE_PROGRAM = 0,
+    STATE_VERTEX_ARRAY,
+    STATE_TEXTURE,
+    STATE_FRAMEBUFFER,
+    STATE_VIEWPORT,
+    STATE_CAPABILITY,
+    STATE_BLEND,
+    STATE_DEPTH,
+    STATE_CULL,
+    STATE_SAMPLER,
+    STATE_BUFFER,
+    STATE_CALL_COUNT
+};
+
+const char* getStateCallName(StateCallType type);
+
+struct StateCallStats {
+    unsigned int issued = 0, skipped = 0;
+};
+
+struct GLStateStats {
+    StateCallStats calls[STATE_CALL_COUNT];
+    unsigned int drawCalls = 0;
+    size_t bytesUploaded = 0;
+};
+
+// Shadow copy of the binding and fixed function state the engines touch every frame.
+// Every setter compares against the last value it issued and skips the GL call when nothing
+// changes, returning whether the call was issued. The cache only knows about changes made
+// through it, so code that binds through raw GL calls has to invalidate it afterwards.
+class GLState {
+    public:
+        static GLState& get();
+
+        bool useProgram(unsigned int program);
+        bool bindVertexArray(unsigned int VAO);
+        // DSA bind, the texture goes to its own target on the unit
+        bool bindTextureUnit(unsigned int unit, unsigned int texture);
+        // Non DSA bind through glActiveTexture, for code that still edits the texture through the target
+        bool bindTexture(unsigned int unit, GLenum target, unsigned int texture);
+        // Binds both draw and read framebuffer, 0 is the window
+        bool bindFramebuffer(unsigned int framebuffer);
+        // The indirect draw, dispatch and count targets are cached, anything else is passed through
+        bool bindBuffer(GLenum target, unsigned int buffer);
+        bool viewport(int x, int y, int width, int height);
+
+        // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_STENCIL_TEST and GL_DEPTH_CLAMP are cached, anything else is passed through
+        bool enable(GLenum capability) { return setCapability(capability, true); }
+        bool disable(GLenum capability) { return setCapability(capability, false); }
+        bool setCapability(GLenum capability, bool enabled);
+
+        bool blendFunc(GLenum source, GLenum destination);
+        bool depthFunc(GLenum func);
+        bool depthMask(bool write);
+        bool cullFace(GLenum mode);
+
+        // Sampler uniforms only change when a program sees a new texture type on a unit.
+        // Shaders also set samplers through plain uniform calls, so callers forget them before a batch of draws.
+        bool setSampler(unsigned int program, int location, int unit);
+        void forgetSamplers();
+
+        void recordDraw(unsigned int count = 1) { frameStats.drawCalls += count; }
+        void recordUpload(size_t bytes) { frameStats.bytesUploaded += bytes; }
+
+        // Forgets everything, the next call of each kind is always issued
+        void invalidate();
+        // Deleted names can be reused by new objects, so bindings that point at them are dropped
+        void forgetTexture(unsigned int texture);
+        void forgetVertexArray(unsigned int VAO);
+        void forgetFramebuffer(unsigned int framebuffer);
+        void forgetBuffer(unsigned int buffer);
+        void forgetProgram(unsigned int program);
+
+        // Publishes the counters of the frame that just finished and starts a new one.
+        // State is invalidated too since ImGui and other libraries draw between frames.
+        void beginFrame();
+        const GLStateStats& getLastFrameStats() const { return lastFrameStats; }
+
+    private:
+        static constexpr unsigned int UNKNOWN = ~0u;
+
+        enum CachedBufferTarget {
+            BUFFER_DRAW_INDIRECT = 0,
+            BUFFER_DISPATCH_INDIRECT,
+            BUFFER_PARAMETER,
+            BUFFER_TARGET_COUNT
+        };
+
+        enum CachedCapability {
+            CAPABILITY_BLEND = 0,
+            CAPABILITY_DEPTH_TEST,
+            CAPABILITY_CULL_FACE,
+            CAPABILITY_STENCIL_TEST,
+            CAPABILITY_DEPTH_CLAMP,
+            CAPABILITY_COUNT
+        };
+
+        struct TextureBinding {
+            unsigned int texture = UNKNOWN;
+            // GL_NONE when bound through glBindTextureUnit
+            GLenum target = GL_NONE;
+        };
+
+        struct SamplerBinding {
+            unsigned int program = 0;
+            int location = -1;
+            int unit = -1;
+        };
+
+        unsigned int program = UNKNOWN;
+        unsigned int VAO = UNKNOWN;
+        unsigned int framebuffer = UNKNOWN;
+        unsigned int activeUnit = UNKNOWN;
+        TextureBinding textures[MAX_STATE_TEXTURE_UNITS];
+        unsigned int buffers[BUFFER_TARGET_COUNT];
+        int viewportRect[4] = { -1, -1, -1, -1 };
+
+        int capabilities[CAPABILITY_COUNT];
+        GLenum blendSource = GL_NONE, blendDestination = GL_NONE;
+        GLenum depthFunction = GL_NONE;
+        int depthWrite = -1;
+        GLenum cullMode = GL_NONE;
+
+        // Direct mapped on program and location, a collision only costs a redundant call
+        SamplerBinding samplers[256];
+
+        GLStateStats frameStats;
+        GLStateStats lastFrameStats;
+
+        GLState() { invalidate(); }
+
+        bool count(StateCallType type, bool issue) {
+            if (issue) frameStats.calls[type].issued++;
+            else frameStats.calls[type].skipped++;
+            return issue;
+        }
+        static int getCapabilityIndex(GLenum capability);
+        static int getBufferTargetIndex(GLenum target);
+};
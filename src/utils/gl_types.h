@@ -78,7 +78,14 @@ struct BoneInfo {
 };
 
 struct AllocatedBuffer {
-    unsigned int VAO, VBO, EBO;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+};
+
+// Where a mesh lives inside a GeometryArena, offsets are in elements
+struct GeometryAllocation {
+    unsigned int baseVertex = 0, vertexCount = 0;
+    unsigned int firstIndex = 0, indexCount = 0;
+    bool isAllocated = false;
 };
 
 struct BoundingBox {
@@ -1,49 +1,43 @@
 #include "material.h"
 
-template<typename T>
-inline void Material::setUniform(std::string& name, T value)
+#include <cstddef>
+
+const MaterialParameterInfo materialParameterInfos[] = {
+	{ "baseColor", MATERIAL_PARAM_VEC3, offsetof(MaterialParameters, baseColor), 0.0f, 1.0f },
+	{ "emissive", MATERIAL_PARAM_VEC3, offsetof(MaterialParameters, emissive), 0.0f, 1.0f },
+	{ "metallic", MATERIAL_PARAM_FLOAT, offsetof(MaterialParameters, metallic), 0.0f, 1.0f },
+	{ "roughness", MATERIAL_PARAM_FLOAT, offsetof(MaterialParameters, roughness), 0.0f, 1.0f },
+	{ "ao", MATERIAL_PARAM_FLOAT, offsetof(MaterialParameters, ao), 0.0f, 1.0f },
+	{ "shininess", MATERIAL_PARAM_FLOAT, offsetof(MaterialParameters, shininess), 1.0f, 256.0f },
+	{ "normalStrength", MATERIAL_PARAM_FLOAT, offsetof(MaterialParameters, normalStrength), 0.0f, 2.0f }
+};
+const int numMaterialParameters = sizeof(materialParameterInfos) / sizeof(MaterialParameterInfo);
+
+int getMaterialTextureSlot(const std::string& type)
 {
-	if constexpr (std::is_same<T, int>()) { uniformInts[name] = value; }
-	else if constexpr (std::is_same<T, float>()) { uniformFloats[name] = value; }
-	else if constexpr (std::is_same<T, glm::vec3>()) { uniformVec3s[name] = value; }
-	else if constexpr (std::is_same<T, glm::mat4>()) { uniformMat4s[name] = value; }
-	else {
-		static_assert(false, "Unsupported data type in Material");
-	}
+	if (type == "texture_diffuse") return MATERIAL_TEXTURE_DIFFUSE;
+	if (type == "texture_specular") return MATERIAL_TEXTURE_SPECULAR;
+	if (type == "texture_normal") return MATERIAL_TEXTURE_NORMAL;
+	if (type == "texture_height") return MATERIAL_TEXTURE_HEIGHT;
+	if (type == "texture_ao") return MATERIAL_TEXTURE_AO;
+	if (type == "texture_metallic") return MATERIAL_TEXTURE_METALLIC;
+	if (type == "texture_roughness") return MATERIAL_TEXTURE_ROUGHNESS;
+	return -1;
 }
 
-void Material::updateUniforms(Shader& shader)
+void Material::updateTextureMask()
 {
-	for (auto& pair : uniformInts) {
-		shader.setInt(pair.first, pair.second);
-	}
-	for (auto& pair : uniformFloats) {
-		shader.setFloat(pair.first, pair.second);
-	}
-
-	for (auto& pair : uniformVec3s) {
-		shader.setVec3(pair.first, pair.second);
-	}
-	for (auto& pair : uniformMat4s) {
-		shader.setMat4(pair.first, pair.second);
+	params.textureMask = 0;
+	for (Texture& texture : textures) {
+		int slot = getMaterialTextureSlot(texture.type);
+		if (slot != -1) params.textureMask |= (1u << slot);
 	}
 }
 
-void Material::updateUniforms()
+ShaderFeatures Material::getShaderFeatures() const
 {
-	if (shader != nullptr) {
-		for (auto& pair : uniformInts) {
-			shader->setInt(pair.first, pair.second);
-		}
-		for (auto& pair : uniformFloats) {
-			shader->setFloat(pair.first, pair.second);
-		}
-
-		for (auto& pair : uniformVec3s) {
-			shader->setVec3(pair.first, pair.second);
-		}
-		for (auto& pair : uniformMat4s) {
-			shader->setMat4(pair.first, pair.second);
-		}
-	}
+	ShaderFeatures features = 0;
+	if (hasTexture(MATERIAL_TEXTURE_NORMAL)) features |= SHADER_FEATURE_NORMAL_MAP;
+	if (hasTexture(MATERIAL_TEXTURE_METALLIC)) features |= SHADER_FEATURE_METALLIC_MAP;
+	return features;
 }
@@ -1,23 +1,63 @@
 #pragma once
 
+#include <vector>
+
 #include "utils/gl_types.h"
 #include "utils/shader.h"
 
-struct Material {
+#define INVALID_MATERIAL_ID 0xFFFFFFFF
+
+enum MaterialTextureSlot {
+	MATERIAL_TEXTURE_DIFFUSE = 0,
+	MATERIAL_TEXTURE_SPECULAR,
+	MATERIAL_TEXTURE_NORMAL,
+	MATERIAL_TEXTURE_HEIGHT,
+	MATERIAL_TEXTURE_AO,
+	MATERIAL_TEXTURE_METALLIC,
+	MATERIAL_TEXTURE_ROUGHNESS,
+	MAX_MATERIAL_TEXTURES = 8
+};
 
-	template<typename T>
-	void setUniform(std::string& name, T value);
+// Mirrors the params member of the std430 Material struct in the shaders
+struct MaterialParameters {
+	glm::vec3 baseColor = glm::vec3(1.0f);
+	float metallic = 0.2f;
+	glm::vec3 emissive = glm::vec3(0.0f);
+	float roughness = 0.8f;
+	float ao = 1.0f;
+	float shininess = 32.0f;
+	float normalStrength = 1.0f;
+	unsigned int textureMask = 0;
+};
 
-	void updateUniforms(Shader& shader);
-	void updateUniforms();
+enum MaterialParameterType {
+	MATERIAL_PARAM_FLOAT,
+	MATERIAL_PARAM_VEC3
+};
 
+// Lets the editor walk the fixed layout the same way it used to walk the uniform maps
+struct MaterialParameterInfo {
+	const char* name;
+	MaterialParameterType type;
+	size_t offset;
+	float min, max;
+};
+
+extern const MaterialParameterInfo materialParameterInfos[];
+extern const int numMaterialParameters;
+
+int getMaterialTextureSlot(const std::string& type);
+
+struct Material {
 	std::vector<Texture> textures;
 	std::vector<std::string> texture_paths;
-	Shader* shader;
 
-	std::unordered_map<std::string, int> uniformInts;
-	std::unordered_map<std::string, float> uniformFloats;
-	std::unordered_map<std::string, glm::vec3> uniformVec3s;
-	std::unordered_map<std::string, glm::mat4> uniformMat4s;
+	MaterialParameters params;
+	// Index into the shared material buffer, assigned by MaterialBuffer::compile
+	unsigned int materialID = INVALID_MATERIAL_ID;
 
+	void updateTextureMask();
+	bool hasTexture(MaterialTextureSlot slot) const { return params.textureMask & (1u << slot); }
+	// Variant bits for the maps this material has, replaces the per-pixel noNormalMap/noMetallicMap branches
+	ShaderFeatures getShaderFeatures() const;
 };
@@ -1,172 +1,159 @@
 #include "shader.h"
+#include "gl_state.h"
+#include "gl_program_cache.h"
+#include "gl_shader_manager.h"
 
 Shader::Shader() {}
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath, 
-    const char* geoPath) {
-    const string shaderPath = "../../shaders/";
-
-    string convertedVertexPath = shaderPath + vertexPath;
-    string convertedFragmentPath = shaderPath + fragmentPath;
-    string convertedGeometryPath;
-    if (geoPath != nullptr) convertedGeometryPath = shaderPath + geoPath;
-
+    const char* geoPath, ShaderFeatures features) : features(features) {
+    ShaderPreprocessor preprocessor;
     string vertexCode;
     string fragmentCode;
     string geoCode;
-    ifstream vShaderFile;
-    ifstream fShaderFile;
-    ifstream gShaderFile;
-
-    vShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-    fShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-    gShaderFile.exceptions(ifstream::failbit | ifstream::badbit);
-
-    try {
-        vShaderFile.open(convertedVertexPath.c_str());
-        fShaderFile.open(convertedFragmentPath.c_str());
-        stringstream vShaderStream, fShaderStream;
-
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
 
-        vShaderFile.close();
-        fShaderFile.close();
+    preprocessor.process(vertexPath, features, vertexCode);
+    preprocessor.process(fragmentPath, features, fragmentCode);
+    if (geoPath != nullptr) preprocessor.process(geoPath, features, geoCode);
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+    std::vector<ShaderStageSource> stages = {
+        { GL_VERTEX_SHADER, vertexPath, vertexCode },
+        { GL_FRAGMENT_SHADER, fragmentPath, fragmentCode }
+    };
+    if (geoPath != nullptr) stages.push_back({ GL_GEOMETRY_SHADER, geoPath, geoCode });
 
-        if (geoPath != nullptr) {
-            gShaderFile.open(convertedGeometryPath.c_str());
-            stringstream gShaderStream;
-            gShaderStream << gShaderFile.rdbuf();
-            gShaderFile.close();
-            geoCode = gShaderStream.str();
-        }
-    } catch (ifstream::failure& e) {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << e.what() << std::endl;
-    }
-
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    setProgram(ProgramCache::get().getProgram(stages));
+}
 
-    unsigned int vertex, fragment;
+void Shader::setProgram(unsigned int program) {
+    ID = program;
+    reflection.reflect(ID);
+}
 
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geoPath) :
+    vertexPath(vertexPath), fragmentPath(fragmentPath), geoPath(geoPath != nullptr ? geoPath : "") {}
 
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+Shader& ShaderVariants::get(ShaderFeatures features) {
+    auto it = variants.find(features);
+    if (it != variants.end()) return it->second;
 
-    unsigned int geometry;
-    if (geoPath != nullptr) {
-        const char* gShaderCode = geoCode.c_str();
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        checkCompileErrors(geometry, "GEOMETRY");
-    }
+    const char* geometry = geoPath.empty() ? nullptr : geoPath.c_str();
+    Shader& variant = variants[features];
 
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (geoPath != nullptr) {
-        glAttachShader(ID, geometry);
-    }
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+    ShaderManager& shaders = ShaderManager::get();
+    shaders.load(variant, vertexPath.c_str(), fragmentPath.c_str(), geometry, features);
+    shaders.finish();
+    return variant;
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (geoPath != nullptr) {
-        glDeleteShader(geometry);
-    }
+const Shader* ShaderVariants::find(ShaderFeatures features) const {
+    auto it = variants.find(features);
+    return it != variants.end() ? &it->second : nullptr;
 }
 
 void Shader::use() {
-    glUseProgram(ID);
+    GLState::get().useProgram(ID);
 }
 
 void Shader::setBool(const std::string &name, bool value) const
 {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    glUniform1i(reflection.getLocation(UniformId(name)), (int)value); 
 }
 // ------------------------------------------------------------------------
 void Shader::setInt(const std::string &name, int value) const
 { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(reflection.getLocation(UniformId(name)), value); 
 }
 // ------------------------------------------------------------------------
 void Shader::setFloat(const std::string &name, float value) const
 { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(reflection.getLocation(UniformId(name)), value); 
 }
 // ------------------------------------------------------------------------
 void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
 { 
-    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform2fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void Shader::setVec2(const std::string &name, float x, float y) const
 { 
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+    glUniform2f(reflection.getLocation(UniformId(name)), x, y); 
 }
 // ------------------------------------------------------------------------
 void Shader::setVec3(const std::string &name, const glm::vec3 &value) const
 { 
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform3fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void Shader::setVec3(const std::string &name, float x, float y, float z) const
 { 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    glUniform3f(reflection.getLocation(UniformId(name)), x, y, z); 
 }
 // ------------------------------------------------------------------------
 void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
 { 
-    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+    glUniform4fv(reflection.getLocation(UniformId(name)), 1, &value[0]); 
 }
 void Shader::setVec4(const std::string &name, float x, float y, float z, float w) 
 { 
-    glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+    glUniform4f(reflection.getLocation(UniformId(name)), x, y, z, w); 
 }
 // ------------------------------------------------------------------------
 void Shader::setMat2(const std::string &name, const glm::mat2 &mat) const
 {
-    glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat3(const std::string &name, const glm::mat3 &mat) const
 {
-    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
 }
 // ------------------------------------------------------------------------
 void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
-}
-    
-void Shader::checkCompileErrors(unsigned int shader, std::string type) {
-    int success;
-    char infoLog[1024];
-    if (type != "PROGRAM")
-    {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success)
-        {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
-    else
-    {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success)
-        {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
-    }
-}
\ No newline at end of file
+    glUniformMatrix4fv(reflection.getLocation(UniformId(name)), 1, GL_FALSE, &mat[0][0]);
+}
+
+// ------------------------------------------------------------------------
+int Shader::getUniformLocation(UniformId id) const
+{
+    return reflection.getLocation(id);
+}
+void Shader::setBool(UniformId id, bool value) const
+{
+    glUniform1i(reflection.getLocation(id), (int)value);
+}
+void Shader::setInt(UniformId id, int value) const
+{
+    glUniform1i(reflection.getLocation(id), value);
+}
+void Shader::setUint(UniformId id, unsigned int value) const
+{
+    glUniform1ui(reflection.getLocation(id), value);
+}
+void Shader::setFloat(UniformId id, float value) const
+{
+    glUniform1f(reflection.getLocation(id), value);
+}
+void Shader::setVec2(UniformId id, const glm::vec2 &value) const
+{
+    glUniform2fv(reflection.getLocation(id), 1, &value[0]);
+}
+void Shader::setVec3(UniformId id, const glm::vec3 &value) const
+{
+    glUniform3fv(reflection.getLocation(id), 1, &value[0]);
+}
+void Shader::setVec4(UniformId id, const glm::vec4 &value) const
+{
+    glUniform4fv(reflection.getLocation(id), 1, &value[0]);
+}
+void Shader::setMat2(UniformId id, const glm::mat2 &mat) const
+{
+    glUniformMatrix2fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat3(UniformId id, const glm::mat3 &mat) const
+{
+    glUniformMatrix3fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
+}
+void Shader::setMat4(UniformId id, const glm::mat4 &mat) const
+{
+    glUniformMatrix4fv(reflection.getLocation(id), 1, GL_FALSE, &mat[0][0]);
+}
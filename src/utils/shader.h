@@ -12,15 +12,27 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <unordered_map>
+
+#include "gl_reflection.h"
+#include "gl_shader_preprocessor.h"
+
 using namespace std;
 
 class Shader {
     public:
-        unsigned int ID;
+        unsigned int ID = 0;
+        // The #defines this program was built with
+        ShaderFeatures features = 0;
+
         Shader();
-        Shader(const char* vertexPath, const char* fragmentPath, const char* geoPath = nullptr);
+        // Paths are relative to SHADER_ROOT_PATH and go through the ShaderPreprocessor
+        Shader(const char* vertexPath, const char* fragmentPath, const char* geoPath = nullptr, ShaderFeatures features = 0);
         void use();
 
+        // Points the shader at a linked program and reflects it, used by the ShaderManager
+        void setProgram(unsigned int program);
+
         void setBool(const std::string &name, bool value) const;
         // ------------------------------------------------------------------------
         void setInt(const std::string &name, int value) const;
@@ -41,9 +53,44 @@ class Shader {
         void setMat3(const std::string &name, const glm::mat3 &mat) const;
         // ------------------------------------------------------------------------
         void setMat4(const std::string &name, const glm::mat4 &mat) const;
+
+        // Cached location versions, use "name"_u for literals or uniformArray for array elements
+        void setBool(UniformId id, bool value) const;
+        void setInt(UniformId id, int value) const;
+        void setUint(UniformId id, unsigned int value) const;
+        void setFloat(UniformId id, float value) const;
+        void setVec2(UniformId id, const glm::vec2 &value) const;
+        void setVec3(UniformId id, const glm::vec3 &value) const;
+        void setVec4(UniformId id, const glm::vec4 &value) const;
+        void setMat2(UniformId id, const glm::mat2 &mat) const;
+        void setMat3(UniformId id, const glm::mat3 &mat) const;
+        void setMat4(UniformId id, const glm::mat4 &mat) const;
+
+        int getUniformLocation(UniformId id) const;
+        const ProgramReflection& getReflection() const { return reflection; }
     
     private:
-        void checkCompileErrors(unsigned int shader, std::string type);
+        ProgramReflection reflection;
+};
+
+// Specializations of one set of sources, built the first time a feature combination is asked for.
+// Compiling needs the GL thread, so call get for every combination before recording on workers.
+// Variants go through the ShaderManager, so they reload along with everything else.
+class ShaderVariants {
+    public:
+        ShaderVariants() {}
+        ShaderVariants(const char* vertexPath, const char* fragmentPath, const char* geoPath = nullptr);
+
+        Shader& get(ShaderFeatures features);
+        // Null when that combination hasn't been built yet
+        const Shader* find(ShaderFeatures features) const;
+
+        // Per-frame uniforms have to be set on every variant a pass might draw with
+        std::unordered_map<ShaderFeatures, Shader>& getVariants() { return variants; }
+
+    private:
+        std::string vertexPath, fragmentPath, geoPath;
+        std::unordered_map<ShaderFeatures, Shader> variants;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "shadow_atlas.h"
+
+#include <algorithm>
+
+void ShadowAtlas::init(unsigned int atlasSize, unsigned int minSize) {
+    size = atlasSize;
+    minRegionSize = std::max(1u, std::min(minSize, atlasSize));
+    clear();
+}
+
+void ShadowAtlas::clear() {
+    int numLevels = 1;
+    while ((size >> numLevels) >= minRegionSize && (size >> numLevels) > 0) numLevels++;
+
+    freeRegions.assign(numLevels, {});
+    freeRegions[0].push_back(glm::uvec2(0, 0));
+    usedArea = 0;
+    numRegions = 0;
+}
+
+ShadowAtlasRegion ShadowAtlas::allocate(unsigned int regionSize) {
+    regionSize = std::max(regionSize, minRegionSize);
+
+    int level = freeRegions.size() - 1;
+    while (level > 0 && getRegionSize(level) < regionSize) level--;
+    if (getRegionSize(level) < regionSize) return ShadowAtlasRegion();
+
+    glm::uvec2 corner;
+    if (!allocateLevel(level, corner)) return ShadowAtlasRegion();
+
+    ShadowAtlasRegion region;
+    region.x = corner.x;
+    region.y = corner.y;
+    region.size = getRegionSize(level);
+
+    usedArea += (size_t) region.size * region.size;
+    numRegions++;
+    return region;
+}
+
+bool ShadowAtlas::allocateLevel(int level, glm::uvec2& corner) {
+    std::vector<glm::uvec2>& regions = freeRegions[level];
+    if (!regions.empty()) {
+        corner = regions.back();
+        regions.pop_back();
+        return true;
+    }
+    if (level == 0) return false;
+
+    // Split a square of the level above, the three quarters not taken stay free here
+    glm::uvec2 parent;
+    if (!allocateLevel(level - 1, parent)) return false;
+
+    unsigned int half = getRegionSize(level);
+    regions.push_back(parent + glm::uvec2(half, 0));
+    regions.push_back(parent + glm::uvec2(0, half));
+    regions.push_back(parent + glm::uvec2(half, half));
+    corner = parent;
+    return true;
+}
+
+void ShadowAtlas::free(const ShadowAtlasRegion& region) {
+    if (!region.isValid()) return;
+
+    int level = 0;
+    while (level < (int) freeRegions.size() - 1 && getRegionSize(level) > region.size) level++;
+
+    usedArea -= (size_t) region.size * region.size;
+    numRegions--;
+    freeLevel(level, glm::uvec2(region.x, region.y));
+}
+
+void ShadowAtlas::freeLevel(int level, glm::uvec2 corner) {
+    std::vector<glm::uvec2>& regions = freeRegions[level];
+    if (level == 0) {
+        regions.push_back(corner);
+        return;
+    }
+
+    unsigned int regionSize = getRegionSize(level);
+    glm::uvec2 parent = (corner / (regionSize * 2)) * (regionSize * 2);
+
+    // Merge when the other three quarters of the parent are free as well
+    std::vector<size_t> siblings;
+    for (size_t i = 0; i < regions.size() && siblings.size() < 3; i++) {
+        glm::uvec2 other = regions[i];
+        if (other != corner && (other / (regionSize * 2)) * (regionSize * 2) == parent) siblings.push_back(i);
+    }
+
+    if (siblings.size() < 3) {
+        regions.push_back(corner);
+        return;
+    }
+
+    for (auto it = siblings.rbegin(); it != siblings.rend(); ++it) {
+        regions[*it] = regions.back();
+        regions.pop_back();
+    }
+    freeLevel(level - 1, parent);
+}
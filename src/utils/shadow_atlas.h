@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Square tile of a shadow atlas in texels, x and y from the bottom left like a viewport
+struct ShadowAtlasRegion {
+    unsigned int x = 0, y = 0;
+    unsigned int size = 0;
+
+    bool isValid() const { return size != 0; }
+};
+
+// Quadtree allocator over a square power of two atlas. Regions are powers of two between
+// minRegionSize and the atlas size, splitting a free square into four when none of the asked
+// size is left and merging four free siblings back when the last of them is freed, so lights
+// can trade resolution without the atlas fragmenting. Only hands out coordinates, the textures
+// behind it belong to whoever owns the atlas.
+class ShadowAtlas {
+    public:
+        void init(unsigned int size, unsigned int minRegionSize);
+
+        // size is rounded up to a power of two, the region is invalid when nothing that big is free
+        ShadowAtlasRegion allocate(unsigned int size);
+        void free(const ShadowAtlasRegion& region);
+        void clear();
+
+        unsigned int getSize() const { return size; }
+        // Texels handed out and not freed yet
+        size_t getUsedArea() const { return usedArea; }
+        unsigned int getNumRegions() const { return numRegions; }
+
+    private:
+        unsigned int size = 0;
+        unsigned int minRegionSize = 0;
+        size_t usedArea = 0;
+        unsigned int numRegions = 0;
+
+        // Bottom left corners of the free squares of each level, level 0 is the whole atlas
+        std::vector<std::vector<glm::uvec2>> freeRegions;
+
+        unsigned int getRegionSize(int level) const { return size >> level; }
+        bool allocateLevel(int level, glm::uvec2& corner);
+        void freeLevel(int level, glm::uvec2 corner);
+};
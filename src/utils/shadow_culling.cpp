@@ -0,0 +1,61 @@
+#include "shadow_culling.h"
+
+#include <algorithm>
+#include <limits>
+
+// Rows of the matrix combine into the clip planes, left, right, bottom, top, far then near
+ShadowVolume ShadowVolume::fromMatrix(const glm::mat4& viewProjection, bool keepNear) {
+    glm::mat4 rows = glm::transpose(viewProjection);
+
+    ShadowVolume volume;
+    volume.planes[volume.numPlanes++] = rows[3] + rows[0];
+    volume.planes[volume.numPlanes++] = rows[3] - rows[0];
+    volume.planes[volume.numPlanes++] = rows[3] + rows[1];
+    volume.planes[volume.numPlanes++] = rows[3] - rows[1];
+    volume.planes[volume.numPlanes++] = rows[3] - rows[2];
+    if (keepNear) volume.planes[volume.numPlanes++] = rows[3] + rows[2];
+
+    for (int i = 0; i < volume.numPlanes; i++) {
+        volume.planes[i] /= glm::length(glm::vec3(volume.planes[i]));
+    }
+    return volume;
+}
+
+// Only the corner furthest along each plane's normal has to be checked
+bool ShadowVolume::intersects(const glm::vec3& minPoint, const glm::vec3& maxPoint) const {
+    for (int i = 0; i < numPlanes; i++) {
+        const glm::vec4& plane = planes[i];
+        glm::vec3 positive(
+            plane.x > 0.0f ? maxPoint.x : minPoint.x,
+            plane.y > 0.0f ? maxPoint.y : minPoint.y,
+            plane.z > 0.0f ? maxPoint.z : minPoint.z);
+
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) return false;
+    }
+    return true;
+}
+
+void transformBounds(const glm::mat4& transform, const glm::vec4& minPoint, const glm::vec4& maxPoint,
+    glm::vec3& worldMin, glm::vec3& worldMax) {
+    worldMin = glm::vec3(std::numeric_limits<float>::max());
+    worldMax = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 point(
+            (corner & 1) ? maxPoint.x : minPoint.x,
+            (corner & 2) ? maxPoint.y : minPoint.y,
+            (corner & 4) ? maxPoint.z : minPoint.z,
+            1.0f);
+        glm::vec3 transformed = glm::vec3(transform * point);
+        worldMin = glm::min(worldMin, transformed);
+        worldMax = glm::max(worldMax, transformed);
+    }
+}
+
+uint32_t getLayerMask(const std::vector<ShadowVolume>& volumes, const glm::vec3& minPoint, const glm::vec3& maxPoint) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < volumes.size() && i < MAX_SHADOW_LAYERS; i++) {
+        if (volumes[i].intersects(minPoint, maxPoint)) mask |= 1u << i;
+    }
+    return mask;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Bits in a caster's layer mask, one per cascade or cube face
+#define MAX_SHADOW_LAYERS 32
+#define ALL_SHADOW_LAYERS 0xFFFFFFFFu
+
+// Convex volume a shadow layer rasterizes, planes point inwards
+struct ShadowVolume {
+    glm::vec4 planes[6];
+    int numPlanes = 0;
+
+    // Planes of the clip volume of viewProjection. Without the near plane, casters between the
+    // light and the volume are kept, for passes that pancake them onto it with GL_DEPTH_CLAMP.
+    static ShadowVolume fromMatrix(const glm::mat4& viewProjection, bool keepNear = true);
+
+    bool intersects(const glm::vec3& minPoint, const glm::vec3& maxPoint) const;
+};
+
+// World space bounds of a box after transform, from all eight corners so rotated casters keep their extent
+void transformBounds(const glm::mat4& transform, const glm::vec4& minPoint, const glm::vec4& maxPoint,
+    glm::vec3& worldMin, glm::vec3& worldMax);
+
+// Bit i set when the box touches volumes[i]
+uint32_t getLayerMask(const std::vector<ShadowVolume>& volumes, const glm::vec3& minPoint, const glm::vec3& maxPoint);
+
+struct ShadowCullingStats {
+    unsigned int casters = 0;
+    unsigned int culledCasters = 0;
+    // Caster and layer pairs drawn, out of casters times layers had every caster gone to every layer
+    unsigned int layerDraws = 0;
+    unsigned int possibleLayerDraws = 0;
+
+    void add(const ShadowCullingStats& other) {
+        casters += other.casters;
+        culledCasters += other.culledCasters;
+        layerDraws += other.layerDraws;
+        possibleLayerDraws += other.possibleLayerDraws;
+    }
+};
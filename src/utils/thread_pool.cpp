@@ -0,0 +1,79 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+ThreadPool& ThreadPool::get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads) {
+    if (numThreads == 0) {
+        unsigned int cores = std::thread::hardware_concurrency();
+        numThreads = cores > 1 ? cores - 1 : 1;
+    }
+
+    for (unsigned int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread& worker : workers) worker.join();
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> job) {
+    std::packaged_task<void()> task(std::move(job));
+    std::future<void> result = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push(std::move(task));
+    }
+    condition.notify_one();
+
+    return result;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job) {
+    if (count == 0) return;
+    if (count == 1) {
+        job(0);
+        return;
+    }
+
+    // Indices are pulled from a shared counter so uneven jobs still balance out
+    std::atomic<size_t> next(0);
+    auto run = [&]() {
+        for (size_t i = next++; i < count; i = next++) job(i);
+    };
+
+    size_t helpers = std::min<size_t>(workers.size(), count - 1);
+    std::vector<std::future<void>> results;
+    results.reserve(helpers);
+    for (size_t i = 0; i < helpers; i++) results.push_back(submit(run));
+
+    run();
+    for (std::future<void>& result : results) result.get();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+
+            task = std::move(jobs.front());
+            jobs.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by everything that wants CPU work off the GL thread.
+// Jobs must not make GL calls, only the thread that owns the context can.
+class ThreadPool {
+    public:
+        static ThreadPool& get();
+
+        // Zero picks one thread per core minus the GL thread
+        explicit ThreadPool(unsigned int numThreads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::future<void> submit(std::function<void()> job);
+
+        // Runs job(i) for every i in [0, count) across the workers and the calling thread, returns when all are done
+        void parallelFor(size_t count, const std::function<void(size_t)>& job);
+
+        unsigned int getNumThreads() const { return workers.size(); }
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::packaged_task<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping = false;
+
+        void workerLoop();
+};